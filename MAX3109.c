@@ -2,7 +2,7 @@
  * Author : Henry Gilbert
  * Date: 12 December 2021 
  * 
- * Master Todo List: Add SPI Burst access , touch up interrupts, fix disable and enable tx FIFO, implement Rx timeout
+ * Master Todo List: touch up interrupts, fix disable and enable tx FIFO, implement Rx timeout
  * 
  * Module Description: All access to the MAX3109 UART chip involves reading and writing to specified registers based on
  * the users desired functionality. All reads and writes are performed in 16 bit SPI mode. A write operation involves
@@ -14,10 +14,17 @@
  * Note: All SPI read operations return the desired 8 bit value, along with 2 extra status bytes of the interrupt registers.
  * 
  *                           7    6      5         4      3      2      1      0    
- *SPI Command byte format - W/R   0   Channel   Bit 4   Bit 3  Bit 2  Bit 1   Bit 0  -> append second 8 bits with data for write, zeros for read. */
+ *SPI Command byte format - W/R   0   Channel   Bit 4   Bit 3  Bit 2  Bit 1   Bit 0  -> append second 8 bits with data for write, zeros for read.
+ * 
+ * Burst access: the THR/RHR address is not incremented while CS is held low, so a single command byte followed by N
+ * data bytes moves N bytes to or from the FIFO in one SPI transaction. In 16 bit mode the command byte and first data
+ * byte share the first word and every following word carries two data bytes. Every clocked byte pops (or pushes) the
+ * FIFO, so a burst always moves an odd number of data bytes - an even request is split into a burst plus one single access. */
 
 #include "MAX3109.h"
-#include "newSPI.h"
+#include "MAX3109Registers.h"
+#include "SPITransport.h"
+#include "MAX3109Stats.h"
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -25,102 +32,357 @@
 #define maxRetryAttempts 3
 #define IRQREADMASK 0x300 // Bitmask for fast read to take the 12 byte message 
 #define CLKSourceMASK 0x8C
+#define BRGCONFIG_READBACK_MASK 0x3F // Rate mode and FRACT bits
+#define MODE1_IRQ_PIN_ENABLE 0x80
+#define LSR_RX_TIMEOUT 0x01
+#define FIFO_TRIGGER_LEVEL_STEP 8 // FIFOTrgLvl nibbles count in units of 8 bytes
+#define FLOW_LEVEL_STEP 8 // FlowLvl nibbles too - resume level in the high nibble, halt level in the low nibble
+#define FLOWCTRL_AUTO_RTS 0x01
+#define FLOWCTRL_AUTO_CTS 0x02
+#define BURST_WORD_BUFFER_SIZE MAX3109_BURST_WORD_COUNT(MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES) // Command byte plus a full FIFO
+
+#define MODE2_RESET 0x01
+#define REGISTER_INDEX(maxRegister) (((maxRegister) >> 8) & 0x1F)
+#define CHANNEL_INDEX(channel) ((UART_1 == (channel)) ? 1 : 0)
+#define LCR_LENGTH_MASK 0x03 // Word length - 5 + value bits
+#define LCR_STOP_BITS 0x04 // 2 stop bits (1.5 for 5 bit words)
+#define LCR_PARITY_ENABLE 0x08
 
+static MAX3109_DEVICE defaultDevice; // Holds the shadow registers until MAXSelectDevice is called
+static MAX3109_DEVICE * activeDevice = &defaultDevice;
 static uint16_t dummy; // Used as dummy for receiving junk data from SPI - should be local to this file and never used elsewhere.
+static uint16_t configWordBuffer[MAX3109_MAX_CONFIG_ENTRIES]; // Command/response words of one configuration burst
+static uint8_t configByteBuffer[MAX3109_MAX_CONFIG_ENTRIES]; // Register values unpacked from a configuration burst read
+static uint16_t burstWordBuffer[BURST_WORD_BUFFER_SIZE]; // Shared tx/rx word buffer for FIFO burst transfers
+static const uint8_t pllMultipliers[4] = { 6, 48, 96, 144 }; // Indexed by PLLConfig bits 7:6
+static const uint32_t pllInputMinimumHz[4] = { 500000UL, 850000UL, 425000UL, 390000UL }; // Clock / PreDiv limits per factor
+static const uint32_t pllInputMaximumHz[4] = { 800000UL, 1200000UL, 1000000UL, 667000UL };
 
 /* Local Function Prototypes */
 static uint8_t MAXreadRegisterValue( const MAX3109_UART_SELECTION channel,
                                      const MAX3109_REGISTER_ADDRESS_VALUE maxRegister );
+static uint8_t MAXreadRegisterValueFromChip( const MAX3109_UART_SELECTION channel,
+                                             const MAX3109_REGISTER_ADDRESS_VALUE maxRegister );
 static uint8_t MAXwriteRegisterValue( const MAX3109_UART_SELECTION channel, /* 0 is ADC , 1 is GPS UART*/
                                       const MAX3109_REGISTER_ADDRESS_VALUE maxRegister,
                                       const uint8_t value /*value to write */ );
 static inline bool UARTChannelIsInvalid( const MAX3109_UART_SELECTION channel );
+static inline bool RegisterIsCacheable( const MAX3109_REGISTER_ADDRESS_VALUE maxRegister );
+static void MAXUpdateShadowRegister( const MAX3109_UART_SELECTION channel,
+                                     const MAX3109_REGISTER_ADDRESS_VALUE maxRegister,
+                                     const uint8_t value );
+static uint32_t MAXWriteConfigEntries( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries,
+                                       const uint32_t entryMask );
+static uint32_t MAXReadbackConfigEntries( const MAX3109_REGISTER_CONFIG * table,
+                                          const uint8_t numEntries,
+                                          const uint32_t entryMask );
+static bool ConfigTableIsInvalid( const MAX3109_REGISTER_CONFIG * table,
+                                  const uint8_t numEntries );
+static uint8_t ConfigBurstLength( const MAX3109_REGISTER_CONFIG * table,
+                                  const uint8_t numEntries,
+                                  const uint32_t entryMask,
+                                  const uint8_t firstEntry );
+static uint8_t MAXPackBurstReadCommand( const MAX3109_UART_SELECTION channel,
+                                        uint16_t * wordBuffer,
+                                        const uint8_t numBurstBytes );
+static uint32_t PLLOutputHz( const uint32_t clockHz,
+                             const uint8_t pllConfig );
+static inline uint32_t BaudError( const uint32_t actualBaud,
+                                  const uint32_t targetBaud );
+static inline uint16_t GatherFragmentLength( const MAX3109_TX_FRAGMENT * fragment );
+static inline void PackGatherByte( const uint8_t bytePosition,
+                                   const uint8_t value );
+
+/* Points the SPI layer at the chip, so every register and FIFO access below goes to its chip select line */
+void MAXSelectDevice( MAX3109_DEVICE * device )
+{
+    if (NULL == device)
+    {
+        return;
+    }
+    activeDevice = device;
+    SPISetTransport( device->transport, device->chipSelectLine );
+}
+
+void MAXInvalidateShadowRegisters( const MAX3109_UART_SELECTION channel )
+{
+    if (UARTChannelIsInvalid( channel ))
+    {
+        return;
+    }
+    activeDevice->shadowValidMask[CHANNEL_INDEX( channel )] = 0;
+}
+
+uint8_t MAXVerifyShadowRegisters( const MAX3109_UART_SELECTION channel,
+                                  const bool restoreMismatches )
+{
+    if (UARTChannelIsInvalid( channel ))
+    {
+        return 0xFF; // Error, invalid params
+    }
+
+    uint8_t channelIndex = CHANNEL_INDEX( channel );
+    uint8_t numMismatches = 0;
+    uint8_t registerIndex;
+    for (registerIndex = 0; registerIndex < MAX3109_NUM_SHADOW_REGISTERS; registerIndex++)
+    {
+        if (0 == (activeDevice->shadowValidMask[channelIndex] & (1UL << registerIndex)))
+        {
+            continue;
+        }
+
+        MAX3109_REGISTER_ADDRESS_VALUE maxRegister = (MAX3109_REGISTER_ADDRESS_VALUE) (registerIndex << 8);
+        uint8_t cachedValue = activeDevice->shadowRegisters[channelIndex][registerIndex];
+        uint8_t chipValue = MAXreadRegisterValueFromChip( channel, maxRegister );
+        if (chipValue == cachedValue)
+        {
+            continue;
+        }
+
+        numMismatches++;
+        if (restoreMismatches)
+        {
+            MAXwriteRegisterValue( channel, maxRegister, cachedValue );
+        }
+        else
+        {
+            activeDevice->shadowRegisters[channelIndex][registerIndex] = chipValue;
+        }
+    }
+    return numMismatches;
+}
 
 /* Function: Initialize_MAX3109()
  * Description - Performs initial read known register value, writes registers from configuration data, performs readback tests on written registers.
  * Returns 1 on success, 0 on failure. 
- * 3 retry attempts for entire chip, 3 retry attemps for each read back register  */
+ * Each step is a configuration table - 3 retry attempts per table, and a retry only repeats the registers that failed.
+ * SPI transactions on a clean start: 4 reset + 4 known value reads + 4 writes + 4 readbacks = 16, the same as the
+ * register by register sequence - the chip needs one chip select frame per register. A failed readback now costs
+ * 2 transactions per failed register instead of 8 for the whole pass. */
 uint8_t MAXInitializeMAX3109( const uint8_t maxPLLConfiguration,
                            const uint8_t maxClockConfig,
                            const uint8_t uartLineConfig )
 {
-
     /* Perform a Master reset on the chip and reset FIFOs */
-    MAXwriteRegisterValue( UART_0, max3109_MODE2, 0x01 );
-    MAXwriteRegisterValue( UART_1, max3109_MODE2, 0x01 );
-    MAXwriteRegisterValue( UART_0, max3109_MODE2, 0x00 );
-    MAXwriteRegisterValue( UART_1, max3109_MODE2, 0x00 );
+    const MAX3109_REGISTER_CONFIG resetTable[] = {
+        { UART_0, max3109_MODE2, 0x01, 0x00 },
+        { UART_1, max3109_MODE2, 0x01, 0x00 },
+        { UART_0, max3109_MODE2, 0x00, 0x00 },
+        { UART_1, max3109_MODE2, 0x00, 0x00 }
+    };
+
+    /* Known register values at startup - bit 0 should read back as 1 */
+    const MAX3109_REGISTER_CONFIG defaultsTable[] = {
+        { UART_0, max3109_DIVLSB, 0x01, 0x01 },
+        { UART_0, max3109_PLLConfig, 0x01, 0x01 },
+        { UART_1, max3109_DIVLSB, 0x01, 0x01 },
+        { UART_1, max3109_PLLConfig, 0x01, 0x01 }
+    };
 
-    // Disable both receive FIFOs during initialization 
+    /* Generic UART Config applies to both UARTs and can only be written to UART0, then the line config of each UART.
+     * Only the CLKSource bits in CLKSourceMASK read back as written. No two of these registers are neighbours on one
+     * UART, so each entry is its own burst - MAXConfigureBaudRate is where the clock registers share one. */
+    const MAX3109_REGISTER_CONFIG configTable[] = {
+        { UART_0, max3109CLKSource, maxClockConfig, CLKSourceMASK },
+        { UART_0, max3109_PLLConfig, maxPLLConfiguration, 0xFF },
+        { UART_0, max3109_LCR, uartLineConfig, 0xFF },
+        { UART_1, max3109_LCR, uartLineConfig, 0xFF }
+    };
+
+    MAXApplyRegisterConfiguration( resetTable, sizeof (resetTable) / sizeof (resetTable[0]) );
+
+    if (0 == MAXCheckRegisterConfiguration( defaultsTable, sizeof (defaultsTable) / sizeof (defaultsTable[0]) ))
+    {
+        return 0; // Couldn't read back known default values, readback test fails. 
+    }
 
-    uint8_t readRegisterResult;
+    return MAXApplyRegisterConfiguration( configTable, sizeof (configTable) / sizeof (configTable[0]) );
+}
 
-    /* Read known register values back at startup. These should be 1 on read */
-    uint8_t retryCounterA = maxRetryAttempts;
-    while (retryCounterA > 0)
+uint8_t MAXApplyRegisterConfiguration( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries )
+{
+    if (ConfigTableIsInvalid( table, numEntries ))
     {
-        readRegisterResult = 1;
-        readRegisterResult &= MAXreadRegisterValue( UART_0, max3109_DIVLSB );
-        readRegisterResult &= MAXreadRegisterValue( UART_0, max3109_PLLConfig );
-        readRegisterResult &= MAXreadRegisterValue( UART_1, max3109_DIVLSB );
-        readRegisterResult &= MAXreadRegisterValue( UART_1, max3109_PLLConfig );
+        return 0; // Error, invalid params
+    }
 
-        if (1 == readRegisterResult)
+    uint32_t pendingEntries = (MAX3109_MAX_CONFIG_ENTRIES == numEntries) ? 0xFFFFFFFFUL : ((1UL << numEntries) - 1);
+    uint8_t retryCounter = maxRetryAttempts;
+    while (retryCounter > 0)
+    {
+        MAXWriteConfigEntries( table, numEntries, pendingEntries );
+        pendingEntries = MAXReadbackConfigEntries( table, numEntries, pendingEntries );
+        if (0 == pendingEntries)
         {
-            break; // Successful readback
+            return 1;
         }
-        retryCounterA--;
+        retryCounter--;
     }
+    return 0;
+}
 
-    if (0 == retryCounterA)
+uint8_t MAXCheckRegisterConfiguration( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries )
+{
+    if (ConfigTableIsInvalid( table, numEntries ))
     {
-        return 0; // Couldn't read back known default values, readback test fails. 
+        return 0; // Error, invalid params
     }
 
-    uint8_t retryCounterB = maxRetryAttempts;
-    uint8_t isMAXstartupValid;
-    while (retryCounterB > 0)
+    uint32_t pendingEntries = (MAX3109_MAX_CONFIG_ENTRIES == numEntries) ? 0xFFFFFFFFUL : ((1UL << numEntries) - 1);
+    uint8_t retryCounter = maxRetryAttempts;
+    while (retryCounter > 0)
     {
-        isMAXstartupValid = 1;
+        pendingEntries = MAXReadbackConfigEntries( table, numEntries, pendingEntries );
+        if (0 == pendingEntries)
+        {
+            return 1;
+        }
+        retryCounter--;
+    }
+    return 0;
+}
 
-        /* Generic UART Config - these apply to both UARTs - note: generic can only be written to UART0 */
-        MAXwriteRegisterValue( UART_0, max3109CLKSource, maxClockConfig ); /* Setup clock source for both UARTS*/
-        MAXwriteRegisterValue( UART_0, max3109_PLLConfig, maxPLLConfiguration ); /* Configure BAUD rates for both UARTS */
+static bool ConfigTableIsInvalid( const MAX3109_REGISTER_CONFIG * table,
+                                  const uint8_t numEntries )
+{
+    if ((NULL == table) || (0 == numEntries) || (numEntries > MAX3109_MAX_CONFIG_ENTRIES))
+    {
+        return true;
+    }
 
-        /* UART0 Configuration */
-//        MAXwriteRegisterValue( UART_0, max3109_IRQEn, uart0InterruptEnable ); /* Setup interrupt enables */
-        MAXwriteRegisterValue( UART_0, max3109_LCR, uartLineConfig ); /* Setup start, stop, and parity configuration */
-//        MAXwriteRegisterValue( UART_0, max3109_LSRIntEn, uart0LineStatusInterruptEnable ); /* Setup Line status interrupt enable */
-//        MAXwriteRegisterValue( UART_0, max3109_RxTimeOut, uart0RxTimeout ); /* Setup receiver timeout interrupt valie */
+    uint8_t entryIndex;
+    for (entryIndex = 0; entryIndex < numEntries; entryIndex++)
+    {
+        if (UARTChannelIsInvalid( table[entryIndex].channel ))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-        /* UART1 Configuration */
-//        MAXwriteRegisterValue( UART_1, max3109_IRQEn, uart1InterruptEnable ); /* Setup interrupt enables */
-        MAXwriteRegisterValue( UART_1, max3109_LCR, uartLineConfig ); /* Setup start, stop, and parity configuration */
-//        MAXwriteRegisterValue( UART_1, max3109_LSRIntEn, uart1LineStatusInterruptEnable ); /* Setup Line status interrupt enable */
-//        MAXwriteRegisterValue( UART_1, max3109_RxTimeOut, uart1RxTimeout ); /* Setup receiver timeout interrupt valie */
+/* Number of entries from firstEntry on that one burst can cover: selected table neighbours on the same UART whose
+ * registers follow each other, as the chip auto increments every register address except the THR/RHR. The burst
+ * carries the command byte plus an odd number of data bytes, so an even run leaves its last entry to the next burst. */
+static uint8_t ConfigBurstLength( const MAX3109_REGISTER_CONFIG * table,
+                                  const uint8_t numEntries,
+                                  const uint32_t entryMask,
+                                  const uint8_t firstEntry )
+{
+    uint8_t numRunEntries = 1;
+    if (max3109_TRxHR != table[firstEntry].maxRegister)
+    {
+        while (((firstEntry + numRunEntries) < numEntries) &&
+               (entryMask & (1UL << (firstEntry + numRunEntries))) &&
+               (table[firstEntry + numRunEntries].channel == table[firstEntry].channel) &&
+               (table[firstEntry + numRunEntries].maxRegister == (table[firstEntry + numRunEntries - 1].maxRegister + 0x0100)) &&
+               (table[firstEntry + numRunEntries].maxRegister < max3109_GlobalIRQ))
+        {
+            numRunEntries++;
+        }
+    }
+    return (numRunEntries & 0x01) ? numRunEntries : (numRunEntries - 1);
+}
 
-        /* Read back all values written and verify they equal the function inputs from configuration */
-        isMAXstartupValid &= (maxClockConfig == ((MAXreadRegisterValue( UART_0, max3109CLKSource )) & CLKSourceMASK)); // Why does this read back when I wrote over it? 
-        isMAXstartupValid &= (maxPLLConfiguration == MAXreadRegisterValue( UART_0, max3109_PLLConfig ));
+/* Writes the entries selected by entryMask, one burst per run of consecutive registers, and writes them through to
+ * the shadow registers. Returns the mask of entries written */
+static uint32_t MAXWriteConfigEntries( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries,
+                                       const uint32_t entryMask )
+{
+    uint8_t numBursts = 0;
+    uint8_t numWordsSent = 0;
+    uint8_t entryIndex = 0;
+    while (entryIndex < numEntries)
+    {
+        if (0 == (entryMask & (1UL << entryIndex)))
+        {
+            entryIndex++;
+            continue;
+        }
 
-//        isMAXstartupValid &= (uart0InterruptEnable == MAXreadRegisterValue( UART_0, max3109_IRQEn ));
-        isMAXstartupValid &= (uartLineConfig == MAXreadRegisterValue( UART_0, max3109_LCR ));
-//        isMAXstartupValid &= (uart0LineStatusInterruptEnable == MAXreadRegisterValue( UART_0, max3109_LSRIntEn ));
-//        isMAXstartupValid &= (uart0RxTimeout == MAXreadRegisterValue( UART_0, max3109_RxTimeOut ));
+        /* First value shares word 0 with the command byte, then high/low value pairs */
+        uint8_t numBurstEntries = ConfigBurstLength( table, numEntries, entryMask, entryIndex );
+        uint8_t numWords = MAX3109_BURST_WORD_COUNT( numBurstEntries );
+        const MAX3109_REGISTER_CONFIG * burst = &table[entryIndex];
+        uint8_t wordIndex;
+        configWordBuffer[0] = WRITE_MAX | burst[0].channel | burst[0].maxRegister | burst[0].value;
+        for (wordIndex = 1; wordIndex < numWords; wordIndex++)
+        {
+            configWordBuffer[wordIndex] = ((uint16_t) burst[(2 * wordIndex) - 1].value << 8) | burst[2 * wordIndex].value;
+        }
+        SPIreadWriteBuffer( configWordBuffer, NULL, numWords );
+        numBursts++;
+        numWordsSent += numWords;
 
+        uint8_t burstIndex;
+        for (burstIndex = 0; burstIndex < numBurstEntries; burstIndex++)
+        {
+            MAXUpdateShadowRegister( burst[burstIndex].channel, burst[burstIndex].maxRegister, burst[burstIndex].value );
+        }
+        entryIndex += numBurstEntries;
+    }
+    MAX_STATS_SPI( statsSite_ConfigBatch, numBursts, numWordsSent );
+    return entryMask;
+}
 
-//        isMAXstartupValid &= (uart1InterruptEnable == MAXreadRegisterValue( UART_1, max3109_IRQEn ));
-        isMAXstartupValid &= (uartLineConfig == MAXreadRegisterValue( UART_1, max3109_LCR ));
-//        isMAXstartupValid &= (uart1LineStatusInterruptEnable == MAXreadRegisterValue( UART_1, max3109_LSRIntEn ));
-//        isMAXstartupValid &= (uart1RxTimeout == MAXreadRegisterValue( UART_1, max3109_RxTimeOut ));
-        
-        if (1 == isMAXstartupValid)
+/* Reads back the verified entries selected by entryMask straight from the chip, one burst per run of consecutive
+ * registers. Returns the mask of entries whose verified bits do not match */
+static uint32_t MAXReadbackConfigEntries( const MAX3109_REGISTER_CONFIG * table,
+                                          const uint8_t numEntries,
+                                          const uint32_t entryMask )
+{
+    uint32_t readMask = 0;
+    uint8_t entryIndex;
+    for (entryIndex = 0; entryIndex < numEntries; entryIndex++)
+    {
+        if ((entryMask & (1UL << entryIndex)) && (0 != table[entryIndex].verifyMask))
         {
-            break;
+            readMask |= (1UL << entryIndex);
         }
-        retryCounterB--;
     }
-    return isMAXstartupValid;
+
+    uint32_t failedEntries = 0;
+    uint8_t numBursts = 0;
+    uint8_t numWordsSent = 0;
+    entryIndex = 0;
+    while (entryIndex < numEntries)
+    {
+        if (0 == (readMask & (1UL << entryIndex)))
+        {
+            entryIndex++;
+            continue;
+        }
+
+        uint8_t numBurstEntries = ConfigBurstLength( table, numEntries, readMask, entryIndex );
+        uint8_t numWords = MAX3109_BURST_WORD_COUNT( numBurstEntries );
+        const MAX3109_REGISTER_CONFIG * burst = &table[entryIndex];
+        uint8_t wordIndex;
+        configWordBuffer[0] = READ_MAX | burst[0].channel | burst[0].maxRegister;
+        for (wordIndex = 1; wordIndex < numWords; wordIndex++)
+        {
+            configWordBuffer[wordIndex] = 0;
+        }
+        SPIreadWriteBuffer( configWordBuffer, configWordBuffer, numWords );
+        MAXUnpackBurstFromUARTRxFIFO( configWordBuffer, configByteBuffer, numBurstEntries );
+        numBursts++;
+        numWordsSent += numWords;
+
+        uint8_t burstIndex;
+        for (burstIndex = 0; burstIndex < numBurstEntries; burstIndex++)
+        {
+            if ((configByteBuffer[burstIndex] & burst[burstIndex].verifyMask) != (burst[burstIndex].value & burst[burstIndex].verifyMask))
+            {
+                failedEntries |= (1UL << (entryIndex + burstIndex));
+            }
+        }
+        entryIndex += numBurstEntries;
+    }
+    MAX_STATS_SPI( statsSite_ConfigBatch, numBursts, numWordsSent );
+    return failedEntries;
 }
 
 /* If the input UART channel is not from the enum, return true (channel IS invalid) */
@@ -129,6 +391,13 @@ static inline bool UARTChannelIsInvalid( const MAX3109_UART_SELECTION channel )
     return ( (channel != UART_0) && (channel != UART_1)) ? true : false;
 }
 
+/* Volatile registers, and the extended addresses above 0x1F that alias the channel bit, always go to the chip */
+static inline bool RegisterIsCacheable( const MAX3109_REGISTER_ADDRESS_VALUE maxRegister )
+{
+    return (maxRegister <= max3109_GlobalIRQ) &&
+            (0 == (MAX3109_VOLATILE_REGISTER_MASK & (1UL << REGISTER_INDEX( maxRegister ))));
+}
+
 /* Writes a specified 8 bit value to the user's channel and register of choice */
 static uint8_t MAXwriteRegisterValue( const MAX3109_UART_SELECTION channel,
                                       const MAX3109_REGISTER_ADDRESS_VALUE maxRegister,
@@ -141,10 +410,31 @@ static uint8_t MAXwriteRegisterValue( const MAX3109_UART_SELECTION channel,
 
     uint16_t spiMsg = WRITE_MAX | channel | maxRegister | value;
     SPIreadWriteWord( spiMsg, &dummy );
+    MAX_STATS_SPI( statsSite_RegisterWrite, 1, 1 );
+    MAXUpdateShadowRegister( channel, maxRegister, value );
     return 0;
 }
 
-/* Returns a masked 8 bit register value of the user's specified channel and register */
+/* Write through to the shadow registers. A chip reset returns every register of the UART to its default */
+static void MAXUpdateShadowRegister( const MAX3109_UART_SELECTION channel,
+                                     const MAX3109_REGISTER_ADDRESS_VALUE maxRegister,
+                                     const uint8_t value )
+{
+    uint8_t channelIndex = CHANNEL_INDEX( channel );
+    uint8_t registerIndex = REGISTER_INDEX( maxRegister );
+    if ((max3109_MODE2 == maxRegister) && (value & MODE2_RESET))
+    {
+        activeDevice->shadowValidMask[channelIndex] = 0;
+    }
+    else if (RegisterIsCacheable( maxRegister ))
+    {
+        activeDevice->shadowRegisters[channelIndex][registerIndex] = value;
+        activeDevice->shadowValidMask[channelIndex] |= (1UL << registerIndex);
+    }
+}
+
+/* Returns a masked 8 bit register value of the user's specified channel and register. Non volatile registers
+ * are served from the shadow registers once they have been written or read */
 static uint8_t MAXreadRegisterValue( const MAX3109_UART_SELECTION channel,
                                      const MAX3109_REGISTER_ADDRESS_VALUE maxRegister )
 {
@@ -153,9 +443,35 @@ static uint8_t MAXreadRegisterValue( const MAX3109_UART_SELECTION channel,
         return 1; // Error, invalid params - how to make this more obvious of an error? 1 could be a register value, can't tell. 
     }
 
+    uint8_t channelIndex = CHANNEL_INDEX( channel );
+    uint8_t registerIndex = REGISTER_INDEX( maxRegister );
+    uint32_t registerBit = 1UL << registerIndex;
+    if (!RegisterIsCacheable( maxRegister ))
+    {
+        return MAXreadRegisterValueFromChip( channel, maxRegister );
+    }
+
+    if (0 == (activeDevice->shadowValidMask[channelIndex] & registerBit))
+    {
+        activeDevice->shadowRegisters[channelIndex][registerIndex] = MAXreadRegisterValueFromChip( channel, maxRegister );
+        activeDevice->shadowValidMask[channelIndex] |= registerBit;
+    }
+    return activeDevice->shadowRegisters[channelIndex][registerIndex];
+}
+
+/* Always reads over SPI - used for volatile registers and for readback verification of written values */
+static uint8_t MAXreadRegisterValueFromChip( const MAX3109_UART_SELECTION channel,
+                                             const MAX3109_REGISTER_ADDRESS_VALUE maxRegister )
+{
+    if (UARTChannelIsInvalid( channel ))
+    {
+        return 1; // Error, invalid params
+    }
+
     uint16_t spiMsg = READ_MAX | channel | maxRegister;
     uint16_t registerValue;
     SPIreadWriteWord( spiMsg, &registerValue );
+    MAX_STATS_SPI( statsSite_RegisterRead, 1, 1 );
     uint8_t readValue = registerValue & 0xFF;
     return (uint8_t) readValue; // TODO verify this type cast is required.. 
 }
@@ -163,6 +479,103 @@ static uint8_t MAXreadRegisterValue( const MAX3109_UART_SELECTION channel,
 
 /* Basic FIFO Implementations */
 
+/* Pops up to numBytes values from the UART RxFIFO into dst using burst reads of the RHR. Returns the number of bytes
+ * read, 0 on error. The caller must not request more bytes than the RxFIFO level reports, as every clocked byte pops the FIFO. */
+uint8_t MAXPopBurstFromUARTRxFIFO( const MAX3109_UART_SELECTION channel,
+                                   uint8_t * dst,
+                                   const uint8_t numBytes )
+{
+    if ((UARTChannelIsInvalid( channel )) ||
+        (NULL == dst) ||
+        (0 == numBytes) ||
+        (numBytes > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t numBurstBytes = (numBytes & 0x01) ? numBytes : (numBytes - 1); // Command + odd byte count fills whole words
+    uint8_t numWords = MAXPackBurstReadCommand( channel, burstWordBuffer, numBurstBytes );
+    SPIreadWriteBuffer( burstWordBuffer, burstWordBuffer, numWords );
+    MAX_STATS_SPI( statsSite_RxBurst, 1, numWords );
+    MAXUnpackBurstFromUARTRxFIFO( burstWordBuffer, dst, numBurstBytes );
+
+    if (numBurstBytes != numBytes)
+    {
+        dst[numBurstBytes] = MAXReadRegisterCommand( MAX3109_REGISTER_COMMAND( READ_MAX, max3109_TRxHR ) | channel );
+    }
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), numBytes, 0 );
+    return numBytes;
+}
+
+/* Same burst as MAXPopBurstFromUARTRxFIFO, clocked by the SPIAsync engine instead of busy waiting. An even request
+ * cannot be completed by a trailing single read here, so it is rounded down and the last byte stays in the FIFO. */
+uint8_t MAXQueuePopBurstFromUARTRxFIFO( const MAX3109_UART_SELECTION channel,
+                                        uint16_t * wordBuffer,
+                                        const uint8_t numBytes,
+                                        SPI_COMPLETION_CALLBACK onComplete,
+                                        void * context )
+{
+    if ((UARTChannelIsInvalid( channel )) ||
+        (NULL == wordBuffer) ||
+        (0 == numBytes) ||
+        (numBytes > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t numBurstBytes = (numBytes & 0x01) ? numBytes : (numBytes - 1);
+    SPI_TRANSACTION transaction;
+    transaction.writeData = wordBuffer;
+    transaction.readData = wordBuffer;
+    transaction.numWords = MAXPackBurstReadCommand( channel, wordBuffer, numBurstBytes );
+    transaction.chipSelectLine = SPIGetChipSelectLine( );
+    transaction.onComplete = onComplete;
+    transaction.context = context;
+
+    if (0 != SPIAsyncEnqueue( &transaction ))
+    {
+        return 0;
+    }
+    MAX_STATS_SPI( statsSite_AsyncRxBurst, 1, transaction.numWords );
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), numBurstBytes, 0 );
+    return numBurstBytes;
+}
+
+/* First data byte is the low byte of word 0, then high/low byte pairs of the following words */
+void MAXUnpackBurstFromUARTRxFIFO( const uint16_t * wordBuffer,
+                                   uint8_t * dst,
+                                   const uint8_t numBytes )
+{
+    if ((NULL == wordBuffer) || (NULL == dst) || (0 == numBytes))
+    {
+        return;
+    }
+
+    uint8_t byteIndex;
+    dst[0] = (uint8_t) (wordBuffer[0] & 0xFF);
+    for (byteIndex = 1; byteIndex < numBytes; byteIndex++)
+    {
+        uint16_t word = wordBuffer[(byteIndex + 1) / 2];
+        dst[byteIndex] = (byteIndex & 0x01) ? (uint8_t) (word >> 8) : (uint8_t) (word & 0xFF);
+    }
+}
+
+/* Fills wordBuffer with an RHR read command followed by zero words to clock out numBurstBytes (odd). Returns the word count */
+static uint8_t MAXPackBurstReadCommand( const MAX3109_UART_SELECTION channel,
+                                        uint16_t * wordBuffer,
+                                        const uint8_t numBurstBytes )
+{
+    uint8_t numWords = MAX3109_BURST_WORD_COUNT( numBurstBytes );
+    uint8_t wordIndex;
+
+    wordBuffer[0] = READ_MAX | channel | max3109_TRxHR;
+    for (wordIndex = 1; wordIndex < numWords; wordIndex++)
+    {
+        wordBuffer[wordIndex] = 0;
+    }
+    return numWords;
+}
+
 /* Pops a single value from the UART RxFIFO. CAREFUL - popping value while receiving can cause a double. Possibly disable while w/r-ing !!!!! */
 uint8_t MAXPopSingleValueFromUARTRxFIFO( const MAX3109_UART_SELECTION channel )
 {
@@ -170,10 +583,177 @@ uint8_t MAXPopSingleValueFromUARTRxFIFO( const MAX3109_UART_SELECTION channel )
     {
         return 1; // Error, invalid params 
     }
-    uint8_t dataFromBuffer = MAXreadRegisterValue( channel, max3109_TRxHR );
+    uint8_t dataFromBuffer = MAXReadRegisterCommand( MAX3109_REGISTER_COMMAND( READ_MAX, max3109_TRxHR ) | channel );
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), 1, 0 );
     return dataFromBuffer;
 }
 
+/* Pushes numBytes values from src into the UART TxFIFO using burst writes of the THR. Returns the number of bytes
+ * written, 0 on error. The caller is responsible for not exceeding the free space reported by the TxFIFO level. */
+uint8_t MAXPushBurstToUARTTxFIFO( const MAX3109_UART_SELECTION channel,
+                                  const uint8_t * src,
+                                  const uint8_t numBytes )
+{
+    if ((UARTChannelIsInvalid( channel )) ||
+        (NULL == src) ||
+        (0 == numBytes) ||
+        (numBytes > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t numBurstBytes = (numBytes & 0x01) ? numBytes : (numBytes - 1); // Command + odd byte count fills whole words
+    uint8_t numWords = MAX3109_BURST_WORD_COUNT( numBurstBytes );
+    uint8_t wordIndex;
+
+    /* First data byte shares word 0 with the command byte, then high/low byte pairs */
+    burstWordBuffer[0] = WRITE_MAX | channel | max3109_TRxHR | src[0];
+    for (wordIndex = 1; wordIndex < numWords; wordIndex++)
+    {
+        burstWordBuffer[wordIndex] = ((uint16_t) src[(2 * wordIndex) - 1] << 8) | src[2 * wordIndex];
+    }
+    SPIreadWriteBuffer( burstWordBuffer, NULL, numWords );
+    MAX_STATS_SPI( statsSite_TxBurst, 1, numWords );
+
+    if (numBurstBytes != numBytes)
+    {
+        MAXWriteRegisterCommand( MAX3109_REGISTER_COMMAND( WRITE_MAX, max3109_TRxHR ) | channel, src[numBurstBytes] );
+    }
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), 0, numBytes );
+    return numBytes;
+}
+
+uint8_t MAXInitializeTxGather( MAX3109_TX_GATHER * gather,
+                               const MAX3109_TX_FRAGMENT * fragments,
+                               const uint8_t numFragments )
+{
+    if ((NULL == gather) ||
+        ((NULL == fragments) && (0 != numFragments)))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint32_t numBytes = 0;
+    uint8_t fragmentIndex;
+    for (fragmentIndex = 0; fragmentIndex < numFragments; fragmentIndex++)
+    {
+        if ((false == fragments[fragmentIndex].isChecksumTrailer) &&
+            (NULL == fragments[fragmentIndex].data) &&
+            (0 != fragments[fragmentIndex].numBytes))
+        {
+            return 0;
+        }
+        numBytes += GatherFragmentLength( &fragments[fragmentIndex] );
+    }
+
+    gather->fragments = fragments;
+    gather->numFragments = numFragments;
+    gather->fragmentIndex = 0;
+    gather->fragmentOffset = 0;
+    gather->numBytesRemaining = numBytes;
+    gather->checksum = 0;
+    return 1;
+}
+
+/* Same burst layout as MAXPushBurstToUARTTxFIFO, filled fragment by fragment. A checksum trailer is packed as it is
+ * reached, so it holds every checksummed byte before it, including those sent by earlier refills. */
+uint8_t MAXPushGatherToUARTTxFIFO( const MAX3109_UART_SELECTION channel,
+                                   MAX3109_TX_GATHER * gather,
+                                   const uint8_t numBytes )
+{
+    if ((UARTChannelIsInvalid( channel )) ||
+        (NULL == gather) ||
+        (numBytes > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t numBytesToSend = (gather->numBytesRemaining < numBytes) ? (uint8_t) gather->numBytesRemaining : numBytes;
+    if (0 == numBytesToSend)
+    {
+        return 0;
+    }
+
+    uint8_t checksum = gather->checksum;
+    uint8_t bytePosition = 0;
+    burstWordBuffer[0] = WRITE_MAX | channel | max3109_TRxHR;
+    while (bytePosition < numBytesToSend)
+    {
+        const MAX3109_TX_FRAGMENT * fragment = &gather->fragments[gather->fragmentIndex];
+        if (fragment->isChecksumTrailer)
+        {
+            PackGatherByte( bytePosition++, checksum );
+            gather->fragmentIndex++;
+            continue;
+        }
+
+        const uint8_t * src = fragment->data + gather->fragmentOffset;
+        uint16_t runLength = fragment->numBytes - gather->fragmentOffset;
+        if (runLength > (uint16_t) (numBytesToSend - bytePosition))
+        {
+            runLength = numBytesToSend - bytePosition;
+        }
+
+        uint16_t runIndex;
+        for (runIndex = 0; runIndex < runLength; runIndex++, bytePosition++)
+        {
+            PackGatherByte( bytePosition, src[runIndex] );
+        }
+        if (fragment->isChecksummed)
+        {
+            for (runIndex = 0; runIndex < runLength; runIndex++)
+            {
+                checksum ^= src[runIndex];
+            }
+        }
+
+        gather->fragmentOffset += runLength;
+        if (gather->fragmentOffset >= fragment->numBytes)
+        {
+            gather->fragmentIndex++;
+            gather->fragmentOffset = 0;
+        }
+    }
+
+    /* Command + odd byte count fills whole words, an even count sends its last byte on its own */
+    uint8_t numBurstBytes = (numBytesToSend & 0x01) ? numBytesToSend : (numBytesToSend - 1);
+    uint8_t numWords = MAX3109_BURST_WORD_COUNT( numBurstBytes );
+    SPIreadWriteBuffer( burstWordBuffer, NULL, numWords );
+    MAX_STATS_SPI( statsSite_TxBurst, 1, numWords );
+
+    if (numBurstBytes != numBytesToSend)
+    {
+        MAXWriteRegisterCommand( MAX3109_REGISTER_COMMAND( WRITE_MAX, max3109_TRxHR ) | channel,
+                                 (uint8_t) (burstWordBuffer[numWords] >> 8) );
+    }
+
+    gather->checksum = checksum;
+    gather->numBytesRemaining -= numBytesToSend;
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), 0, numBytesToSend );
+    return numBytesToSend;
+}
+
+/* A checksum trailer is one byte whatever its numBytes says */
+static inline uint16_t GatherFragmentLength( const MAX3109_TX_FRAGMENT * fragment )
+{
+    return (fragment->isChecksumTrailer) ? 1 : fragment->numBytes;
+}
+
+/* An odd byte position starts a new burst word with its high byte and the following even position fills the low
+ * byte - byte 0 shares word 0 with the command. */
+static inline void PackGatherByte( const uint8_t bytePosition,
+                                   const uint8_t value )
+{
+    if (bytePosition & 0x01)
+    {
+        burstWordBuffer[(bytePosition + 1) >> 1] = (uint16_t) value << 8;
+    }
+    else
+    {
+        burstWordBuffer[bytePosition >> 1] |= value;
+    }
+}
+
 /* Writes a single value to the desired UART TxFIFO*/
 uint8_t MAXPushSingleValueToUARTTxFIFO( const MAX3109_UART_SELECTION channel,
                                         const uint8_t valueToWrite )
@@ -182,7 +762,9 @@ uint8_t MAXPushSingleValueToUARTTxFIFO( const MAX3109_UART_SELECTION channel,
     {
         return 1; // Error, invalid params 
     }
-    return MAXwriteRegisterValue( channel, max3109_TRxHR, valueToWrite ); // matches writeRegVal return val: 1 is failure, 0 is success
+    MAX_STATS_BYTES( CHANNEL_INDEX( channel ), 0, 1 );
+    MAXWriteRegisterCommand( MAX3109_REGISTER_COMMAND( WRITE_MAX, max3109_TRxHR ) | channel, valueToWrite );
+    return 0; // matches writeRegVal return val: 1 is failure, 0 is success
 }
 
 /* Returns the FIFO fill level of the desired transmit or receive buffer, at the desired UART port */
@@ -198,11 +780,96 @@ uint8_t MAXGetUARTFIFOLevel( const MAX3109_UART_SELECTION channel,
         return 0xFF; // Invalid desired register address - should only be fifo fill levels
     }
 
-    uint8_t fifoLevel = MAXreadRegisterValue( channel, fifoBuffer );
-    fifoLevel = (fifoLevel > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES) ? 0xFF : fifoLevel;
+    uint8_t fifoLevel = (max3109_RxFIFOLvl == fifoBuffer) ?
+            MAXReadRegisterCommand( MAX3109_REGISTER_COMMAND( READ_MAX, max3109_RxFIFOLvl ) | channel ) :
+            MAXReadRegisterCommand( MAX3109_REGISTER_COMMAND( READ_MAX, max3109_TxFIFOLvl ) | channel );
+    if (fifoLevel > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES)
+    {
+        MAX_STATS_FIFO_LEVEL_ERROR( CHANNEL_INDEX( channel ) );
+        return 0xFF; // A level past the FIFO size is a bad read, not a fill level
+    }
+    MAX_STATS_FIFO_LEVEL( CHANNEL_INDEX( channel ), (max3109_RxFIFOLvl == fifoBuffer), fifoLevel );
     return fifoLevel;
 }
 
+/* Programs the RxFIFO trigger level and receive timeout, routes both to the IRQ pin, and verifies by readback.
+ * The Tx trigger nibble of FIFOTrgLvl is left at zero. */
+uint8_t MAXConfigureReceiveInterrupts( const MAX3109_UART_SELECTION channel,
+                                       const uint8_t rxTriggerLevelBytes,
+                                       const uint8_t rxTimeoutCharacters )
+{
+    uint8_t triggerSteps = rxTriggerLevelBytes / FIFO_TRIGGER_LEVEL_STEP;
+    if ((UARTChannelIsInvalid( channel )) ||
+        (0 != (rxTriggerLevelBytes % FIFO_TRIGGER_LEVEL_STEP)) ||
+        (0 == triggerSteps) ||
+        (triggerSteps > 0x0F))
+    {
+        return 0; // Error, invalid params
+    }
+
+    const MAX3109_REGISTER_CONFIG interruptTable[] = {
+        { channel, max3109_FIFOTrgLvl, (uint8_t) (triggerSteps << 4), 0xFF },
+        { channel, max3109_RxTimeOut, rxTimeoutCharacters, 0xFF },
+        { channel, max3109_LSRIntEn, (0 == rxTimeoutCharacters) ? 0 : LSR_RX_TIMEOUT, 0xFF },
+        { channel, max3109_IRQEn, max3109_IRQ_RFifoTrg | ((0 == rxTimeoutCharacters) ? 0 : max3109_IRQ_LSRErr), 0xFF },
+        { channel, max3109_MODE1, MAXreadRegisterValue( channel, max3109_MODE1 ) | MODE1_IRQ_PIN_ENABLE, 0xFF }
+    };
+
+    uint8_t isConfigValid = MAXApplyRegisterConfiguration( interruptTable, sizeof (interruptTable) / sizeof (interruptTable[0]) );
+
+    /* Clear anything latched before the interrupts were enabled */
+    MAXAcknowledgeUARTInterrupt( channel );
+    return isConfigValid;
+}
+
+uint8_t MAXConfigureFlowControl( const MAX3109_UART_SELECTION channel,
+                                 const uint8_t haltLevelBytes,
+                                 const uint8_t resumeLevelBytes,
+                                 const bool isAutoRTSEnabled,
+                                 const bool isAutoCTSEnabled )
+{
+    uint8_t haltSteps = haltLevelBytes / FLOW_LEVEL_STEP;
+    uint8_t resumeSteps = resumeLevelBytes / FLOW_LEVEL_STEP;
+    if ((UARTChannelIsInvalid( channel )) ||
+        (0 != (haltLevelBytes % FLOW_LEVEL_STEP)) ||
+        (0 != (resumeLevelBytes % FLOW_LEVEL_STEP)) ||
+        (haltSteps > 0x0F) ||
+        (resumeSteps >= haltSteps))
+    {
+        return 0; // Error, invalid params
+    }
+
+    /* Thresholds first, so auto RTS never acts on the reset levels */
+    const MAX3109_REGISTER_CONFIG flowTable[] = {
+        { channel, max3109_FlowLvl, (uint8_t) ((resumeSteps << 4) | haltSteps), 0xFF },
+        { channel, max3109_FlowCtrl, (uint8_t) ((isAutoRTSEnabled ? FLOWCTRL_AUTO_RTS : 0) | (isAutoCTSEnabled ? FLOWCTRL_AUTO_CTS : 0)), 0xFF }
+    };
+    return MAXApplyRegisterConfiguration( flowTable, sizeof (flowTable) / sizeof (flowTable[0]) );
+}
+
+/* A single read of GlobalIRQ covers both UARTs. The register is active low, so invert it */
+uint8_t MAXGetPendingInterruptUARTs( void )
+{
+    uint8_t globalIRQ = MAX3109_READ_REGISTER( UART_0, max3109_GlobalIRQ );
+    return (uint8_t) (~globalIRQ) & (MAX3109_PENDING_UART_0 | MAX3109_PENDING_UART_1);
+}
+
+/* Reading ISR_Status clears it. A line status interrupt (receive timeout) also needs the LSR read to clear */
+uint8_t MAXAcknowledgeUARTInterrupt( const MAX3109_UART_SELECTION channel )
+{
+    if (UARTChannelIsInvalid( channel ))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t interruptStatus = MAXreadRegisterValue( channel, max3109_ISR_Status );
+    if (interruptStatus & max3109_IRQ_LSRErr)
+    {
+        MAXreadRegisterValue( channel, max3109_LSR );
+    }
+    return interruptStatus;
+}
+
 /* Reads the receiver timeout status and fifo empty flag. The user can read the receive
  buffer if BOTH a receiver timeout has occurred and there is data in the UART. This condition,
  based on our available knowledge, will avoid the problem of reading out data while receiving 
@@ -220,4 +887,204 @@ bool MAXIsUARTReceiveReadyToRead( const MAX3109_UART_SELECTION channel )
     bool IsRxTimeout = (0x01 == (MAXreadRegisterValue( channel, max3109_LSR ) & 0x01)) ? true : false;
 
     return ( (true == DoesRxFIFOHaveData) && (true == IsRxTimeout));
+}
+
+/* The clock and divider registers are non volatile, so after the first call these come from the shadow registers.
+ * fREF is the crystal or external clock, divided by PreDiv and multiplied by the PLL factor unless the PLL is bypassed.
+ * Baud = fREF / (16 * DIV + FRACT) in 1x mode, doubled in 2x mode and quadrupled in 4x mode. */
+uint32_t MAXGetUARTBaudRate( const MAX3109_UART_SELECTION channel,
+                             const uint32_t referenceClockHz )
+{
+    if ((UARTChannelIsInvalid( channel )) || (0 == referenceClockHz))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint32_t fREF = referenceClockHz;
+    uint8_t clockSource = MAXreadRegisterValue( UART_0, max3109CLKSource ); // Global register, UART0 only
+    if ((clockSource & MAX3109_CLKSOURCE_PLL_ENABLE) && (0 == (clockSource & MAX3109_CLKSOURCE_PLL_BYPASS)))
+    {
+        uint8_t pllConfig = MAXreadRegisterValue( UART_0, max3109_PLLConfig );
+        uint8_t preDivider = pllConfig & MAX3109_PLLCONFIG_PREDIV_MASK;
+        if (0 == preDivider)
+        {
+            return 0; // PreDiv of 0 is not a valid setting
+        }
+        fREF = PLLOutputHz( referenceClockHz, pllConfig );
+    }
+
+    uint8_t brgConfig = MAXreadRegisterValue( channel, max3109_BRGConfig );
+    uint32_t divisor = ((((uint32_t) MAXreadRegisterValue( channel, max3109_DIVMSB ) << 8) |
+                         MAXreadRegisterValue( channel, max3109_DIVLSB )) * 16) + (brgConfig & MAX3109_BRGCONFIG_FRACT_MASK);
+    if (0 == divisor)
+    {
+        return 0;
+    }
+
+    if (brgConfig & MAX3109_BRGCONFIG_4X_MODE)
+    {
+        fREF *= 4;
+    }
+    else if (brgConfig & MAX3109_BRGCONFIG_2X_MODE)
+    {
+        fREF *= 2;
+    }
+    return fREF / divisor;
+}
+
+/* Start bit, 5 to 8 data bits, optional parity and 1 or 2 stop bits as set in the LCR. 1.5 stop bits count as 2. */
+uint8_t MAXGetUARTBitsPerCharacter( const MAX3109_UART_SELECTION channel )
+{
+    if (UARTChannelIsInvalid( channel ))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t lineConfig = MAXreadRegisterValue( channel, max3109_LCR );
+    uint8_t numBits = 1 + 5 + (lineConfig & LCR_LENGTH_MASK);
+    numBits += (lineConfig & LCR_PARITY_ENABLE) ? 1 : 0;
+    numBits += (lineConfig & LCR_STOP_BITS) ? 2 : 1;
+    return numBits;
+}
+
+/* Candidate fREFs are the clock itself (PLL bypassed) and every PLL factor and PreDiv pair that keeps the PLL input
+ * (clock / PreDiv) inside the range of that factor and fREF at or below MAX3109_MAXIMUM_FREF_HZ. For each one the
+ * 1x, 2x or 4x rate mode and 16 * DIV + FRACT divisor with the lowest error is picked. A PLL setting only replaces
+ * the bypass if it is strictly better. */
+uint8_t MAXSolveBaudRate( const uint32_t clockHz,
+                          const bool isExternalClock,
+                          const uint32_t targetBaud,
+                          MAX3109_BAUD_SETTINGS * settings )
+{
+    if ((NULL == settings) || (0 == clockHz) || (0 == targetBaud))
+    {
+        return 0; // Error, invalid params
+    }
+
+    uint8_t clockInput = (isExternalClock) ? MAX3109_CLKSOURCE_EXTERNAL_CLOCK : MAX3109_CLKSOURCE_CRYSTAL_ENABLE;
+    bool isSolved = false;
+    uint32_t bestError = 0;
+    MAX3109_BAUD_SETTINGS candidate;
+
+    candidate.clockSource = clockInput | MAX3109_CLKSOURCE_PLL_BYPASS;
+    candidate.pllConfig = MAX3109_PLL_CONFIG( 0, 1 ); // Reset value
+    if (MAXSolveBaudDivisor( clockHz, targetBaud, &candidate ))
+    {
+        *settings = candidate;
+        settings->isClockIncluded = true;
+        bestError = BaudError( candidate.actualBaud, targetBaud );
+        isSolved = true;
+    }
+
+    uint8_t factorCode;
+    uint8_t preDivider;
+    for (factorCode = 0; factorCode < 4; factorCode++)
+    {
+        for (preDivider = 1; preDivider <= MAX3109_PLLCONFIG_PREDIV_MASK; preDivider++)
+        {
+            if (isSolved && (0 == bestError))
+            {
+                return 1;
+            }
+
+            uint32_t pllInputHz = clockHz / preDivider;
+            if ((pllInputHz < pllInputMinimumHz[factorCode]) || (pllInputHz > pllInputMaximumHz[factorCode]))
+            {
+                continue;
+            }
+
+            candidate.clockSource = clockInput | MAX3109_CLKSOURCE_PLL_ENABLE;
+            candidate.pllConfig = MAX3109_PLL_CONFIG( factorCode, preDivider );
+            if ((MAXSolveBaudDivisor( PLLOutputHz( clockHz, candidate.pllConfig ), targetBaud, &candidate )) &&
+                ((false == isSolved) || (BaudError( candidate.actualBaud, targetBaud ) < bestError)))
+            {
+                *settings = candidate;
+                settings->isClockIncluded = true;
+                bestError = BaudError( candidate.actualBaud, targetBaud );
+                isSolved = true;
+            }
+        }
+    }
+    return (isSolved) ? 1 : 0;
+}
+
+/* Only fills in the BRGConfig, DIVLSB, DIVMSB, referenceHz and actualBaud fields and clears isClockIncluded - the clock
+ * fields are left as they are */
+uint8_t MAXSolveBaudDivisor( const uint32_t referenceHz,
+                             const uint32_t targetBaud,
+                             MAX3109_BAUD_SETTINGS * settings )
+{
+    if ((NULL == settings) || (0 == referenceHz) || (referenceHz > MAX3109_MAXIMUM_FREF_HZ) || (0 == targetBaud))
+    {
+        return 0; // Error, invalid params
+    }
+
+    static const uint8_t modeBits[3] = { 0, MAX3109_BRGCONFIG_2X_MODE, MAX3109_BRGCONFIG_4X_MODE };
+    bool isSolved = false;
+    uint32_t bestError = 0;
+    uint8_t modeIndex;
+    for (modeIndex = 0; modeIndex < 3; modeIndex++)
+    {
+        uint32_t modeReferenceHz = referenceHz << modeIndex; // 2x mode doubles and 4x mode quadruples the rate
+        uint32_t divisorX16 = (modeReferenceHz + (targetBaud / 2)) / targetBaud; // 16 * DIV + FRACT
+        if ((divisorX16 < 16) || (divisorX16 > (((uint32_t) MAX3109_MAXIMUM_BAUD_DIVISOR << 4) | MAX3109_BRGCONFIG_FRACT_MASK)))
+        {
+            continue; // DIV must be 1 to 65535
+        }
+
+        uint32_t actualBaud = modeReferenceHz / divisorX16;
+        if ((false == isSolved) || (BaudError( actualBaud, targetBaud ) < bestError))
+        {
+            settings->brgConfig = modeBits[modeIndex] | (divisorX16 & MAX3109_BRGCONFIG_FRACT_MASK);
+            settings->divLSB = (uint8_t) (divisorX16 >> 4);
+            settings->divMSB = (uint8_t) (divisorX16 >> 12);
+            settings->referenceHz = referenceHz;
+            settings->actualBaud = actualBaud;
+            settings->isClockIncluded = false;
+            bestError = BaudError( actualBaud, targetBaud );
+            isSolved = true;
+        }
+    }
+    return (isSolved) ? 1 : 0;
+}
+
+/* PLLConfig and CLKSource are global, so they are written through UART0 and apply to both UARTs. Divisor only settings
+ * skip them and leave the running clock alone. */
+uint8_t MAXConfigureBaudRate( const MAX3109_UART_SELECTION channel,
+                              const MAX3109_BAUD_SETTINGS * settings )
+{
+    if ((UARTChannelIsInvalid( channel )) || (NULL == settings))
+    {
+        return 0; // Error, invalid params
+    }
+
+    /* In register order, so on UART_0 PLLConfig to CLKSource is a single burst. The clock source switches last, once
+     * the PLL and the divisor are set up. */
+    const MAX3109_REGISTER_CONFIG baudTable[] = {
+        { UART_0, max3109_PLLConfig, settings->pllConfig, 0xFF },
+        { channel, max3109_BRGConfig, settings->brgConfig, BRGCONFIG_READBACK_MASK },
+        { channel, max3109_DIVLSB, settings->divLSB, 0xFF },
+        { channel, max3109_DIVMSB, settings->divMSB, 0xFF },
+        { UART_0, max3109CLKSource, settings->clockSource, CLKSourceMASK }
+    };
+    const uint8_t numDivisorEntries = 3; // BRGConfig to DIVMSB
+    if (false == settings->isClockIncluded)
+    {
+        return MAXApplyRegisterConfiguration( &baudTable[1], numDivisorEntries );
+    }
+    return MAXApplyRegisterConfiguration( baudTable, sizeof (baudTable) / sizeof (baudTable[0]) );
+}
+
+static uint32_t PLLOutputHz( const uint32_t clockHz,
+                             const uint8_t pllConfig )
+{
+    uint8_t preDivider = pllConfig & MAX3109_PLLCONFIG_PREDIV_MASK;
+    uint8_t multiplier = pllMultipliers[pllConfig >> MAX3109_PLLCONFIG_FACTOR_SHIFT];
+    return ((clockHz / preDivider) * multiplier) + (((clockHz % preDivider) * multiplier) / preDivider); // Exact without overflow
+}
+
+static inline uint32_t BaudError( const uint32_t actualBaud,
+                                  const uint32_t targetBaud )
+{
+    return (actualBaud > targetBaud) ? (actualBaud - targetBaud) : (targetBaud - actualBaud);
 }
\ No newline at end of file
@@ -10,9 +10,14 @@ Description: Typedefs and generic parameters for the MAX3109 SPI to UART chip. D
 #define MAX_3109_H
 #include <stdint.h>
 #include<stdbool.h>
+#include "SPITransport.h"
+#include "SPIAsync.h"
 
 #define MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES 128 
 
+/* Number of 16 bit SPI words in a FIFO burst of numBytes data bytes (odd) - the command byte shares the first word */
+#define MAX3109_BURST_WORD_COUNT(numBytes) (((numBytes) / 2) + 1)
+
 /* Register addresses all configured in 16bit SPI mode */
 typedef enum MAX3109_REGISTER_ADDRESS_VALUE_t {
     max3109_TRxHR = 0x0000, // Transmitter and Receiver Hold Register
@@ -34,6 +39,7 @@ typedef enum MAX3109_REGISTER_ADDRESS_VALUE_t {
     max3109_FIFOTrgLvl = 0x1000,
     max3109_TxFIFOLvl = 0x1100,
     max3109_RxFIFOLvl = 0x1200,
+    max3109_FlowCtrl = 0x1300,
     max3109_PLLConfig = 0x1A00,
     max3109_BRGConfig = 0x1B00,
     max3109_DIVLSB = 0x1C00,
@@ -55,12 +61,138 @@ typedef enum UART_SELECTION_t {
     UART_1 = 0x2000,
 } MAX3109_UART_SELECTION;
 
+/* Interrupt sources - same bit positions in IRQEn (enable) and ISR_Status (status, cleared on read) */
+typedef enum MAX3109_INTERRUPT_BIT_t {
+    max3109_IRQ_LSRErr = 0x01, // Line status interrupt, includes the receive timeout
+    max3109_IRQ_SpclChr = 0x02,
+    max3109_IRQ_STS = 0x04,
+    max3109_IRQ_RFifoTrg = 0x08, // RxFIFO fill level reached the trigger level
+    max3109_IRQ_TFifoTrg = 0x10,
+    max3109_IRQ_TFifoEmpty = 0x20,
+    max3109_IRQ_RFifoEmpty = 0x40,
+    max3109_IRQ_CTS = 0x80
+} MAX3109_INTERRUPT_BIT;
+
+/* GlobalIRQ is active low in hardware - MAXGetPendingInterruptUARTs returns these active high */
+#define MAX3109_PENDING_UART_0 0x01
+#define MAX3109_PENDING_UART_1 0x02
+
+/* Clock source, PLL and baud rate generator register bits */
+#define MAX3109_CLKSOURCE_CRYSTAL_ENABLE 0x02
+#define MAX3109_CLKSOURCE_PLL_ENABLE 0x04
+#define MAX3109_CLKSOURCE_PLL_BYPASS 0x08
+#define MAX3109_CLKSOURCE_EXTERNAL_CLOCK 0x10
+#define MAX3109_PLLCONFIG_PREDIV_MASK 0x3F // PreDiv 1 - 63
+#define MAX3109_PLLCONFIG_FACTOR_SHIFT 6 // Factor code 0 - 3 is a PLL factor of 6, 48, 96 or 144
+#define MAX3109_BRGCONFIG_FRACT_MASK 0x0F
+#define MAX3109_BRGCONFIG_2X_MODE 0x10
+#define MAX3109_BRGCONFIG_4X_MODE 0x20
+#define MAX3109_MAXIMUM_FREF_HZ 96000000UL // 24 Mbaud in 4x mode
+#define MAX3109_MAXIMUM_BAUD_DIVISOR 0xFFFF
+
+#define MAX3109_PLL_CONFIG(factorCode, preDivider) ((uint8_t) (((factorCode) << MAX3109_PLLCONFIG_FACTOR_SHIFT) | \
+                                                               ((preDivider) & MAX3109_PLLCONFIG_PREDIV_MASK)))
+
+/* Compile time baud rate generator settings for a known fREF in 1x mode, rounded to the nearest divisor. 
+ * Baud = fREF / (16 * DIV + FRACT). Check MAX3109_BRG_ACTUAL_BAUD against the target when choosing a crystal. */
+#define MAX3109_BRG_DIVISOR_X16(fREF, baud) (((fREF) + ((baud) / 2)) / (baud))
+#define MAX3109_BRG_FRACT(fREF, baud) ((uint8_t) (MAX3109_BRG_DIVISOR_X16(fREF, baud) & MAX3109_BRGCONFIG_FRACT_MASK))
+#define MAX3109_BRG_DIVLSB(fREF, baud) ((uint8_t) ((MAX3109_BRG_DIVISOR_X16(fREF, baud) >> 4) & 0xFF))
+#define MAX3109_BRG_DIVMSB(fREF, baud) ((uint8_t) ((MAX3109_BRG_DIVISOR_X16(fREF, baud) >> 12) & 0xFF))
+#define MAX3109_BRG_ACTUAL_BAUD(fREF, baud) ((fREF) / MAX3109_BRG_DIVISOR_X16(fREF, baud))
+
+/* Register settings for one baud rate, as produced by MAXSolveBaudRate or MAX3109_BAUD_SETTINGS_1X */
+typedef struct MAX3109_BAUD_SETTINGS_t {
+    uint8_t clockSource;
+    uint8_t pllConfig;
+    uint8_t brgConfig;
+    uint8_t divLSB;
+    uint8_t divMSB;
+    uint32_t referenceHz; // fREF after the PLL
+    uint32_t actualBaud;
+    bool isClockIncluded; // clockSource and pllConfig are valid - false for settings from MAXSolveBaudDivisor
+} MAX3109_BAUD_SETTINGS;
+
+/* Constant initializer, e.g. static const MAX3109_BAUD_SETTINGS gpsBaud = MAX3109_BAUD_SETTINGS_1X( clockSource,
+ * MAX3109_PLL_CONFIG( 0, 1 ), 3686400UL, 115200UL ); */
+#define MAX3109_BAUD_SETTINGS_1X(clockSource, pllConfig, fREF, baud) \
+    { (clockSource), (pllConfig), MAX3109_BRG_FRACT(fREF, baud), MAX3109_BRG_DIVLSB(fREF, baud), \
+      MAX3109_BRG_DIVMSB(fREF, baud), (fREF), MAX3109_BRG_ACTUAL_BAUD(fREF, baud), true }
+
+/* One (pointer, length) piece of an outgoing message, e.g. header, payload and trailer */
+typedef struct MAX3109_TX_FRAGMENT_t {
+    const uint8_t * data;
+    uint16_t numBytes;
+    bool isChecksummed; // Bytes are XORed into the gather's running checksum as they are sent
+    bool isChecksumTrailer; // Sends the running checksum as one byte when the gather reaches it - data and numBytes unused
+} MAX3109_TX_FRAGMENT;
+
+/* Progress through a fragment array, so a message larger than the free TxFIFO space spans several refills.
+ * Set up with MAXInitializeTxGather. The fragments must stay valid until numBytesRemaining reaches 0. */
+typedef struct MAX3109_TX_GATHER_t {
+    const MAX3109_TX_FRAGMENT * fragments;
+    uint8_t numFragments;
+    uint8_t fragmentIndex; // Fragment the next byte comes from
+    uint16_t fragmentOffset; // Bytes of that fragment already accepted by the TxFIFO
+    uint32_t numBytesRemaining;
+    uint8_t checksum; // Running XOR of the checksummed bytes sent so far
+} MAX3109_TX_GATHER;
+
 typedef enum READ_WRITE_MODE_t {
     READ_MAX = 0x0,
     WRITE_MAX = 0x8000 // Write is active HIGH on 16th bit of cmd word 
 } MAX3109_READ_WRITE_MODE;
 
 
+#define MAX3109_NUM_UART_CHANNELS 2
+#define MAX3109_NUM_SHADOW_REGISTERS 0x20 // Register addresses 0x00 - 0x1F
+
+/* One MAX3109 chip - the transport its SPI bus is on and its chip select line on that bus. Any number of chips
+ * can share a transport as long as each has its own chip select line.
+ * The shadow registers cache every configuration register the driver writes or reads, so reads of registers the chip
+ * does not change on its own never go over SPI. Zero initialize the struct so the cache starts empty. */
+typedef struct MAX3109_DEVICE_t {
+    const SPI_TRANSPORT * transport;
+    uint16_t chipSelectLine;
+    uint8_t shadowRegisters[MAX3109_NUM_UART_CHANNELS][MAX3109_NUM_SHADOW_REGISTERS];
+    uint32_t shadowValidMask[MAX3109_NUM_UART_CHANNELS]; // Bit n set when shadowRegisters[channel][n] is valid
+} MAX3109_DEVICE;
+
+/* Routes all following MAX calls to the given chip. Single chip boards that only call InitializeSPI never need this. */
+void MAXSelectDevice( MAX3109_DEVICE * device );
+
+#define MAX3109_MAX_CONFIG_ENTRIES 32
+
+/* One line of a declarative register configuration table. On readback, only the bits in verifyMask are compared
+ * with value - a verifyMask of 0 writes the register without verifying it (resets, self clearing bits). */
+typedef struct MAX3109_REGISTER_CONFIG_t {
+    MAX3109_UART_SELECTION channel;
+    MAX3109_REGISTER_ADDRESS_VALUE maxRegister;
+    uint8_t value;
+    uint8_t verifyMask;
+} MAX3109_REGISTER_CONFIG;
+
+/* Writes every entry of a table (up to MAX3109_MAX_CONFIG_ENTRIES) to the selected chip, reads back all verified
+ * entries, and retries only the entries that failed. Entries are written in table order. Neighbouring entries for
+ * consecutive registers of one UART share a burst, so list them in register order to save chip select frames.
+ * Returns 1 on success, 0 on failure. */
+uint8_t MAXApplyRegisterConfiguration( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries );
+
+/* Reads back a table without writing it and compares the verified bits, retrying only the entries that failed.
+ * Returns 1 if every entry matches, 0 otherwise. */
+uint8_t MAXCheckRegisterConfiguration( const MAX3109_REGISTER_CONFIG * table,
+                                       const uint8_t numEntries );
+
+/* Drops the shadow registers of a channel on the selected chip, so the next read of each register goes to the chip */
+void MAXInvalidateShadowRegisters( const MAX3109_UART_SELECTION channel );
+
+/* Reads every cached register of a channel back from the selected chip and compares it with the shadow copy. With
+ * restoreMismatches set, mismatching registers are rewritten with the cached value, otherwise the cache takes the
+ * chip value. Returns the number of mismatching registers, 0xFF on error. */
+uint8_t MAXVerifyShadowRegisters( const MAX3109_UART_SELECTION channel,
+                                  const bool restoreMismatches );
+
 /* Function: Initialize_MAX3109()
  * Description - Performs initial read known register value, writes registers from configuration data, performs readback tests on written registers.
  * Returns 0 on success, 1 on failure. */
@@ -73,8 +205,97 @@ uint8_t MAXGetUARTFIFOLevel(const MAX3109_UART_SELECTION channel,
 
 uint8_t MAXPopSingleValueFromUARTRxFIFO(const MAX3109_UART_SELECTION channel);
 
+/* Burst reads up to numBytes from the RxFIFO into dst with CS held low. Returns number of bytes read, 0 on error. */
+uint8_t MAXPopBurstFromUARTRxFIFO(const MAX3109_UART_SELECTION channel,
+                                  uint8_t * dst,
+                                  const uint8_t numBytes);
+
+/* Queues a non-blocking burst read of the RxFIFO on the SPIAsync engine. numBytes is rounded down to an odd count.
+ * wordBuffer must hold MAX3109_BURST_WORD_COUNT(numBytes) words and stay valid until onComplete runs, which is
+ * where MAXUnpackBurstFromUARTRxFIFO recovers the bytes. Returns the number of bytes queued, 0 on error or full ring. */
+uint8_t MAXQueuePopBurstFromUARTRxFIFO(const MAX3109_UART_SELECTION channel,
+                                       uint16_t * wordBuffer,
+                                       const uint8_t numBytes,
+                                       SPI_COMPLETION_CALLBACK onComplete,
+                                       void * context);
+
+/* Extracts numBytes data bytes (as returned by MAXQueuePopBurstFromUARTRxFIFO) from a completed burst read */
+void MAXUnpackBurstFromUARTRxFIFO(const uint16_t * wordBuffer,
+                                  uint8_t * dst,
+                                  const uint8_t numBytes);
+
 uint8_t MAXPushSingleValueToUARTTxFIFO(const MAX3109_UART_SELECTION channel,
                                 const uint8_t valueToWrite);
 
+/* Burst writes numBytes from src to the TxFIFO with CS held low. Returns number of bytes written, 0 on error. */
+uint8_t MAXPushBurstToUARTTxFIFO(const MAX3109_UART_SELECTION channel,
+                                 const uint8_t * src,
+                                 const uint8_t numBytes);
+
+/* Prepares a gather over numFragments fragments. Returns 1 on success, 0 on failure. */
+uint8_t MAXInitializeTxGather(MAX3109_TX_GATHER * gather,
+                              const MAX3109_TX_FRAGMENT * fragments,
+                              const uint8_t numFragments);
+
+/* Burst writes up to numBytes of the gather's remaining bytes to the TxFIFO, packing them from the fragments straight
+ * into the burst words, and advances the gather. The caller bounds numBytes by the free TxFIFO space.
+ * Returns number of bytes written, 0 on error or when the gather is complete. */
+uint8_t MAXPushGatherToUARTTxFIFO(const MAX3109_UART_SELECTION channel,
+                                  MAX3109_TX_GATHER * gather,
+                                  const uint8_t numBytes);
+
 bool MAXIsUARTReceiveReadyToRead( const MAX3109_UART_SELECTION channel );
+
+/* Function: MAXConfigureReceiveInterrupts()
+ * Description - Enables the IRQ pin for the RxFIFO trigger level and the receive timeout. The trigger level is in bytes,
+ * a multiple of 8 from 8 to 120. The timeout is in character times, 0 disables it. Performs readback of written registers.
+ * Returns 1 on success, 0 on failure. */
+uint8_t MAXConfigureReceiveInterrupts( const MAX3109_UART_SELECTION channel,
+                                       const uint8_t rxTriggerLevelBytes,
+                                       const uint8_t rxTimeoutCharacters );
+
+/* Function: MAXConfigureFlowControl()
+ * Description - Programs the FlowLvl thresholds and automatic RTS/CTS flow control of a UART. With auto RTS, RTS is
+ * deasserted when the RxFIFO reaches haltLevelBytes and asserted again when it drops to resumeLevelBytes, so a sender
+ * is throttled whenever the RxFIFO is not drained. Levels are multiples of 8 up to 120, halt above resume. With auto
+ * CTS, the transmitter stops while CTS is deasserted. Call after MAXInitializeMAX3109. Returns 1 on success, 0 on failure. */
+uint8_t MAXConfigureFlowControl( const MAX3109_UART_SELECTION channel,
+                                 const uint8_t haltLevelBytes,
+                                 const uint8_t resumeLevelBytes,
+                                 const bool isAutoRTSEnabled,
+                                 const bool isAutoCTSEnabled );
+
+/* Reads GlobalIRQ once and returns the UARTs with a pending interrupt as MAX3109_PENDING_UART_x bits */
+uint8_t MAXGetPendingInterruptUARTs( void );
+
+/* Reads (and thereby clears) the ISR_Status of a UART, and the LSR if a line status interrupt is pending.
+ * Returns the ISR_Status bits, 0 on error. */
+uint8_t MAXAcknowledgeUARTInterrupt( const MAX3109_UART_SELECTION channel );
+
+/* Returns the baud rate the selected chip's registers produce for a channel, given the crystal or external clock
+ * frequency in Hz. Returns 0 on error. */
+uint32_t MAXGetUARTBaudRate( const MAX3109_UART_SELECTION channel,
+                             const uint32_t referenceClockHz );
+
+/* Returns the number of bits on the line per character (start, data, parity and stop bits), 0 on error */
+uint8_t MAXGetUARTBitsPerCharacter( const MAX3109_UART_SELECTION channel );
+
+/* Finds the clock source, PLL, rate mode and divisor settings that come closest to targetBaud from a crystal or
+ * external clock of clockHz. Returns 1 on success, 0 if no valid setting exists. */
+uint8_t MAXSolveBaudRate( const uint32_t clockHz,
+                          const bool isExternalClock,
+                          const uint32_t targetBaud,
+                          MAX3109_BAUD_SETTINGS * settings );
+
+/* Solves only the rate mode and divisor for a fixed fREF - use for the second UART, which shares the first UART's
+ * clock source and PLL. The settings are marked divisor only, so MAXConfigureBaudRate leaves the clock source and PLL
+ * as they are. Returns 1 on success, 0 if no valid setting exists. */
+uint8_t MAXSolveBaudDivisor( const uint32_t referenceHz,
+                             const uint32_t targetBaud,
+                             MAX3109_BAUD_SETTINGS * settings );
+
+/* Writes and verifies the clock source, PLL and baud rate generator registers. The clock source and PLL are shared by
+ * both UARTs, and are only written when settings->isClockIncluded is set. Returns 1 on success, 0 on failure. */
+uint8_t MAXConfigureBaudRate( const MAX3109_UART_SELECTION channel,
+                              const MAX3109_BAUD_SETTINGS * settings );
 #endif 
\ No newline at end of file
@@ -0,0 +1,64 @@
+/*
+File: MAX3109Registers Header File
+Author: Henry Gilbert
+Description: Header only register access for constant channels and registers. The command word is assembled and
+    checked at compile time - an invalid channel, a register outside the directly addressed range 0x00 - 0x1F, or a
+    register held in the shadow cache fails the build - so each access is a single SPI transfer with no runtime checks.
+    Only registers the chip changes on its own are allowed, as a write here bypasses the shadow registers. Use the
+    MAX3109.c functions for configuration registers and for channels only known at run time.
+
+    Usage: uint8_t level = MAX3109_READ_REGISTER( UART_1, max3109_RxFIFOLvl );
+           MAX3109_WRITE_REGISTER( UART_0, max3109_TRxHR, byteToSend );
+ */
+
+#ifndef MAX_3109_REGISTERS_H
+#define MAX_3109_REGISTERS_H
+#include "MAX3109.h"
+#include "MAX3109Stats.h"
+
+/* Registers the chip changes on its own (FIFO data and levels, status, GPIO inputs, GlobalIRQ) - never cached */
+#define MAX3109_VOLATILE_REGISTER_MASK ((1UL << 0x00) | (1UL << 0x02) | (1UL << 0x04) | (1UL << 0x06) | (1UL << 0x08) | \
+                                        (1UL << 0x11) | (1UL << 0x12) | (1UL << 0x19) | (1UL << 0x1F))
+
+#define MAX3109_IS_VALID_CHANNEL(channel) ((UART_0 == (channel)) || (UART_1 == (channel)))
+#define MAX3109_IS_DIRECT_REGISTER(maxRegister) (0 == ((maxRegister) & ~0x1F00))
+#define MAX3109_IS_VOLATILE_REGISTER(maxRegister) (0 != (MAX3109_VOLATILE_REGISTER_MASK & (1UL << (((maxRegister) >> 8) & 0x1F))))
+
+/* Evaluates to 0, or fails to compile when condition is false or not a compile time constant. XC16 has no
+ * _Static_assert, so a negative bit field width does the check. */
+#define MAX3109_COMPILE_CHECK(condition) (0 * sizeof (struct { int compileCheck : ((condition) ? 1 : -1); }))
+
+/* Command word of a volatile register with the channel supplied at run time - only the register is checked */
+#define MAX3109_REGISTER_COMMAND(readWriteMode, maxRegister) \
+    ((uint16_t) ((readWriteMode) | (maxRegister) | \
+                 MAX3109_COMPILE_CHECK( MAX3109_IS_DIRECT_REGISTER( maxRegister ) && MAX3109_IS_VOLATILE_REGISTER( maxRegister ) )))
+
+#define MAX3109_READ_COMMAND(channel, maxRegister) \
+    ((uint16_t) (MAX3109_REGISTER_COMMAND( READ_MAX, maxRegister ) | (channel) | \
+                 MAX3109_COMPILE_CHECK( MAX3109_IS_VALID_CHANNEL( channel ) )))
+#define MAX3109_WRITE_COMMAND(channel, maxRegister) \
+    ((uint16_t) (MAX3109_REGISTER_COMMAND( WRITE_MAX, maxRegister ) | (channel) | \
+                 MAX3109_COMPILE_CHECK( MAX3109_IS_VALID_CHANNEL( channel ) )))
+
+#define MAX3109_READ_REGISTER(channel, maxRegister) MAXReadRegisterCommand( MAX3109_READ_COMMAND( channel, maxRegister ) )
+#define MAX3109_WRITE_REGISTER(channel, maxRegister, value) \
+    MAXWriteRegisterCommand( MAX3109_WRITE_COMMAND( channel, maxRegister ), (value) )
+
+/* One SPI word with a prebuilt command - the 8 bit register value is returned in the low byte */
+static inline uint8_t MAXReadRegisterCommand( const uint16_t readCommand )
+{
+    uint16_t registerValue = 0;
+    SPIreadWriteWord( readCommand, &registerValue );
+    MAX_STATS_SPI( statsSite_RegisterRead, 1, 1 );
+    return (uint8_t) (registerValue & 0xFF);
+}
+
+static inline void MAXWriteRegisterCommand( const uint16_t writeCommand,
+                                            const uint8_t value )
+{
+    uint16_t junk;
+    SPIreadWriteWord( writeCommand | value, &junk );
+    MAX_STATS_SPI( statsSite_RegisterWrite, 1, 1 );
+}
+
+#endif
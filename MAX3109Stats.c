@@ -0,0 +1,141 @@
+/* Hot path instrumentation counters for the MAX3109 driver stack. 
+ * Author : Henry Gilbert
+ * 
+ * Module Description: Storage and update functions behind the MAX_STATS_x hooks in MAX3109Stats.h. Everything here is
+ * compiled out unless MAX3109_ENABLE_STATS is defined. */
+
+#include <stdbool.h>
+#include "MAX3109Stats.h"
+#include "MAX3109.h"
+
+#ifdef MAX3109_ENABLE_STATS
+#include <stddef.h>
+#include <string.h>
+
+static MAX3109_STATS stats;
+static MAX3109_CYCLE_COUNTER cycleCounter = NULL;
+
+/* Local Function Prototypes */
+static void recordCycles( MAX3109_CYCLE_HISTOGRAM * histogram,
+                          const uint32_t startCycles );
+
+void MAXStatsSetCycleCounter( MAX3109_CYCLE_COUNTER counter )
+{
+    cycleCounter = counter;
+}
+
+void MAXStatsSnapshot( MAX3109_STATS * snapshot )
+{
+    if (NULL != snapshot)
+    {
+        *snapshot = stats;
+    }
+}
+
+void MAXStatsReset( void )
+{
+    memset( &stats, 0, sizeof (stats) );
+}
+
+void MAXStatsRecordSPI( const MAX3109_STATS_CALL_SITE site,
+                        const uint16_t numTransactions,
+                        const uint16_t numWords )
+{
+    if (site < NUM_STATS_CALL_SITES)
+    {
+        stats.callSites[site].transactions += numTransactions;
+        stats.callSites[site].words += numWords;
+    }
+}
+
+void MAXStatsRecordBytes( const uint8_t channelIndex,
+                          const uint16_t numRxBytes,
+                          const uint16_t numTxBytes )
+{
+    if (channelIndex < MAX3109_STATS_NUM_CHANNELS)
+    {
+        stats.channels[channelIndex].rxBytes += numRxBytes;
+        stats.channels[channelIndex].txBytes += numTxBytes;
+    }
+}
+
+void MAXStatsRecordFIFOLevel( const uint8_t channelIndex,
+                              const bool isRxFIFO,
+                              const uint8_t fifoLevel )
+{
+    if (channelIndex >= MAX3109_STATS_NUM_CHANNELS)
+    {
+        return;
+    }
+
+    MAX3109_CHANNEL_STATS * channelStats = &stats.channels[channelIndex];
+    uint8_t * highWater = (isRxFIFO) ? &channelStats->rxFIFOHighWater : &channelStats->txFIFOHighWater;
+    if (fifoLevel > *highWater)
+    {
+        *highWater = fifoLevel;
+    }
+    if (isRxFIFO && (MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == fifoLevel))
+    {
+        channelStats->rxFIFOFullEvents++;
+    }
+}
+
+void MAXStatsRecordFIFOLevelError( const uint8_t channelIndex )
+{
+    if (channelIndex < MAX3109_STATS_NUM_CHANNELS)
+    {
+        stats.channels[channelIndex].fifoLevelErrors++;
+    }
+}
+
+void MAXStatsRecordTxDeferred( const uint8_t channelIndex,
+                               const uint16_t numBytes )
+{
+    if (channelIndex < MAX3109_STATS_NUM_CHANNELS)
+    {
+        stats.channels[channelIndex].txBytesDeferred += numBytes;
+    }
+}
+
+uint32_t MAXStatsCycleCount( void )
+{
+    return (NULL == cycleCounter) ? 0 : cycleCounter( );
+}
+
+void MAXStatsRecordReadCycles( const uint32_t startCycles )
+{
+    recordCycles( &stats.readCycles, startCycles );
+}
+
+void MAXStatsRecordWriteCycles( const uint32_t startCycles )
+{
+    recordCycles( &stats.writeCycles, startCycles );
+}
+
+/* Buckets are powers of two, so the bucket index is the position of the highest set bit */
+static void recordCycles( MAX3109_CYCLE_HISTOGRAM * histogram,
+                          const uint32_t startCycles )
+{
+    if (NULL == cycleCounter)
+    {
+        return;
+    }
+
+    uint32_t elapsedCycles = cycleCounter( ) - startCycles; // Unsigned difference survives counter wrap
+    uint8_t bucket = 0;
+    uint32_t remaining = elapsedCycles >> 1;
+    while ((remaining > 0) && (bucket < (MAX3109_STATS_HISTOGRAM_BUCKETS - 1)))
+    {
+        remaining >>= 1;
+        bucket++;
+    }
+
+    histogram->buckets[bucket]++;
+    histogram->numCalls++;
+    if (elapsedCycles > histogram->maxCycles)
+    {
+        histogram->maxCycles = elapsedCycles;
+    }
+}
+
+#endif /* MAX3109_ENABLE_STATS */
@@ -0,0 +1,106 @@
+/*
+File: MAX3109Stats Header File
+Author: Henry Gilbert
+Description: Optional hot path instrumentation for the SPI, MAX3109 and SPItoUART layers. Define MAX3109_ENABLE_STATS
+    to build it in - otherwise every hook below expands to nothing and no code or RAM is used. Counts SPI transactions
+    and words per driver call site, bytes and FIFO high water marks per UART channel, and keeps a cycle count
+    histogram of each ReadDataFromUARTBuffer/WriteDataToUARTTransmitBuffer call. Channel counters are summed over all
+    chips when more than one MAX3109 is in use. SPI traffic is counted where MAX3109.c issues it rather than inside
+    a transport such as newSPI, so the counts hold on every transport - tests/maxStatsTest checks them against the
+    frames the host transport clocks.
+ */
+
+#ifndef MAX_3109_STATS_H
+#define MAX_3109_STATS_H
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Driver call sites that issue SPI traffic */
+typedef enum MAX3109_STATS_CALL_SITE_t {
+    statsSite_RegisterRead = 0,
+    statsSite_RegisterWrite,
+    statsSite_RxBurst,
+    statsSite_TxBurst,
+    statsSite_ConfigBatch,
+    statsSite_AsyncRxBurst,
+    NUM_STATS_CALL_SITES
+} MAX3109_STATS_CALL_SITE;
+
+#ifdef MAX3109_ENABLE_STATS
+
+#define MAX3109_STATS_NUM_CHANNELS 2
+#define MAX3109_STATS_HISTOGRAM_BUCKETS 16 // Bucket n counts calls of 2^n to 2^(n+1)-1 cycles, the last bucket is open ended
+
+typedef struct MAX3109_CALL_SITE_STATS_t {
+    uint32_t transactions; // Chip select frames
+    uint32_t words; // 16 bit words clocked
+} MAX3109_CALL_SITE_STATS;
+
+typedef struct MAX3109_CHANNEL_STATS_t {
+    uint32_t rxBytes;
+    uint32_t txBytes;
+    uint8_t rxFIFOHighWater; // Highest level reported by MAXGetUARTFIFOLevel
+    uint8_t txFIFOHighWater;
+    uint32_t rxFIFOFullEvents; // RxFIFO read as full - bytes arriving at that point were dropped by the chip
+    uint32_t fifoLevelErrors; // FIFO level reads past the FIFO size, left out of the high water marks
+    uint32_t txBytesDeferred; // Bytes a transmit call could not hand to a full TxFIFO
+} MAX3109_CHANNEL_STATS;
+
+typedef struct MAX3109_CYCLE_HISTOGRAM_t {
+    uint32_t buckets[MAX3109_STATS_HISTOGRAM_BUCKETS];
+    uint32_t numCalls;
+    uint32_t maxCycles;
+} MAX3109_CYCLE_HISTOGRAM;
+
+typedef struct MAX3109_STATS_t {
+    MAX3109_CALL_SITE_STATS callSites[NUM_STATS_CALL_SITES];
+    MAX3109_CHANNEL_STATS channels[MAX3109_STATS_NUM_CHANNELS];
+    MAX3109_CYCLE_HISTOGRAM readCycles; // ReadDataFromUARTBuffer
+    MAX3109_CYCLE_HISTOGRAM writeCycles; // WriteDataToUARTTransmitBuffer
+} MAX3109_STATS;
+
+/* Free running cycle or timer count used for the histograms, e.g. a dsPIC timer register or a host clock */
+typedef uint32_t (*MAX3109_CYCLE_COUNTER)( void );
+
+void MAXStatsSetCycleCounter( MAX3109_CYCLE_COUNTER counter );
+void MAXStatsSnapshot( MAX3109_STATS * snapshot ); // Counters updated from an ISR may be mid update in the snapshot
+void MAXStatsReset( void );
+
+void MAXStatsRecordSPI( const MAX3109_STATS_CALL_SITE site,
+                        const uint16_t numTransactions,
+                        const uint16_t numWords );
+void MAXStatsRecordBytes( const uint8_t channelIndex,
+                          const uint16_t numRxBytes,
+                          const uint16_t numTxBytes );
+void MAXStatsRecordFIFOLevel( const uint8_t channelIndex,
+                              const bool isRxFIFO,
+                              const uint8_t fifoLevel );
+void MAXStatsRecordFIFOLevelError( const uint8_t channelIndex );
+void MAXStatsRecordTxDeferred( const uint8_t channelIndex,
+                               const uint16_t numBytes );
+uint32_t MAXStatsCycleCount( void );
+void MAXStatsRecordReadCycles( const uint32_t startCycles );
+void MAXStatsRecordWriteCycles( const uint32_t startCycles );
+
+#define MAX_STATS_SPI(site, numTransactions, numWords) MAXStatsRecordSPI( (site), (numTransactions), (numWords) )
+#define MAX_STATS_BYTES(channelIndex, numRx, numTx) MAXStatsRecordBytes( (channelIndex), (numRx), (numTx) )
+#define MAX_STATS_FIFO_LEVEL(channelIndex, isRx, level) MAXStatsRecordFIFOLevel( (channelIndex), (isRx), (level) )
+#define MAX_STATS_FIFO_LEVEL_ERROR(channelIndex) MAXStatsRecordFIFOLevelError( (channelIndex) )
+#define MAX_STATS_TX_DEFERRED(channelIndex, numBytes) MAXStatsRecordTxDeferred( (channelIndex), (numBytes) )
+#define MAX_STATS_CYCLE_START(name) uint32_t name = MAXStatsCycleCount( )
+#define MAX_STATS_READ_CYCLES(start) MAXStatsRecordReadCycles( (start) )
+#define MAX_STATS_WRITE_CYCLES(start) MAXStatsRecordWriteCycles( (start) )
+
+#else
+
+#define MAX_STATS_SPI(site, numTransactions, numWords) ((void) 0)
+#define MAX_STATS_BYTES(channelIndex, numRx, numTx) ((void) 0)
+#define MAX_STATS_FIFO_LEVEL(channelIndex, isRx, level) ((void) 0)
+#define MAX_STATS_FIFO_LEVEL_ERROR(channelIndex) ((void) 0)
+#define MAX_STATS_TX_DEFERRED(channelIndex, numBytes) ((void) 0)
+#define MAX_STATS_CYCLE_START(name)
+#define MAX_STATS_READ_CYCLES(start) ((void) 0)
+#define MAX_STATS_WRITE_CYCLES(start) ((void) 0)
+
+#endif /* MAX3109_ENABLE_STATS */
+#endif
@@ -0,0 +1,111 @@
+/* File: SPIAsync
+ * Author: Henry Gilbert
+ * Description : Descriptor ring and interrupt state machine for non-blocking SPI transfers. The main loop is the
+ *      only producer (advances ringHead), the completion interrupt is the only consumer (advances ringTail). The
+ *      completion interrupt is disabled around the idle check in SPIAsyncEnqueue, which is the one place the two
+ *      contexts race.
+ */
+
+#include "SPIAsync.h"
+#include "SPITransport.h"
+#include <stddef.h>
+
+#define RING_MASK (SPI_ASYNC_QUEUE_LENGTH - 1)
+
+static SPI_TRANSACTION transactionRing[SPI_ASYNC_QUEUE_LENGTH];
+static volatile uint8_t ringHead = 0; // Free running, next descriptor to fill
+static volatile uint8_t ringTail = 0; // Free running, descriptor in flight
+static volatile bool isEngineBusy = false;
+static volatile uint16_t currentWordIndex = 0;
+static const SPI_TRANSPORT * engineTransport = NULL;
+
+/* Local Function Prototypes */
+static void startTransaction( const SPI_TRANSACTION * transaction );
+
+uint8_t SPIAsyncEnqueue( const SPI_TRANSACTION * transaction )
+{
+    const SPI_TRANSPORT * transport = SPIGetTransport( );
+    if ((NULL == transaction) ||
+        (NULL == transaction->writeData) ||
+        (0 == transaction->numWords) ||
+        (NULL == transport) ||
+        (NULL == transport->startWord) ||
+        (NULL == transport->enableCompletionInterrupt))
+    {
+        return 1; // Error, invalid params or no async support
+    }
+
+    if ((uint8_t) (ringHead - ringTail) >= SPI_ASYNC_QUEUE_LENGTH)
+    {
+        return 1; // Ring full
+    }
+
+    transactionRing[ringHead & RING_MASK] = *transaction;
+
+    transport->enableCompletionInterrupt( false );
+    ringHead++;
+    if (!isEngineBusy)
+    {
+        isEngineBusy = true;
+        engineTransport = transport;
+        startTransaction( &transactionRing[ringTail & RING_MASK] );
+    }
+    transport->enableCompletionInterrupt( true );
+    return 0;
+}
+
+bool SPIAsyncIsIdle( void )
+{
+    return !isEngineBusy;
+}
+
+uint8_t SPIAsyncFreeSlots( void )
+{
+    return (uint8_t) (SPI_ASYNC_QUEUE_LENGTH - (uint8_t) (ringHead - ringTail));
+}
+
+/* Stores the received word, then either clocks the next word, or closes the transaction and starts the next one */
+void SPIAsyncWordComplete( const uint16_t readWord )
+{
+    if (!isEngineBusy)
+    {
+        return; // Spurious interrupt
+    }
+
+    SPI_TRANSACTION * transaction = &transactionRing[ringTail & RING_MASK];
+    if (NULL != transaction->readData)
+    {
+        transaction->readData[currentWordIndex] = readWord;
+    }
+    currentWordIndex++;
+
+    if (currentWordIndex < transaction->numWords)
+    {
+        engineTransport->startWord( transaction->writeData[currentWordIndex] );
+        return;
+    }
+
+    engineTransport->chipSelect( transaction->chipSelectLine, false );
+    if (NULL != transaction->onComplete)
+    {
+        transaction->onComplete( transaction->context, transaction->readData, transaction->numWords );
+    }
+    ringTail++;
+
+    if (ringTail != ringHead)
+    {
+        startTransaction( &transactionRing[ringTail & RING_MASK] );
+    }
+    else
+    {
+        isEngineBusy = false;
+        engineTransport->enableCompletionInterrupt( false );
+    }
+}
+
+static void startTransaction( const SPI_TRANSACTION * transaction )
+{
+    currentWordIndex = 0;
+    engineTransport->chipSelect( transaction->chipSelectLine, true );
+    engineTransport->startWord( transaction->writeData[0] );
+}
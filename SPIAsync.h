@@ -0,0 +1,48 @@
+/* File: SPIAsync
+ * Author: Henry Gilbert
+ * Description : Non-blocking SPI engine. Callers enqueue transactions (a word list, a chip select line and a
+ *      completion callback) into a fixed size descriptor ring. The transport's completion interrupt advances the
+ *      ring one word at a time, so the CPU is free while each word is clocked out.
+ *      The synchronous SPIreadWriteWord/SPIreadWriteBuffer calls share the peripheral and must only be used while
+ *      SPIAsyncIsIdle() returns true.
+ */
+
+#ifndef SPI_ASYNC_H
+#define SPI_ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SPI_ASYNC_QUEUE_LENGTH 8 // Must be a power of two
+
+/* Called from interrupt context once the last word of a transaction has been clocked and chip select released */
+typedef void (*SPI_COMPLETION_CALLBACK)( void * context,
+                                         uint16_t * readData,
+                                         const uint16_t numWords );
+
+/* The word buffers are owned by the caller and must stay valid until the completion callback has run.
+ * readData may point at writeData, or be NULL if the response words are not needed. */
+typedef struct SPI_TRANSACTION_t {
+    const uint16_t * writeData;
+    uint16_t * readData;
+    uint16_t numWords;
+    uint16_t chipSelectLine;
+    SPI_COMPLETION_CALLBACK onComplete; // May be NULL
+    void * context;
+} SPI_TRANSACTION;
+
+/* Copies the descriptor into the ring and starts the engine if it is idle. Uses the transport selected by
+ * SPISetTransport. Returns 0 on success, 1 if the ring is full, the params are invalid, or the transport has
+ * no non-blocking support. */
+uint8_t SPIAsyncEnqueue( const SPI_TRANSACTION * transaction );
+
+/* Returns true when no transaction is queued or in flight */
+bool SPIAsyncIsIdle( void );
+
+/* Returns the number of free descriptors in the ring */
+uint8_t SPIAsyncFreeSlots( void );
+
+/* Called by the transport's completion interrupt with the word received for the last startWord */
+void SPIAsyncWordComplete( const uint16_t readWord );
+
+#endif
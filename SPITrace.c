@@ -0,0 +1,309 @@
+/* File: SPITrace
+ * Author: Henry Gilbert
+ * Description : SPI trace recorder and replay transports. Transports carry no context pointer, so each keeps its state
+ *      in this file - there is one recorder and one replay at a time.
+ */
+
+#include "SPITrace.h"
+#include <string.h>
+
+#define RECORDER_COPY_WORDS 128 // More than a full FIFO burst, so a MAX3109 burst is forwarded in one call
+
+static const uint8_t traceHeader[SPI_TRACE_HEADER_SIZE] = { 'S', 'P', 'T', '1' };
+
+/* Recorder state */
+static const SPI_TRANSPORT * recorderInner = NULL;
+static uint32_t (*recorderClock)( void ) = NULL;
+static uint8_t * recorderStorage = NULL;
+static size_t recorderCapacity = 0;
+static uint32_t recorderLastTime = 0;
+static SPI_TRACE_RECORDER_STATUS recorderStatus;
+static uint16_t recorderWriteCopy[RECORDER_COPY_WORDS]; // Write words of a burst, which readData may overwrite
+
+/* Replay state */
+static const uint8_t * replayTrace = NULL;
+static size_t replayLength = 0;
+static size_t replayOffset = 0;
+static SPI_TRACE_REPLAY_STATUS replayStatus;
+
+/* Local Function Prototypes */
+static uint16_t recorderTransferWord( const uint16_t writeData );
+static void recorderTransferBuffer( const uint16_t * writeData,
+                                    uint16_t * readData,
+                                    const uint16_t numWords );
+static void recorderChipSelect( const uint16_t chipSelectLine,
+                                const bool isSelected );
+static void recorderStartWord( const uint16_t writeData );
+static void recorderEnableCompletionInterrupt( const bool isEnabled );
+static void recordEvent( const SPI_TRACE_RECORD_TAG tag,
+                         const uint16_t firstValue,
+                         const uint16_t secondValue );
+static uint16_t replayTransferWord( const uint16_t writeData );
+static void replayTransferBuffer( const uint16_t * writeData,
+                                  uint16_t * readData,
+                                  const uint16_t numWords );
+static void replayChipSelect( const uint16_t chipSelectLine,
+                              const bool isSelected );
+static void replayStartWord( const uint16_t writeData );
+static void replayEnableCompletionInterrupt( const bool isEnabled );
+static bool replayNextWord( uint16_t * recordedWrite,
+                            uint16_t * recordedRead );
+
+const SPI_TRANSPORT spiRecorderTransport = {
+    recorderTransferWord,
+    recorderTransferBuffer,
+    recorderChipSelect,
+    recorderStartWord,
+    recorderEnableCompletionInterrupt
+};
+
+const SPI_TRANSPORT spiReplayTransport = {
+    replayTransferWord,
+    replayTransferBuffer,
+    replayChipSelect,
+    replayStartWord,
+    replayEnableCompletionInterrupt
+};
+
+uint8_t SPIRecorderStart( uint8_t * storage,
+                          const size_t capacity,
+                          const SPI_TRANSPORT * innerTransport,
+                          uint32_t (*clock)( void ) )
+{
+    if ((NULL == storage) || (capacity < SPI_TRACE_HEADER_SIZE) || (NULL == innerTransport))
+    {
+        return 1; // Error, invalid params
+    }
+
+    recorderInner = innerTransport;
+    recorderClock = clock;
+    recorderStorage = storage;
+    recorderCapacity = capacity;
+    recorderLastTime = (NULL == clock) ? 0 : clock( );
+    memcpy( storage, traceHeader, SPI_TRACE_HEADER_SIZE );
+    recorderStatus.length = SPI_TRACE_HEADER_SIZE;
+    recorderStatus.numWords = 0;
+    recorderStatus.isTruncated = false;
+    return 0;
+}
+
+void SPIRecorderGetStatus( SPI_TRACE_RECORDER_STATUS * status )
+{
+    if (NULL != status)
+    {
+        *status = recorderStatus;
+    }
+}
+
+uint8_t SPIReplayStart( const uint8_t * trace,
+                        const size_t length )
+{
+    if ((NULL == trace) || (length < SPI_TRACE_HEADER_SIZE) || (0 != memcmp( trace, traceHeader, SPI_TRACE_HEADER_SIZE )))
+    {
+        return 1; // Error, not a trace
+    }
+
+    replayTrace = trace;
+    replayLength = length;
+    replayOffset = SPI_TRACE_HEADER_SIZE;
+    memset( &replayStatus, 0, sizeof (replayStatus) );
+    return 0;
+}
+
+void SPIReplayGetStatus( SPI_TRACE_REPLAY_STATUS * status )
+{
+    if (NULL != status)
+    {
+        *status = replayStatus;
+    }
+}
+
+uint32_t SPIReplayGetTraceTime( void )
+{
+    return replayStatus.traceTime;
+}
+
+static uint16_t recorderTransferWord( const uint16_t writeData )
+{
+    uint16_t readData = recorderInner->transferWord( writeData );
+    recordEvent( spiTrace_Word, writeData, readData );
+    return readData;
+}
+
+/* Forwards the burst to the inner transport as one buffer transfer, so its buffer path is what gets exercised and
+ * timed. readData may be the same buffer as writeData, so the write words are copied first to log them afterwards.
+ * Bursts longer than the copy go through in pieces, with chip select still asserted across them. */
+static void recorderTransferBuffer( const uint16_t * writeData,
+                                    uint16_t * readData,
+                                    const uint16_t numWords )
+{
+    uint16_t wordsDone = 0;
+    while (wordsDone < numWords)
+    {
+        uint16_t numPieceWords = ((numWords - wordsDone) < RECORDER_COPY_WORDS) ? (numWords - wordsDone) : RECORDER_COPY_WORDS;
+        memcpy( recorderWriteCopy, &writeData[wordsDone], numPieceWords * sizeof (uint16_t) );
+        recorderInner->transferBuffer( recorderWriteCopy, (NULL == readData) ? NULL : &readData[wordsDone], numPieceWords );
+
+        uint16_t wordIndex;
+        for (wordIndex = 0; wordIndex < numPieceWords; wordIndex++)
+        {
+            recordEvent( spiTrace_Word, recorderWriteCopy[wordIndex], (NULL == readData) ? 0 : readData[wordsDone + wordIndex] );
+        }
+        wordsDone += numPieceWords;
+    }
+}
+
+static void recorderChipSelect( const uint16_t chipSelectLine,
+                                const bool isSelected )
+{
+    recorderInner->chipSelect( chipSelectLine, isSelected );
+    recordEvent( (isSelected) ? spiTrace_ChipSelect : spiTrace_ChipDeselect, chipSelectLine, 0 );
+}
+
+static void recorderStartWord( const uint16_t writeData )
+{
+    recorderInner->startWord( writeData );
+}
+
+static void recorderEnableCompletionInterrupt( const bool isEnabled )
+{
+    recorderInner->enableCompletionInterrupt( isEnabled );
+}
+
+/* Appends one record. Once a record does not fit, recording stops so the trace never has a gap in the middle */
+static void recordEvent( const SPI_TRACE_RECORD_TAG tag,
+                         const uint16_t firstValue,
+                         const uint16_t secondValue )
+{
+    if ((NULL == recorderStorage) || (recorderStatus.isTruncated))
+    {
+        return;
+    }
+    if ((recorderCapacity - recorderStatus.length) < SPI_TRACE_MAX_RECORD_SIZE)
+    {
+        recorderStatus.isTruncated = true;
+        return;
+    }
+
+    uint32_t now = (NULL == recorderClock) ? 0 : recorderClock( );
+    uint32_t delta = now - recorderLastTime;
+    recorderLastTime = now;
+
+    uint8_t * p = &recorderStorage[recorderStatus.length];
+    *p++ = (uint8_t) tag;
+    do
+    {
+        uint8_t varintByte = (uint8_t) (delta & 0x7F);
+        delta >>= 7;
+        *p++ = (0 != delta) ? (varintByte | 0x80) : varintByte;
+    }
+    while (0 != delta);
+
+    *p++ = (uint8_t) (firstValue & 0xFF);
+    *p++ = (uint8_t) (firstValue >> 8);
+    if (spiTrace_Word == tag)
+    {
+        *p++ = (uint8_t) (secondValue & 0xFF);
+        *p++ = (uint8_t) (secondValue >> 8);
+        recorderStatus.numWords++;
+    }
+    recorderStatus.length = (size_t) (p - recorderStorage);
+}
+
+static uint16_t replayTransferWord( const uint16_t writeData )
+{
+    uint16_t recordedWrite;
+    uint16_t recordedRead;
+    if (false == replayNextWord( &recordedWrite, &recordedRead ))
+    {
+        replayStatus.numWordsPastEnd++;
+        return 0;
+    }
+
+    replayStatus.numWords++;
+    if (recordedWrite != writeData)
+    {
+        replayStatus.writeMismatches++;
+    }
+    return recordedRead;
+}
+
+static void replayTransferBuffer( const uint16_t * writeData,
+                                  uint16_t * readData,
+                                  const uint16_t numWords )
+{
+    uint16_t wordIndex;
+    for (wordIndex = 0; wordIndex < numWords; wordIndex++)
+    {
+        uint16_t recordedRead = replayTransferWord( writeData[wordIndex] );
+        if (NULL != readData)
+        {
+            readData[wordIndex] = recordedRead;
+        }
+    }
+}
+
+/* Chip select records only carry timing - they are consumed by replayNextWord. The code under test's own frames are
+ * counted, so a replay reports the transactions of the current code. */
+static void replayChipSelect( const uint16_t chipSelectLine,
+                              const bool isSelected )
+{
+    (void) chipSelectLine;
+    if (isSelected)
+    {
+        replayStatus.numTransactions++;
+    }
+}
+
+static void replayStartWord( const uint16_t writeData )
+{
+    (void) writeData; // Async transfers are not in the trace
+}
+
+static void replayEnableCompletionInterrupt( const bool isEnabled )
+{
+    (void) isEnabled;
+}
+
+/* Steps over chip select records to the next word record, advancing the trace time. Returns false at the end of the
+ * trace or on a truncated record. */
+static bool replayNextWord( uint16_t * recordedWrite,
+                            uint16_t * recordedRead )
+{
+    while ((NULL != replayTrace) && (replayOffset < replayLength))
+    {
+        size_t offset = replayOffset;
+        uint8_t tag = replayTrace[offset++];
+
+        uint32_t delta = 0;
+        uint8_t shift = 0;
+        uint8_t varintByte;
+        do
+        {
+            if ((offset >= replayLength) || (shift > 28))
+            {
+                return false;
+            }
+            varintByte = replayTrace[offset++];
+            delta |= (uint32_t) (varintByte & 0x7F) << shift;
+            shift += 7;
+        }
+        while (varintByte & 0x80);
+
+        size_t payloadSize = (spiTrace_Word == tag) ? 4 : 2;
+        if ((replayLength - offset) < payloadSize)
+        {
+            return false;
+        }
+        replayOffset = offset + payloadSize;
+        replayStatus.traceTime += delta;
+
+        if (spiTrace_Word == tag)
+        {
+            *recordedWrite = (uint16_t) (replayTrace[offset] | ((uint16_t) replayTrace[offset + 1] << 8));
+            *recordedRead = (uint16_t) (replayTrace[offset + 2] | ((uint16_t) replayTrace[offset + 3] << 8));
+            return true;
+        }
+    }
+    return false;
+}
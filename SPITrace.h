@@ -0,0 +1,64 @@
+/* File: SPITrace
+ * Author: Henry Gilbert
+ * Description : Record and replay of SPI traffic. The recorder is a transport that wraps another transport and logs
+ *      every chip select edge and every word pair it clocks, with a timestamp, to a compact binary trace. The replay
+ *      transport plays such a trace back to the MAX3109 and SPItoUART code, so traffic captured on the bench can be
+ *      run again on a host without hardware.
+ *
+ * Trace format: the 4 byte header "SPT1", then one record per event. Every record starts with a tag byte and the
+ *      time since the previous record in clock ticks as an unsigned LEB128 varint (7 bits per byte, low bits first).
+ *      Chip select records then carry the 16 bit line, word records the 16 bit write and read words, all little
+ *      endian. Words of a write only burst are recorded with a read word of 0.
+ *      The non-blocking SPIAsync path is passed through by the recorder without being logged, and is not replayed.
+ */
+
+#ifndef SPI_TRACE_H
+#define SPI_TRACE_H
+
+#include "SPITransport.h"
+#include <stddef.h>
+
+#define SPI_TRACE_HEADER_SIZE 4
+#define SPI_TRACE_MAX_RECORD_SIZE 10 // Tag, 5 byte varint, two words
+
+typedef enum SPI_TRACE_RECORD_TAG_t {
+    spiTrace_ChipDeselect = 0x00,
+    spiTrace_ChipSelect = 0x01,
+    spiTrace_Word = 0x02
+} SPI_TRACE_RECORD_TAG;
+
+typedef struct SPI_TRACE_RECORDER_STATUS_t {
+    size_t length; // Bytes of trace written, header included
+    uint32_t numWords;
+    bool isTruncated; // Storage filled up - later records were dropped
+} SPI_TRACE_RECORDER_STATUS;
+
+typedef struct SPI_TRACE_REPLAY_STATUS_t {
+    uint32_t numTransactions; // Chip select frames started by the code under test
+    uint32_t numWords; // Words answered from the trace
+    uint32_t writeMismatches; // Words written that differ from the recorded write - the code under test diverged
+    uint32_t numWordsPastEnd; // Words requested after the trace ran out, answered with 0
+    uint32_t traceTime; // Recorded time of the last record replayed
+} SPI_TRACE_REPLAY_STATUS;
+
+extern const SPI_TRANSPORT spiRecorderTransport;
+extern const SPI_TRANSPORT spiReplayTransport;
+
+/* Starts recording into storage everything clocked through spiRecorderTransport, which forwards to innerTransport.
+ * clock is any free running tick counter, NULL records every timestamp as 0. Returns 0 on success, 1 on error. */
+uint8_t SPIRecorderStart( uint8_t * storage,
+                          const size_t capacity,
+                          const SPI_TRANSPORT * innerTransport,
+                          uint32_t (*clock)( void ) );
+void SPIRecorderGetStatus( SPI_TRACE_RECORDER_STATUS * status );
+
+/* Starts answering transfers on spiReplayTransport from a trace made by the recorder. Returns 0 on success, 1 if the
+ * trace has no valid header. */
+uint8_t SPIReplayStart( const uint8_t * trace,
+                        const size_t length );
+void SPIReplayGetStatus( SPI_TRACE_REPLAY_STATUS * status );
+
+/* Recorded time of the last record replayed - use as the clock of the code under test to reproduce trace timing */
+uint32_t SPIReplayGetTraceTime( void );
+
+#endif
@@ -0,0 +1,56 @@
+/* File: SPITransport
+ * Author: Henry Gilbert
+ * Description : Dispatches SPI transfers to the selected transport and frames them with chip select.
+ */
+
+#include "SPITransport.h"
+#include <stddef.h>
+
+static const SPI_TRANSPORT * activeTransport = NULL;
+static uint16_t activeChipSelectLine = 0;
+
+void SPISetTransport( const SPI_TRANSPORT * transport,
+                      const uint16_t chipSelectLine )
+{
+    activeTransport = transport;
+    activeChipSelectLine = chipSelectLine;
+}
+
+const SPI_TRANSPORT * SPIGetTransport( void )
+{
+    return activeTransport;
+}
+
+uint16_t SPIGetChipSelectLine( void )
+{
+    return activeChipSelectLine;
+}
+
+uint8_t SPIreadWriteWord( uint16_t writeData,
+                          uint16_t * readData )
+{
+    if ((NULL == activeTransport) || (NULL == readData))
+    {
+        return 1; // Error, no transport or invalid params
+    }
+
+    activeTransport->chipSelect( activeChipSelectLine, true );
+    *readData = activeTransport->transferWord( writeData );
+    activeTransport->chipSelect( activeChipSelectLine, false );
+    return 0;
+}
+
+uint8_t SPIreadWriteBuffer( const uint16_t * writeData,
+                            uint16_t * readData,
+                            const uint16_t numWords )
+{
+    if ((NULL == activeTransport) || (NULL == writeData) || (0 == numWords))
+    {
+        return 1; // Error, no transport or invalid params
+    }
+
+    activeTransport->chipSelect( activeChipSelectLine, true );
+    activeTransport->transferBuffer( writeData, readData, numWords );
+    activeTransport->chipSelect( activeChipSelectLine, false );
+    return 0;
+}
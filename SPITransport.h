@@ -0,0 +1,50 @@
+/* File: SPITransport
+ * Author: Henry Gilbert
+ * Description : Hardware independent SPI transport. A transport is a set of function pointers that clock 16 bit
+ *      words and drive chip select lines. The dsPIC SPI1 port (newSPI) and the Linux host model (hostSPI) are the
+ *      two implementations - everything above this layer (MAX3109, SPItoUART) only calls the functions below.
+ */
+
+#ifndef SPI_TRANSPORT_H
+#define SPI_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Transfer functions only clock words - chip select is driven separately through chipSelect, so one transport
+ * can serve several devices on the same bus. The meaning of chipSelectLine is backend specific.
+ * startWord and enableCompletionInterrupt are the non-blocking path used by SPIAsync: startWord begins clocking a
+ * word and returns immediately, and the backend reports the received word through SPIAsyncWordComplete() from its
+ * completion interrupt while that interrupt is enabled. */
+typedef struct SPI_TRANSPORT_t {
+    uint16_t (*transferWord)( const uint16_t writeData );
+    void (*transferBuffer)( const uint16_t * writeData,
+                            uint16_t * readData,
+                            const uint16_t numWords );
+    void (*chipSelect)( const uint16_t chipSelectLine,
+                        const bool isSelected );
+    void (*startWord)( const uint16_t writeData );
+    void (*enableCompletionInterrupt)( const bool isEnabled );
+} SPI_TRANSPORT;
+
+/* Selects the transport and chip select line used by all following SPI calls */
+void SPISetTransport( const SPI_TRANSPORT * transport,
+                      const uint16_t chipSelectLine );
+
+/* Returns the transport selected by SPISetTransport, NULL if none */
+const SPI_TRANSPORT * SPIGetTransport( void );
+
+/* Returns the chip select line selected by SPISetTransport */
+uint16_t SPIGetChipSelectLine( void );
+
+/* Reads and writes a single 16 bit word in its own chip select frame. Returns 0 on success, 1 if no transport is set. */
+uint8_t SPIreadWriteWord( uint16_t writeData,
+                          uint16_t * readData );
+
+/* Reads and writes a buffer of 16 bit words with chip select held for the entire transfer. readData may point at
+ * writeData, or be NULL if the response words are not needed. Returns 0 on success, 1 on error. */
+uint8_t SPIreadWriteBuffer( const uint16_t * writeData,
+                            uint16_t * readData,
+                            const uint16_t numWords );
+
+#endif
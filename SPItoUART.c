@@ -5,46 +5,291 @@
  */
 
 #include "SPItoUART.h"
+#include "MAX3109Stats.h"
 #include <stdbool.h> 
 
-/* Global circular buffer definitions */
-circBuffer_t* pUART3rxCircBuff ;
-circBuffer_t* pUART3txCircBuff ;
+#define NUM_LEGACY_PORTS 2
+#define STATS_CHANNEL_INDEX(channel) ( ( UART_1 == ( channel ) ) ? 1 : 0 )
+#define STATS_GATHER_BYTES_WANTED(gather) ( ( ( gather )->numBytesRemaining < MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ? \
+        ( gather )->numBytesRemaining : MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES )
 
-circBuffer_t* pUART4rxCircBuff ;
-circBuffer_t* pUART4txCircBuff ;
+/* AFC004 single chip ports - index 0 is UART3 (MAX3109 UART_0), index 1 is UART4 (UART_1) */
+static MAX3109_UART_PORT legacyPorts [ NUM_LEGACY_PORTS ] ;
+static MAX3109_UART_PORT_SET legacyPortSet = { legacyPorts, NUM_LEGACY_PORTS, 0 } ;
 
-bool isUART3initialized = false ;
-bool isUART4initialized = false ;
+static uint32_t ( * portClock ) ( void ) = NULL ;
 
-/* Function Prototypes*/
+/* Local Function Prototypes */
+static uint16_t DrainUARTRxFIFO ( const MAX3109_UART_SELECTION channel, circBuffer_t * rxBuf, NmeaFramer * rxFramer ) ;
+static uint32_t ReadPortClock ( void ) ;
+static bool IsUARTPortRxServiceDue ( const MAX3109_UART_PORT * port, const uint32_t now ) ;
 
-/* The UART line configs are already setup during MAX chip setup. Only need setup for Circular Buffer */
-void InitializeUART3 ( circBuffer_t* uart3RxCircBuff, circBuffer_t* uart3TxCircBuff )
+/* Binds a port to a chip, a channel and its software buffers. The UART line configs are set up during MAX chip setup.
+ A txBufSize of 0 leaves the port receive only as far as WriteToUARTPort goes. */
+void InitializeUARTPort ( MAX3109_UART_PORT * port, MAX3109_DEVICE * device, const MAX3109_UART_SELECTION channel,
+                          circBuffer_t * rxBuf, circBuffer_t * txBuf, const uint16_t txBufSize )
 {
-   if ( ( NULL == uart3RxCircBuff ) ||
-        ( NULL == uart3TxCircBuff ) )
+   if ( ( NULL == port ) ||
+        ( NULL == rxBuf ) ||
+        ( NULL == txBuf ) ||
+        ( ( UART_0 != channel ) && ( UART_1 != channel ) ) )
    {
       return ; // Error, invalid params
    }
 
-   pUART3rxCircBuff = uart3RxCircBuff ;
-   pUART3txCircBuff = uart3TxCircBuff ;
-   isUART3initialized = true ;
+   port->device = device ;
+   port->channel = channel ;
+   port->rxBuf = rxBuf ;
+   port->txBuf = txBuf ;
+   port->txBufSize = txBufSize ;
+   port->txPendingBytes = 0 ;
+   port->rxFramer = NULL ;
+   port->rxBlocks = NULL ;
+   port->txGather = NULL ;
+   port->isInitialized = true ;
    return ;
 }
 
-void InitializeUART4 ( circBuffer_t* uart4RxCircBuff, circBuffer_t* uart4TxCircBuff )
+void InitializeUARTPortSet ( MAX3109_UART_PORT_SET * portSet, MAX3109_UART_PORT * ports, const uint8_t numPorts )
 {
-   if ( ( NULL == uart4RxCircBuff ) ||
-        ( NULL == uart4TxCircBuff ) )
+   if ( NULL == portSet )
    {
-      return ; // Error, invalid params
+      return ;
    }
-   pUART4rxCircBuff = uart4RxCircBuff ;
-   pUART4txCircBuff = uart4TxCircBuff ;
-   isUART4initialized = true ;
-   return ;
+
+   portSet->ports = ports ;
+   portSet->numPorts = ( NULL == ports ) ? 0 : numPorts ;
+   portSet->nextServicedPort = 0 ;
+}
+
+/* Routes the port's received bytes to a sentence framer instead of its rx circular buffer. NULL detaches it again. */
+void AttachUARTPortFramer ( MAX3109_UART_PORT * port, NmeaFramer * rxFramer )
+{
+   if ( NULL == port )
+   {
+      return ;
+   }
+   port->rxFramer = rxFramer ;
+}
+
+/* Routes the port's received bytes into a ring of blocks. NULL detaches it again. */
+void AttachUARTPortRxBlocks ( MAX3109_UART_PORT * port, UART_RX_BLOCK_RING * rxBlocks )
+{
+   if ( NULL == port )
+   {
+      return ;
+   }
+   port->rxBlocks = rxBlocks ;
+}
+
+void SetUARTPortClock ( uint32_t ( * clock ) ( void ) )
+{
+   portClock = clock ;
+}
+
+/* Drains the port's RxFIFO into its blocks, its framer, or its rx circular buffer, in that order of preference. The
+ port's chip must be selected. Returns the number of bytes read. */
+uint16_t ReadDataFromUARTPort ( MAX3109_UART_PORT * port )
+{
+   if ( ( NULL == port ) ||
+        ( false == port->isInitialized ) )
+   {
+      return 0 ;
+   }
+
+   if ( NULL != port->rxBlocks )
+   {
+      MAX_STATS_CYCLE_START ( startCycles ) ;
+      uint16_t numBytesRead = DrainUARTRxFIFOToBlocks ( port->channel, port->rxBlocks, ReadPortClock ( ) ) ;
+      MAX_STATS_READ_CYCLES ( startCycles ) ;
+      return numBytesRead ;
+   }
+   return DrainUARTRxFIFO ( port->channel, port->rxBuf, port->rxFramer ) ;
+}
+
+/* Queued bytes go out on the following ServiceUARTPorts calls as FIFO space allows. The free space in txBuf is known
+ from txPendingBytes, as the port is the only writer. */
+uint16_t WriteToUARTPort ( MAX3109_UART_PORT * port, const uint8_t * data, const uint16_t numBytes )
+{
+   if ( ( NULL == port ) ||
+        ( NULL == data ) ||
+        ( false == port->isInitialized ) )
+   {
+      return 0 ;
+   }
+
+   uint16_t txBufSpace = ( port->txPendingBytes < port->txBufSize ) ? ( port->txBufSize - port->txPendingBytes ) : 0 ;
+   uint16_t numBytesToQueue = ( numBytes < txBufSpace ) ? numBytes : txBufSpace ;
+
+   uint16_t counter ;
+   for ( counter = 0 ; counter < numBytesToQueue ; counter++ )
+   {
+      cb_push ( port->txBuf, data [ counter ] ) ;
+   }
+   port->txPendingBytes += numBytesToQueue ;
+   return numBytesToQueue ;
+}
+
+uint8_t WriteFragmentsToUARTPort ( MAX3109_UART_PORT * port, MAX3109_TX_GATHER * gather )
+{
+   if ( ( NULL == port ) ||
+        ( NULL == gather ) ||
+        ( false == port->isInitialized ) )
+   {
+      return 0 ;
+   }
+
+   if ( ( port->txPendingBytes > 0 ) ||
+        ( NULL != port->txGather ) )
+   {
+      return 0 ; // Earlier bytes go out first
+   }
+
+   if ( gather->numBytesRemaining > 0 )
+   {
+      port->txGather = gather ;
+   }
+   return 1 ;
+}
+
+/* Round robin over all ports: select the port's chip, drain its RxFIFO, then refill its TxFIFO from pending bytes.
+ Returns the total number of bytes moved in both directions. */
+uint16_t ServiceUARTPorts ( MAX3109_UART_PORT_SET * portSet )
+{
+   if ( ( NULL == portSet ) ||
+        ( NULL == portSet->ports ) ||
+        ( 0 == portSet->numPorts ) )
+   {
+      return 0 ;
+   }
+
+   MAX3109_UART_PORT * ports = portSet->ports ;
+   uint8_t numPorts = portSet->numPorts ;
+   uint16_t numBytesMoved = 0 ;
+   uint8_t firstPort = portSet->nextServicedPort % numPorts ;
+   portSet->nextServicedPort = firstPort + 1 ;
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numPorts ; counter++ )
+   {
+      MAX3109_UART_PORT * port = &ports [ ( firstPort + counter ) % numPorts ] ;
+      if ( false == port->isInitialized )
+      {
+         continue ;
+      }
+
+      MAXSelectDevice ( port->device ) ;
+      numBytesMoved += ReadDataFromUARTPort ( port ) ;
+
+      if ( NULL != port->txGather )
+      {
+         numBytesMoved += WriteGatherToUARTTransmitBuffer ( port->channel, port->txGather ) ;
+         if ( 0 == port->txGather->numBytesRemaining )
+         {
+            port->txGather = NULL ;
+         }
+      }
+      else if ( port->txPendingBytes > 0 )
+      {
+         uint8_t numBytesToWrite = ( port->txPendingBytes < MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ?
+                 ( uint8_t ) port->txPendingBytes : MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ;
+         uint16_t numBytesWritten = WriteDataToUARTTransmitBuffer ( port->channel, port->txBuf, numBytesToWrite ) ;
+         port->txPendingBytes -= numBytesWritten ;
+         numBytesMoved += numBytesWritten ;
+      }
+   }
+   return numBytesMoved ;
+}
+
+/* Call when a MAX3109 IRQ line is asserted (see MAXConfigureReceiveInterrupts), or when IsUARTPortServiceRequested.
+ GlobalIRQ is read once per chip to find the UARTs that fired, and only those are acknowledged and drained, along with
+ any port whose rx blocks ask for a drain to end a throttle or hand over a timed out block - keep the ports of one chip
+ next to each other in the set, or the chip's GlobalIRQ is read again. Returns the total number of bytes read. */
+uint16_t ServiceUARTPortInterrupts ( MAX3109_UART_PORT_SET * portSet )
+{
+   if ( ( NULL == portSet ) ||
+        ( NULL == portSet->ports ) )
+   {
+      return 0 ;
+   }
+
+   MAX3109_UART_PORT * ports = portSet->ports ;
+   uint8_t numPorts = portSet->numPorts ;
+   uint16_t numBytesRead = 0 ;
+   bool isDevicePolled = false ;
+   MAX3109_DEVICE * polledDevice = NULL ;
+   uint8_t pendingUARTs = 0 ;
+   uint32_t now = ReadPortClock ( ) ;
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numPorts ; counter++ )
+   {
+      MAX3109_UART_PORT * port = &ports [ counter ] ;
+      if ( false == port->isInitialized )
+      {
+         continue ;
+      }
+
+      if ( ( false == isDevicePolled ) ||
+           ( port->device != polledDevice ) )
+      {
+         MAXSelectDevice ( port->device ) ;
+         pendingUARTs = MAXGetPendingInterruptUARTs ( ) ;
+         polledDevice = port->device ;
+         isDevicePolled = true ;
+      }
+
+      uint8_t pendingBit = ( UART_1 == port->channel ) ? MAX3109_PENDING_UART_1 : MAX3109_PENDING_UART_0 ;
+      if ( pendingUARTs & pendingBit )
+      {
+         MAXAcknowledgeUARTInterrupt ( port->channel ) ;
+         numBytesRead += ReadDataFromUARTPort ( port ) ;
+      }
+      else if ( IsUARTPortRxServiceDue ( port, now ) )
+      {
+         numBytesRead += ReadDataFromUARTPort ( port ) ;
+      }
+   }
+   return numBytesRead ;
+}
+
+bool IsUARTPortServiceRequested ( const MAX3109_UART_PORT_SET * portSet )
+{
+   if ( ( NULL == portSet ) ||
+        ( NULL == portSet->ports ) )
+   {
+      return false ;
+   }
+
+   uint32_t now = ReadPortClock ( ) ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < portSet->numPorts ; counter++ )
+   {
+      const MAX3109_UART_PORT * port = &portSet->ports [ counter ] ;
+      if ( ( port->isInitialized ) &&
+           ( IsUARTPortRxServiceDue ( port, now ) ) )
+      {
+         return true ;
+      }
+   }
+   return false ;
+}
+
+/* The AFC004 code writes its tx buffers through WriteDataToUARTTransmitBuffer, so the legacy ports never queue tx bytes */
+void InitializeUART3 ( circBuffer_t* uart3RxCircBuff, circBuffer_t* uart3TxCircBuff )
+{
+   InitializeUARTPort ( &legacyPorts [ 0 ], NULL, UART_0, uart3RxCircBuff, uart3TxCircBuff, 0 ) ;
+}
+
+void InitializeUART4 ( circBuffer_t* uart4RxCircBuff, circBuffer_t* uart4TxCircBuff )
+{
+   InitializeUARTPort ( &legacyPorts [ 1 ], NULL, UART_1, uart4RxCircBuff, uart4TxCircBuff, 0 ) ;
+}
+
+/* IRQ handler for the single chip AFC004 setup */
+uint16_t ServiceUARTReceiveInterrupts ( void )
+{
+   return ServiceUARTPortInterrupts ( &legacyPortSet ) ;
 }
 
 /* Get FIFO fill level, pop values from FIFO to circular buffer */
@@ -54,45 +299,125 @@ uint16_t ReadDataFromUARTBuffer ( const MAX3109_UART_SELECTION channel, circBuff
    {
       return 0 ;
    }
-   
+   return DrainUARTRxFIFO ( channel, rxBuf, NULL ) ;
+}
+
+/* Bytes go to rxFramer when one is given, otherwise to rxBuf */
+static uint16_t DrainUARTRxFIFO ( const MAX3109_UART_SELECTION channel, circBuffer_t * rxBuf, NmeaFramer * rxFramer )
+{
+   MAX_STATS_CYCLE_START ( startCycles ) ;
    uint8_t numBytesToRead = MAXGetUARTFIFOLevel ( channel,
            max3109_RxFIFOLvl ) ;
    
    if ( ( numBytesToRead > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ||
         ( 0 == numBytesToRead ) )
    {
+      MAX_STATS_READ_CYCLES ( startCycles ) ;
       return 0 ; // Error, or nothing to read.
    }
 
 
-   uint8_t counter ;
-   for ( counter = 0 ; counter < numBytesToRead ; counter++ )
-   {
-      uint8_t poppedValue = MAXPopSingleValueFromUARTRxFIFO ( channel ) ;
+   /* Drain the whole FIFO in one burst, then move it into the framer or the circular buffer */
+   uint8_t rxBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] ;
+   uint8_t numBytesRead = MAXPopBurstFromUARTRxFIFO ( channel, rxBytes, numBytesToRead ) ;
 
-      cb_push ( rxBuf, poppedValue ) ; // TODO replace this with CB flush in 
+   if ( NULL != rxFramer )
+   {
+      nf_feed ( rxFramer, rxBytes, numBytesRead ) ;
+   }
+   else
+   {
+      /* Byte by byte, as the circular buffer has no bulk push - a port that needs whole FIFO moves attaches rx blocks */
+      uint8_t counter ;
+      for ( counter = 0 ; counter < numBytesRead ; counter++ )
+      {
+         cb_push ( rxBuf, rxBytes [ counter ] ) ;
+      }
    }
    
-   return counter ; // Return num of bytes read 
+   MAX_STATS_READ_CYCLES ( startCycles ) ;
+   return numBytesRead ; // Return num of bytes read 
 }
 
+static uint32_t ReadPortClock ( void )
+{
+   return ( NULL == portClock ) ? 0 : portClock ( ) ;
+}
+
+/* A port with rx blocks needs a drain without an interrupt to end a throttle, or to hand over a partly filled block
+ once the line has gone quiet */
+static bool IsUARTPortRxServiceDue ( const MAX3109_UART_PORT * port, const uint32_t now )
+{
+   return ( IsUARTRxBlockServiceRequested ( port->rxBlocks ) ) ||
+          ( IsUARTRxBlockTimeoutDue ( port->rxBlocks, now ) ) ;
+}
+
+/* Writes up to numBytesToWrite bytes from the circular buffer to the TxFIFO, bounded by the free space in the FIFO.
+ The free space is read once, the bytes go out in a single burst, and only the accepted bytes are removed from the
+ circular buffer. Returns the number of bytes accepted by the FIFO - the remainder stays queued for the next call. */
 uint16_t WriteDataToUARTTransmitBuffer ( const MAX3109_UART_SELECTION channel, circBuffer_t * txBuf, uint8_t numBytesToWrite )
 {
+   if ( ( NULL == txBuf ) ||
+        ( 0 == numBytesToWrite ) )
+   {
+      return 0 ;
+   }
+
+   MAX_STATS_CYCLE_START ( startCycles ) ;
+   uint8_t txFIFOLevel = MAXGetUARTFIFOLevel ( channel,
+           max3109_TxFIFOLvl ) ;
+
+   if ( txFIFOLevel >= MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES )
+   {
+      MAX_STATS_TX_DEFERRED ( STATS_CHANNEL_INDEX ( channel ), numBytesToWrite ) ;
+      MAX_STATS_WRITE_CYCLES ( startCycles ) ;
+      return 0 ; // Error, or FIFO is full.
+   }
+
+   uint8_t txFIFOSpace = MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES - txFIFOLevel ;
+   uint8_t numBytesToSend = ( numBytesToWrite < txFIFOSpace ) ? numBytesToWrite : txFIFOSpace ;
+
+   uint8_t txBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] ;
    uint8_t counter ;
-   uint8_t numBytesWritten = 0 ;
-   uint8_t errorCounter = 0 ;
-   
-   /* Disable transmit buffer while writing */
-   
-   for ( counter = 0 ; counter < numBytesToWrite ; counter++ )
+   for ( counter = 0 ; counter < numBytesToSend ; counter++ )
    {
-      uint8_t dataToWrite = cb_peek ( txBuf, counter ) ;
-      errorCounter += MAXPushSingleValueToUARTTxFIFO ( channel, dataToWrite ) ;
-      numBytesWritten++ ;
+      txBytes [ counter ] = cb_peek ( txBuf, counter ) ;
    }
-   /* Enable transmission when finished writing to buffer */
-   
-   
+
+   uint8_t numBytesWritten = MAXPushBurstToUARTTxFIFO ( channel, txBytes, numBytesToSend ) ;
+
    cb_advance_tail ( txBuf, numBytesWritten ) ;
-   return ( 0 == errorCounter ) ? ( numBytesWritten ) : 0 ;
+   MAX_STATS_TX_DEFERRED ( STATS_CHANNEL_INDEX ( channel ), numBytesToWrite - numBytesWritten ) ;
+   MAX_STATS_WRITE_CYCLES ( startCycles ) ;
+   return numBytesWritten ;
+}
+
+/* Writes as much of a gather as the TxFIFO has room for, straight from its fragments. The free space is read once and
+ the bytes go out in a single burst. Returns the number of bytes accepted - the gather keeps its place for the next call. */
+uint16_t WriteGatherToUARTTransmitBuffer ( const MAX3109_UART_SELECTION channel, MAX3109_TX_GATHER * gather )
+{
+   if ( ( NULL == gather ) ||
+        ( 0 == gather->numBytesRemaining ) )
+   {
+      return 0 ;
+   }
+
+   MAX_STATS_CYCLE_START ( startCycles ) ;
+   uint8_t txFIFOLevel = MAXGetUARTFIFOLevel ( channel,
+           max3109_TxFIFOLvl ) ;
+
+   if ( txFIFOLevel >= MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES )
+   {
+      MAX_STATS_TX_DEFERRED ( STATS_CHANNEL_INDEX ( channel ), STATS_GATHER_BYTES_WANTED ( gather ) ) ;
+      MAX_STATS_WRITE_CYCLES ( startCycles ) ;
+      return 0 ; // Error, or FIFO is full.
+   }
+
+   uint8_t txFIFOSpace = MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES - txFIFOLevel ;
+   MAX_STATS_TX_DEFERRED ( STATS_CHANNEL_INDEX ( channel ),
+           ( STATS_GATHER_BYTES_WANTED ( gather ) > txFIFOSpace ) ? ( STATS_GATHER_BYTES_WANTED ( gather ) - txFIFOSpace ) : 0 ) ;
+   uint8_t numBytesWritten = MAXPushGatherToUARTTxFIFO ( channel, gather, txFIFOSpace ) ;
+
+   MAX_STATS_WRITE_CYCLES ( startCycles ) ;
+   return numBytesWritten ;
 }
\ No newline at end of file
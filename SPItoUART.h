@@ -3,13 +3,66 @@
 
 #include "MAX3109.h"
 #include "CircularBuffer.h"
+#include "nmeaFramer.h"
+#include "UARTRxBlocks.h"
+
+/* One UART channel of one MAX3109 chip and the software buffers behind it. Any number of ports on any number of
+ chips can be serviced together - see ServiceUARTPorts. */
+typedef struct MAX3109_UART_PORT_t {
+   MAX3109_DEVICE * device ; // NULL uses whichever chip is currently selected
+   MAX3109_UART_SELECTION channel ;
+   circBuffer_t * rxBuf ;
+   circBuffer_t * txBuf ;
+   uint16_t txBufSize ; // Capacity of txBuf, which only this port may push to
+   uint16_t txPendingBytes ; // Queued in txBuf by WriteToUARTPort and not yet accepted by the TxFIFO, at most txBufSize
+   NmeaFramer * rxFramer ; // When attached, received bytes are framed into sentences instead of going to rxBuf
+   UART_RX_BLOCK_RING * rxBlocks ; // When attached, received bytes are drained straight into blocks - takes priority
+   MAX3109_TX_GATHER * txGather ; // Fragmented message being sent by WriteFragmentsToUARTPort, NULL when none
+   bool isInitialized ;
+} MAX3109_UART_PORT ;
+
+/* Ports serviced together by ServiceUARTPorts and ServiceUARTPortInterrupts. Each set keeps its own round robin
+ position. */
+typedef struct MAX3109_UART_PORT_SET_t {
+   MAX3109_UART_PORT * ports ;
+   uint8_t numPorts ;
+   uint8_t nextServicedPort ; // Rotates the first port serviced so no port always goes first
+} MAX3109_UART_PORT_SET ;
 
 uint16_t ReadDataFromUARTBuffer( const MAX3109_UART_SELECTION channel, circBuffer_t * cb );
 uint16_t WriteDataToUARTTransmitBuffer(const MAX3109_UART_SELECTION channel, circBuffer_t * txBuf, uint8_t numBytesToWrite  );
+uint16_t WriteGatherToUARTTransmitBuffer( const MAX3109_UART_SELECTION channel, MAX3109_TX_GATHER * gather );
+
+void InitializeUARTPort( MAX3109_UART_PORT * port, MAX3109_DEVICE * device, const MAX3109_UART_SELECTION channel,
+                         circBuffer_t * rxBuf, circBuffer_t * txBuf, const uint16_t txBufSize );
+void InitializeUARTPortSet( MAX3109_UART_PORT_SET * portSet, MAX3109_UART_PORT * ports, const uint8_t numPorts );
+
+/* Queues as many bytes as txBuf has room for. Returns the number queued - the rest did not fit and was not taken. */
+uint16_t WriteToUARTPort( MAX3109_UART_PORT * port, const uint8_t * data, const uint16_t numBytes );
 
+/* Sends a message from its fragments without copying it into txBuf - ServiceUARTPorts moves it into the TxFIFO over
+ as many refills as it needs. Bytes queued by WriteToUARTPort meanwhile wait until the message is out. Returns 1 if the
+ gather was taken, 0 if the port is still sending earlier bytes. The gather's numBytesRemaining is 0 once it is sent. */
+uint8_t WriteFragmentsToUARTPort( MAX3109_UART_PORT * port, MAX3109_TX_GATHER * gather );
+void AttachUARTPortFramer( MAX3109_UART_PORT * port, NmeaFramer * rxFramer );
+void AttachUARTPortRxBlocks( MAX3109_UART_PORT * port, UART_RX_BLOCK_RING * rxBlocks );
+uint16_t ReadDataFromUARTPort( MAX3109_UART_PORT * port );
+
+/* Free running clock for block timestamps and timeouts, e.g. a timer count. Without one every timestamp is 0. */
+void SetUARTPortClock( uint32_t ( * clock ) ( void ) );
+uint16_t ServiceUARTPorts( MAX3109_UART_PORT_SET * portSet );
+uint16_t ServiceUARTPortInterrupts( MAX3109_UART_PORT_SET * portSet );
+
+/* True if any port's rx blocks were released while throttled, or hold a partly filled block past its timeout. No IRQ
+ comes for those ports while auto RTS holds the sender or the line is quiet, so call ServiceUARTPortInterrupts from the
+ main loop when this returns true. */
+bool IsUARTPortServiceRequested( const MAX3109_UART_PORT_SET * portSet );
+
+/* Single chip AFC004 wrappers - UART3 is MAX3109 UART_0, UART4 is UART_1 on the chip selected by InitializeSPI */
 void InitializeUART3(circBuffer_t* uart3RxCircBuff, circBuffer_t* uart3TxCircBuff );
 void InitializeUART4(circBuffer_t* uart4RxCircBuff, circBuffer_t* uart4TxCircBuff );
 
+uint16_t ServiceUARTReceiveInterrupts( void );
+
 #endif 
 
- 
\ No newline at end of file
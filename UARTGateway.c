@@ -0,0 +1,372 @@
+/*
+ File: Linux gateway exposing MAX3109 UART channels as pseudo-terminals
+ Author: Henry Gilbert
+
+ Single threaded: one epoll loop waits on a timerfd and every PTY master. The timer runs ServiceUARTPorts over all
+ channels, which drains the RxFIFOs into blocks and refills the TxFIFOs from the channel gathers. The PTYs are only
+ read while their channel has no gather in flight and only polled for writing while a block is stuck on them, so a
+ slow side backs up into the other instead of dropping bytes.
+ */
+
+#define _GNU_SOURCE
+#include "UARTGateway.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define TIMER_EVENT_TOKEN 0xFFFFFFFFUL // epoll data of the timerfd, PTYs carry their channel index
+#define MAXIMUM_EVENTS_PER_WAIT 64
+
+/* Local Function Prototypes */
+static uint32_t GatewayClock ( void ) ;
+static uint8_t OpenChannelPTY ( UART_GATEWAY_CHANNEL * channel ) ;
+static uint32_t ChannelCharacterTime ( const MAX3109_UART_PORT * port, const uint32_t referenceClockHz ) ;
+static void ReadPTYToGather ( UART_GATEWAY * gateway, const uint8_t channelIndex ) ;
+static void WriteBlocksToPTY ( UART_GATEWAY * gateway, UART_GATEWAY_CHANNEL * channel, const uint32_t now ) ;
+static void ServiceChannels ( UART_GATEWAY * gateway ) ;
+static uint8_t UpdatePTYEvents ( UART_GATEWAY * gateway, const uint8_t channelIndex ) ;
+
+uint8_t InitializeUARTGateway ( UART_GATEWAY * gateway, MAX3109_DEVICE * * devices, const uint8_t numChannels,
+                                const uint32_t referenceClockHz, const uint32_t servicePeriod_us )
+{
+   if ( ( NULL == gateway ) ||
+        ( NULL == devices ) ||
+        ( 0 == numChannels ) ||
+        ( numChannels > UART_GATEWAY_MAX_CHANNELS ) ||
+        ( 0 == servicePeriod_us ) )
+   {
+      return 0 ; // Error, invalid params
+   }
+
+   memset ( gateway, 0, sizeof ( *gateway ) ) ;
+   gateway->epollFd = -1 ;
+   gateway->timerFd = -1 ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < UART_GATEWAY_MAX_CHANNELS ; counter++ )
+   {
+      gateway->channels [ counter ].ptyFd = -1 ;
+      gateway->channels [ counter ].ptySlaveFd = -1 ;
+   }
+   ResetUARTLatencyHistogram ( &gateway->rxLatency ) ;
+   SetUARTPortClock ( GatewayClock ) ;
+
+   gateway->epollFd = epoll_create1 ( EPOLL_CLOEXEC ) ;
+   gateway->timerFd = timerfd_create ( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) ;
+   if ( ( gateway->epollFd < 0 ) ||
+        ( gateway->timerFd < 0 ) )
+   {
+      CloseUARTGateway ( gateway ) ;
+      return 0 ;
+   }
+
+   struct itimerspec period = { 0 } ;
+   period.it_interval.tv_sec = servicePeriod_us / 1000000UL ;
+   period.it_interval.tv_nsec = ( long ) ( servicePeriod_us % 1000000UL ) * 1000L ;
+   period.it_value = period.it_interval ;
+   struct epoll_event timerEvent = { 0 } ;
+   timerEvent.events = EPOLLIN ;
+   timerEvent.data.u32 = TIMER_EVENT_TOKEN ;
+   if ( ( 0 != timerfd_settime ( gateway->timerFd, 0, &period, NULL ) ) ||
+        ( 0 != epoll_ctl ( gateway->epollFd, EPOLL_CTL_ADD, gateway->timerFd, &timerEvent ) ) )
+   {
+      CloseUARTGateway ( gateway ) ;
+      return 0 ;
+   }
+
+   for ( counter = 0 ; counter < numChannels ; counter++ )
+   {
+      UART_GATEWAY_CHANNEL * channel = &gateway->channels [ counter ] ;
+      MAX3109_UART_PORT * port = &gateway->ports [ counter ] ;
+      gateway->numChannels = counter + 1 ; // Covers the channel in CloseUARTGateway from here on
+
+      InitializeUARTPort ( port, devices [ counter / 2 ], ( counter & 0x01 ) ? UART_1 : UART_0,
+                           &channel->rxBuf, &channel->txBuf, 0 ) ;
+      uint32_t characterTime = ChannelCharacterTime ( port, referenceClockHz ) ;
+      struct epoll_event ptyEvent = { 0 } ;
+      ptyEvent.events = EPOLLIN ;
+      ptyEvent.data.u32 = counter ;
+      if ( ( 0 == characterTime ) ||
+           ( 0 == InitializeUARTRxBlockRing ( &channel->rxBlocks, channel->blocks, UART_GATEWAY_RX_BLOCKS,
+                                              UART_GATEWAY_RX_TIMEOUT_US ) ) ||
+           ( 0 == SetUARTRxBlockWatermarks ( &channel->rxBlocks, UART_GATEWAY_RX_BLOCKS - 1, 1 ) ) ||
+           ( 0 == OpenChannelPTY ( channel ) ) ||
+           ( 0 != epoll_ctl ( gateway->epollFd, EPOLL_CTL_ADD, channel->ptyFd, &ptyEvent ) ) )
+      {
+         CloseUARTGateway ( gateway ) ;
+         return 0 ;
+      }
+      SetUARTRxBlockCharacterTime ( &channel->rxBlocks, characterTime ) ;
+      AttachUARTPortRxBlocks ( port, &channel->rxBlocks ) ;
+      channel->ptyEvents = EPOLLIN ;
+   }
+   InitializeUARTPortSet ( &gateway->portSet, gateway->ports, gateway->numChannels ) ;
+   gateway->lastServiceTime = GatewayClock ( ) ;
+   return 1 ;
+}
+
+uint8_t RunUARTGateway ( UART_GATEWAY * gateway )
+{
+   if ( ( NULL == gateway ) ||
+        ( gateway->epollFd < 0 ) )
+   {
+      return 0 ;
+   }
+
+   struct epoll_event events [ MAXIMUM_EVENTS_PER_WAIT ] ;
+   while ( 0 == gateway->isStopRequested )
+   {
+      int numEvents = epoll_wait ( gateway->epollFd, events, MAXIMUM_EVENTS_PER_WAIT, -1 ) ;
+      if ( numEvents < 0 )
+      {
+         if ( EINTR == errno )
+         {
+            continue ;
+         }
+         return 0 ;
+      }
+
+      int counter ;
+      for ( counter = 0 ; counter < numEvents ; counter++ )
+      {
+         if ( TIMER_EVENT_TOKEN == events [ counter ].data.u32 )
+         {
+            uint64_t numExpirations ;
+            if ( read ( gateway->timerFd, &numExpirations, sizeof ( numExpirations ) ) > 0 )
+            {
+               ServiceChannels ( gateway ) ;
+            }
+            continue ;
+         }
+
+         uint8_t channelIndex = ( uint8_t ) events [ counter ].data.u32 ;
+         UART_GATEWAY_CHANNEL * channel = &gateway->channels [ channelIndex ] ;
+         if ( events [ counter ].events & EPOLLOUT )
+         {
+            channel->isPTYFull = false ;
+            WriteBlocksToPTY ( gateway, channel, GatewayClock ( ) ) ;
+         }
+         if ( events [ counter ].events & EPOLLIN )
+         {
+            ReadPTYToGather ( gateway, channelIndex ) ;
+         }
+         if ( 0 == UpdatePTYEvents ( gateway, channelIndex ) )
+         {
+            return 0 ;
+         }
+      }
+   }
+   return 1 ;
+}
+
+void StopUARTGateway ( UART_GATEWAY * gateway )
+{
+   if ( NULL != gateway )
+   {
+      gateway->isStopRequested = 1 ;
+   }
+}
+
+void CloseUARTGateway ( UART_GATEWAY * gateway )
+{
+   if ( NULL == gateway )
+   {
+      return ;
+   }
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < gateway->numChannels ; counter++ )
+   {
+      UART_GATEWAY_CHANNEL * channel = &gateway->channels [ counter ] ;
+      if ( channel->ptyFd >= 0 )
+      {
+         close ( channel->ptyFd ) ;
+         channel->ptyFd = -1 ;
+      }
+      if ( channel->ptySlaveFd >= 0 )
+      {
+         close ( channel->ptySlaveFd ) ;
+         channel->ptySlaveFd = -1 ;
+      }
+   }
+   if ( gateway->timerFd >= 0 )
+   {
+      close ( gateway->timerFd ) ;
+      gateway->timerFd = -1 ;
+   }
+   if ( gateway->epollFd >= 0 )
+   {
+      close ( gateway->epollFd ) ;
+      gateway->epollFd = -1 ;
+   }
+}
+
+/* Microseconds, wraps every 71 minutes like the rest of the 32 bit clocks in the driver */
+static uint32_t GatewayClock ( void )
+{
+   struct timespec now ;
+   clock_gettime ( CLOCK_MONOTONIC, &now ) ;
+   return ( uint32_t ) ( ( ( uint64_t ) now.tv_sec * 1000000ULL ) + ( ( uint64_t ) now.tv_nsec / 1000ULL ) ) ;
+}
+
+/* Microseconds per character on the line, rounded, from the channel's programmed baud rate and line config. Returns 0
+ if the channel reads back no baud rate. */
+static uint32_t ChannelCharacterTime ( const MAX3109_UART_PORT * port, const uint32_t referenceClockHz )
+{
+   MAXSelectDevice ( port->device ) ;
+   uint32_t baudRate = MAXGetUARTBaudRate ( port->channel, referenceClockHz ) ;
+   uint8_t bitsPerCharacter = MAXGetUARTBitsPerCharacter ( port->channel ) ;
+   if ( 0 == baudRate )
+   {
+      return 0 ;
+   }
+   uint32_t characterTime = ( uint32_t ) ( ( ( uint64_t ) bitsPerCharacter * 1000000ULL + ( baudRate / 2 ) ) / baudRate ) ;
+   return ( 0 == characterTime ) ? 1 : characterTime ;
+}
+
+/* Non-blocking master, raw slave so bytes pass through the line discipline unchanged and nothing is echoed back */
+static uint8_t OpenChannelPTY ( UART_GATEWAY_CHANNEL * channel )
+{
+   channel->ptyFd = posix_openpt ( O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC ) ;
+   if ( ( channel->ptyFd < 0 ) ||
+        ( 0 != grantpt ( channel->ptyFd ) ) ||
+        ( 0 != unlockpt ( channel->ptyFd ) ) ||
+        ( 0 != ptsname_r ( channel->ptyFd, channel->ptyName, sizeof ( channel->ptyName ) ) ) )
+   {
+      return 0 ;
+   }
+
+   channel->ptySlaveFd = open ( channel->ptyName, O_RDWR | O_NOCTTY | O_CLOEXEC ) ;
+   struct termios rawMode ;
+   if ( ( channel->ptySlaveFd < 0 ) ||
+        ( 0 != tcgetattr ( channel->ptySlaveFd, &rawMode ) ) )
+   {
+      return 0 ;
+   }
+   cfmakeraw ( &rawMode ) ;
+   return ( 0 == tcsetattr ( channel->ptySlaveFd, TCSANOW, &rawMode ) ) ? 1 : 0 ;
+}
+
+/* One read per readable event - the batch goes out as a gather and the PTY is not read again until it has */
+static void ReadPTYToGather ( UART_GATEWAY * gateway, const uint8_t channelIndex )
+{
+   UART_GATEWAY_CHANNEL * channel = &gateway->channels [ channelIndex ] ;
+   MAX3109_UART_PORT * port = &gateway->ports [ channelIndex ] ;
+   if ( NULL != port->txGather )
+   {
+      return ;
+   }
+
+   ssize_t numBytesRead = read ( channel->ptyFd, channel->txBatch, sizeof ( channel->txBatch ) ) ;
+   if ( numBytesRead <= 0 )
+   {
+      return ; // EAGAIN, or a client closing its side
+   }
+
+   channel->txFragment.data = channel->txBatch ;
+   channel->txFragment.numBytes = ( uint16_t ) numBytesRead ;
+   channel->txFragment.isChecksummed = false ;
+   channel->txFragment.isChecksumTrailer = false ;
+   MAXInitializeTxGather ( &channel->txGather, &channel->txFragment, 1 ) ;
+   WriteFragmentsToUARTPort ( port, &channel->txGather ) ;
+   channel->bytesToUART += ( uint64_t ) numBytesRead ;
+}
+
+/* Hands ready blocks to the PTY until it stops taking bytes. A block is released only once fully written, so while
+ the PTY is full the ring fills, draining stops at its high watermark and auto RTS throttles the sender. */
+static void WriteBlocksToPTY ( UART_GATEWAY * gateway, UART_GATEWAY_CHANNEL * channel, const uint32_t now )
+{
+   while ( false == channel->isPTYFull )
+   {
+      if ( NULL == channel->ptyBlock )
+      {
+         channel->ptyBlock = GetUARTRxBlock ( &channel->rxBlocks ) ;
+         channel->ptyBlockOffset = 0 ;
+         if ( NULL == channel->ptyBlock )
+         {
+            return ;
+         }
+      }
+
+      UART_RX_BLOCK * block = channel->ptyBlock ;
+      ssize_t numBytesWritten = write ( channel->ptyFd, &block->data [ channel->ptyBlockOffset ],
+                                        block->numBytes - channel->ptyBlockOffset ) ;
+      if ( numBytesWritten < 0 )
+      {
+         if ( ( EAGAIN == errno ) ||
+              ( EWOULDBLOCK == errno ) )
+         {
+            channel->isPTYFull = true ;
+            return ;
+         }
+         numBytesWritten = block->numBytes - channel->ptyBlockOffset ; // Unrecoverable, drop the block
+      }
+
+      channel->ptyBlockOffset += ( uint16_t ) numBytesWritten ;
+      if ( channel->ptyBlockOffset < block->numBytes )
+      {
+         channel->isPTYFull = true ; // Short write, the PTY buffer is full
+         return ;
+      }
+
+      RecordUARTRxBlockLatency ( &gateway->rxLatency, block, now ) ;
+      channel->bytesFromUART += block->numBytes ;
+      ReleaseUARTRxBlock ( &channel->rxBlocks, block ) ;
+      channel->ptyBlock = NULL ;
+   }
+}
+
+static void ServiceChannels ( UART_GATEWAY * gateway )
+{
+   if ( NULL != gateway->onServiceTick )
+   {
+      gateway->onServiceTick ( gateway->tickContext ) ;
+   }
+   uint16_t numBytesMoved = ServiceUARTPorts ( &gateway->portSet ) ;
+
+   /* Timer expirations may have been merged, so the period is measured rather than assumed */
+   uint32_t now = GatewayClock ( ) ;
+   if ( numBytesMoved > 0 )
+   {
+      gateway->activeTime_us += now - gateway->lastServiceTime ;
+   }
+   gateway->lastServiceTime = now ;
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < gateway->numChannels ; counter++ )
+   {
+      WriteBlocksToPTY ( gateway, &gateway->channels [ counter ], now ) ;
+      UpdatePTYEvents ( gateway, counter ) ;
+   }
+}
+
+/* Read the PTY only while no gather is in flight, poll it for writing only while a block is stuck on it */
+static uint8_t UpdatePTYEvents ( UART_GATEWAY * gateway, const uint8_t channelIndex )
+{
+   UART_GATEWAY_CHANNEL * channel = &gateway->channels [ channelIndex ] ;
+   uint32_t events = ( NULL == gateway->ports [ channelIndex ].txGather ) ? EPOLLIN : 0 ;
+   if ( channel->isPTYFull )
+   {
+      events |= EPOLLOUT ;
+   }
+   if ( events == channel->ptyEvents )
+   {
+      return 1 ;
+   }
+
+   struct epoll_event ptyEvent = { 0 } ;
+   ptyEvent.events = events ;
+   ptyEvent.data.u32 = channelIndex ;
+   if ( 0 != epoll_ctl ( gateway->epollFd, EPOLL_CTL_MOD, channel->ptyFd, &ptyEvent ) )
+   {
+      return 0 ;
+   }
+   channel->ptyEvents = events ;
+   return 1 ;
+}
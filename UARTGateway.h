@@ -0,0 +1,70 @@
+#ifndef UART_GATEWAY_H
+#define UART_GATEWAY_H
+
+#include <signal.h>
+#include "SPItoUART.h"
+#include "UARTLatency.h"
+
+#define UART_GATEWAY_MAX_CHANNELS 64
+#define UART_GATEWAY_RX_BLOCKS 4 // Per channel, a power of two
+#define UART_GATEWAY_RX_TIMEOUT_US 2000 // A partly filled block goes to the PTY once its first byte is this old
+#define UART_GATEWAY_TX_BATCH_BYTES 512 // Most bytes taken from a PTY in one read
+#define UART_GATEWAY_PTY_NAME_LENGTH 64
+
+/* One MAX3109 UART exposed as a pseudo-terminal. Received bytes go from the RxFIFO into blocks and from the blocks to
+ the PTY master. Bytes written to the PTY slave are read in batches and sent to the TxFIFO as a gather, straight from
+ the batch buffer. */
+typedef struct UART_GATEWAY_CHANNEL_t {
+   circBuffer_t rxBuf ; // Required by InitializeUARTPort, unused - bytes arrive in rxBlocks
+   circBuffer_t txBuf ; // Required by InitializeUARTPort, unused - bytes leave as txGather
+   UART_RX_BLOCK blocks [ UART_GATEWAY_RX_BLOCKS ] ;
+   UART_RX_BLOCK_RING rxBlocks ;
+   UART_RX_BLOCK * ptyBlock ; // Block being written to the PTY, NULL when none
+   uint16_t ptyBlockOffset ; // Bytes of ptyBlock the PTY has taken
+   bool isPTYFull ; // The last write to the PTY was cut short - wait for EPOLLOUT
+   uint8_t txBatch [ UART_GATEWAY_TX_BATCH_BYTES ] ;
+   MAX3109_TX_FRAGMENT txFragment ;
+   MAX3109_TX_GATHER txGather ;
+   int ptyFd ; // Master side
+   int ptySlaveFd ; // Held open so the master never reports a hangup while no client has the slave open
+   uint32_t ptyEvents ; // Events currently registered with epoll for ptyFd
+   char ptyName [ UART_GATEWAY_PTY_NAME_LENGTH ] ;
+   uint64_t bytesToUART ;
+   uint64_t bytesFromUART ;
+} UART_GATEWAY_CHANNEL ;
+
+/* All channels are serviced from one epoll loop. A timerfd paces ServiceUARTPorts, the PTYs are serviced as they
+ become readable or writable. */
+typedef struct UART_GATEWAY_t {
+   UART_GATEWAY_CHANNEL channels [ UART_GATEWAY_MAX_CHANNELS ] ;
+   MAX3109_UART_PORT ports [ UART_GATEWAY_MAX_CHANNELS ] ; // Contiguous for ServiceUARTPorts
+   MAX3109_UART_PORT_SET portSet ;
+   uint8_t numChannels ;
+   int epollFd ;
+   int timerFd ;
+   void ( * onServiceTick ) ( void * context ) ; // Called before every service pass, e.g. to advance a chip model
+   void * tickContext ;
+   UART_LATENCY_HISTOGRAM rxLatency ; // Each byte's arrival in the RxFIFO to its block being written to the PTY, in microseconds
+   uint64_t activeTime_us ; // Total length of the service periods that moved bytes - divide byte counts by this for throughput
+   uint32_t lastServiceTime ;
+   volatile sig_atomic_t isStopRequested ;
+} UART_GATEWAY ;
+
+/* Creates a PTY for each channel and the epoll loop around them. Channel n is UART_0 (even n) or UART_1 (odd n) of
+ devices[n / 2]. The chips must already be initialized with MAXInitializeMAX3109 and their baud rates set - the
+ character time read back from each channel with referenceClockHz dates the received bytes. Configure auto RTS flow
+ control on them so a client that stops reading its PTY throttles the sender instead of losing bytes. Ports are
+ serviced every servicePeriod_us microseconds. Returns 1 on success, 0 on failure. */
+uint8_t InitializeUARTGateway ( UART_GATEWAY * gateway, MAX3109_DEVICE * * devices, const uint8_t numChannels,
+                                const uint32_t referenceClockHz, const uint32_t servicePeriod_us ) ;
+
+/* Runs the event loop until StopUARTGateway is called. Returns 1 on a requested stop, 0 on an error. */
+uint8_t RunUARTGateway ( UART_GATEWAY * gateway ) ;
+
+/* Safe to call from a signal handler - the loop returns at its next wakeup */
+void StopUARTGateway ( UART_GATEWAY * gateway ) ;
+
+/* Closes the PTYs, the timer and the epoll instance */
+void CloseUARTGateway ( UART_GATEWAY * gateway ) ;
+
+#endif
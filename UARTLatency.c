@@ -0,0 +1,147 @@
+/*
+ File: Consumer side receive latency histograms for the UART block path
+ Author: Henry Gilbert
+ */
+
+#include "UARTLatency.h"
+#include <string.h>
+
+#define SUB_BUCKETS ( 1UL << UART_LATENCY_SUB_BUCKET_BITS )
+
+/* Local Function Prototypes */
+static uint16_t LatencyBucket ( const uint32_t latency ) ;
+static uint32_t LatencyBucketUpperBound ( const uint16_t bucket ) ;
+
+void ResetUARTLatencyHistogram ( UART_LATENCY_HISTOGRAM * histogram )
+{
+   if ( NULL == histogram )
+   {
+      return ;
+   }
+   memset ( histogram, 0, sizeof ( *histogram ) ) ;
+}
+
+void RecordUARTLatency ( UART_LATENCY_HISTOGRAM * histogram, const uint32_t latency )
+{
+   if ( NULL == histogram )
+   {
+      return ;
+   }
+   histogram->counts [ LatencyBucket ( latency ) ]++ ;
+   histogram->numSamples++ ;
+   if ( latency > histogram->maxLatency )
+   {
+      histogram->maxLatency = latency ;
+   }
+}
+
+void RecordUARTRxBlockLatency ( UART_LATENCY_HISTOGRAM * histogram, const UART_RX_BLOCK * block, const uint32_t now )
+{
+   if ( ( NULL == histogram ) ||
+        ( NULL == block ) )
+   {
+      return ;
+   }
+
+   if ( block->numBytes < 2 )
+   {
+      if ( 1 == block->numBytes )
+      {
+         RecordUARTLatency ( histogram, now - block->timestamp ) ;
+      }
+      return ;
+   }
+
+   /* Steps through the same times as UARTRxBlockByteTime with one divide per block - each byte adds the whole ticks
+    of the span per byte, and carries a tick when the remainders add up to a whole byte step */
+   uint16_t numSteps = block->numBytes - 1 ;
+   uint32_t span = block->lastTimestamp - block->timestamp ;
+   uint32_t ticksPerStep = span / numSteps ;
+   uint16_t remainderPerStep = ( uint16_t ) ( span % numSteps ) ;
+   uint16_t remainder = 0 ;
+   uint32_t byteTime = block->timestamp ;
+   uint16_t index ;
+   for ( index = 0 ; index < block->numBytes ; index++ )
+   {
+      RecordUARTLatency ( histogram, now - byteTime ) ;
+      byteTime += ticksPerStep ;
+      remainder += remainderPerStep ;
+      if ( remainder >= numSteps )
+      {
+         remainder -= numSteps ;
+         byteTime++ ;
+      }
+   }
+}
+
+uint32_t GetUARTLatencyPercentile ( const UART_LATENCY_HISTOGRAM * histogram, const uint16_t permille )
+{
+   if ( ( NULL == histogram ) ||
+        ( 0 == histogram->numSamples ) )
+   {
+      return 0 ;
+   }
+
+   /* Rank of the sample at the percentile, rounded up - the 1000th permille is the last sample */
+   uint32_t rank = ( uint32_t ) ( ( ( uint64_t ) histogram->numSamples * permille + 999 ) / 1000 ) ;
+   rank = ( 0 == rank ) ? 1 : rank ;
+
+   uint32_t numCounted = 0 ;
+   uint16_t bucket ;
+   for ( bucket = 0 ; bucket < UART_LATENCY_NUM_BUCKETS ; bucket++ )
+   {
+      numCounted += histogram->counts [ bucket ] ;
+      if ( numCounted >= rank )
+      {
+         uint32_t upperBound = LatencyBucketUpperBound ( bucket ) ;
+         return ( upperBound < histogram->maxLatency ) ? upperBound : histogram->maxLatency ;
+      }
+   }
+   return histogram->maxLatency ;
+}
+
+void GetUARTLatencySummary ( const UART_LATENCY_HISTOGRAM * histogram, UART_LATENCY_SUMMARY * summary )
+{
+   if ( ( NULL == histogram ) ||
+        ( NULL == summary ) )
+   {
+      return ;
+   }
+   summary->p50 = GetUARTLatencyPercentile ( histogram, 500 ) ;
+   summary->p99 = GetUARTLatencyPercentile ( histogram, 990 ) ;
+   summary->max = histogram->maxLatency ;
+   summary->numSamples = histogram->numSamples ;
+}
+
+/* Values below SUB_BUCKETS have a bucket each. Above that, the bucket is picked by the highest set bit and the
+ UART_LATENCY_SUB_BUCKET_BITS bits below it. */
+static uint16_t LatencyBucket ( const uint32_t latency )
+{
+   if ( latency < SUB_BUCKETS )
+   {
+      return ( uint16_t ) latency ;
+   }
+
+   uint8_t highestBit = 0 ;
+   uint32_t remaining = latency ;
+   while ( remaining > 1 )
+   {
+      remaining >>= 1 ;
+      highestBit++ ;
+   }
+   uint8_t shift = highestBit - UART_LATENCY_SUB_BUCKET_BITS ;
+   uint16_t subBucket = ( uint16_t ) ( ( latency >> shift ) & ( SUB_BUCKETS - 1 ) ) ;
+   return ( uint16_t ) ( ( ( highestBit - UART_LATENCY_SUB_BUCKET_BITS + 1 ) << UART_LATENCY_SUB_BUCKET_BITS ) + subBucket ) ;
+}
+
+static uint32_t LatencyBucketUpperBound ( const uint16_t bucket )
+{
+   if ( bucket < SUB_BUCKETS )
+   {
+      return bucket ;
+   }
+
+   uint8_t shift = ( uint8_t ) ( ( bucket >> UART_LATENCY_SUB_BUCKET_BITS ) - 1 ) ;
+   uint32_t lowerBound = ( SUB_BUCKETS + ( bucket & ( SUB_BUCKETS - 1 ) ) ) << shift ;
+   return lowerBound + ( ( 1UL << shift ) - 1 ) ;
+}
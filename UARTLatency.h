@@ -0,0 +1,36 @@
+#ifndef UART_LATENCY_H
+#define UART_LATENCY_H
+
+#include "UARTRxBlocks.h"
+
+/* Log2 buckets split into 4 linear sub buckets, so a percentile is reported within 25% of the true value over the full
+ 32 bit range of the clock. */
+#define UART_LATENCY_SUB_BUCKET_BITS 2
+#define UART_LATENCY_NUM_BUCKETS ( 32 << UART_LATENCY_SUB_BUCKET_BITS )
+
+/* Receive latency in clock ticks - from the estimated arrival of a byte on the line until the consumer reads it */
+typedef struct UART_LATENCY_HISTOGRAM_t {
+   uint32_t counts [ UART_LATENCY_NUM_BUCKETS ] ;
+   uint32_t numSamples ;
+   uint32_t maxLatency ;
+} UART_LATENCY_HISTOGRAM ;
+
+typedef struct UART_LATENCY_SUMMARY_t {
+   uint32_t p50 ;
+   uint32_t p99 ;
+   uint32_t max ;
+   uint32_t numSamples ;
+} UART_LATENCY_SUMMARY ;
+
+void ResetUARTLatencyHistogram ( UART_LATENCY_HISTOGRAM * histogram ) ;
+void RecordUARTLatency ( UART_LATENCY_HISTOGRAM * histogram, const uint32_t latency ) ;
+
+/* Records one sample per byte of a block taken from GetUARTRxBlock, using the interpolated byte timestamps. Call with
+ the clock value at which the consumer processes the block. */
+void RecordUARTRxBlockLatency ( UART_LATENCY_HISTOGRAM * histogram, const UART_RX_BLOCK * block, const uint32_t now ) ;
+
+/* Returns the latency that permille thousandths of the samples are at or below, rounded up to its bucket bound */
+uint32_t GetUARTLatencyPercentile ( const UART_LATENCY_HISTOGRAM * histogram, const uint16_t permille ) ;
+void GetUARTLatencySummary ( const UART_LATENCY_HISTOGRAM * histogram, UART_LATENCY_SUMMARY * summary ) ;
+
+#endif
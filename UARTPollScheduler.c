@@ -0,0 +1,162 @@
+/*
+ File: Adaptive receive polling for MAX3109 UART ports that have no interrupt line wired up
+ Author: Henry Gilbert
+
+ Each poll drains the RxFIFO, so the fill level found is the number of bytes that arrived since the last poll. On an
+ active line that gives the arrival rate, and the next poll is placed when the FIFO is predicted to reach the target
+ fill level. On an idle line the interval backs off exponentially. Every interval is capped by the time the FIFO takes
+ to fill to UART_POLL_SAFE_FILL_LEVEL at full line rate, so a burst starting right after a poll cannot overflow it.
+ */
+
+#include "UARTPollScheduler.h"
+#include <stdbool.h>
+
+#define MAXIMUM_MEASURED_INTERVAL_US 30000000UL // Keeps interval * fill level within 32 bits
+
+/* Local Function Prototypes */
+static uint32_t CharactersToMicroseconds ( const UART_POLL_SCHEDULE * schedule, const uint32_t numCharacters ) ;
+static uint32_t ClampInterval ( const UART_POLL_SCHEDULE * schedule, const uint32_t interval_us ) ;
+static inline bool IsPollDue ( const UART_POLL_SCHEDULE * schedule, const uint32_t now_us ) ;
+
+uint8_t InitializeUARTPollSchedule ( UART_POLL_SCHEDULE * schedule, MAX3109_UART_PORT * port, const uint32_t referenceClockHz,
+                                     const uint8_t targetFillLevel, const uint32_t now_us )
+{
+   if ( ( NULL == schedule ) ||
+        ( NULL == port ) ||
+        ( false == port->isInitialized ) ||
+        ( 0 == targetFillLevel ) ||
+        ( targetFillLevel > UART_POLL_SAFE_FILL_LEVEL ) )
+   {
+      return 0 ; // Error, invalid params
+   }
+
+   MAXSelectDevice ( port->device ) ;
+   uint32_t baudRate = MAXGetUARTBaudRate ( port->channel, referenceClockHz ) ;
+   uint8_t bitsPerCharacter = MAXGetUARTBitsPerCharacter ( port->channel ) ;
+   if ( ( 0 == baudRate ) ||
+        ( 0 == bitsPerCharacter ) )
+   {
+      return 0 ;
+   }
+
+   schedule->port = port ;
+   schedule->charactersPerSecond = ( baudRate + bitsPerCharacter - 1 ) / bitsPerCharacter ; // Round up - errs towards polling early
+   schedule->minimumInterval_us = CharactersToMicroseconds ( schedule, UART_POLL_MINIMUM_INTERVAL_CHARACTERS ) ;
+   schedule->maximumInterval_us = CharactersToMicroseconds ( schedule, UART_POLL_SAFE_FILL_LEVEL ) ;
+   schedule->idleInterval_us = schedule->minimumInterval_us ;
+   schedule->targetFillLevel = targetFillLevel ;
+   schedule->lastFillLevel = 0 ;
+   schedule->lastPollTime_us = now_us ;
+   schedule->nextPollTime_us = now_us ;
+   return 1 ;
+}
+
+uint16_t ServiceUARTPollSchedules ( UART_POLL_SCHEDULE * schedules, const uint8_t numSchedules, const uint32_t now_us )
+{
+   if ( NULL == schedules )
+   {
+      return 0 ;
+   }
+
+   uint16_t numBytesRead = 0 ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numSchedules ; counter++ )
+   {
+      UART_POLL_SCHEDULE * schedule = &schedules [ counter ] ;
+      if ( ( NULL == schedule->port ) ||
+           ( false == IsPollDue ( schedule, now_us ) ) )
+      {
+         continue ;
+      }
+
+      MAXSelectDevice ( schedule->port->device ) ;
+      uint16_t fillLevel = ReadDataFromUARTPort ( schedule->port ) ;
+      uint32_t elapsed_us = now_us - schedule->lastPollTime_us ;
+      uint32_t interval_us ;
+
+      if ( ( 0 == fillLevel ) &&
+           ( IsUARTRxBlockRingThrottled ( schedule->port->rxBlocks ) ) )
+      {
+         /* Not idle - the consumer is behind and the bytes wait in the RxFIFO. A throttled drain costs no SPI, so check
+          back soon to resume as soon as blocks are released. */
+         interval_us = schedule->minimumInterval_us ;
+         schedule->idleInterval_us = schedule->minimumInterval_us ;
+      }
+      else if ( 0 == fillLevel )
+      {
+         /* Idle line - back off, but never past the interval a full rate burst needs to reach the safe level */
+         interval_us = schedule->idleInterval_us ;
+         schedule->idleInterval_us = ClampInterval ( schedule, schedule->idleInterval_us * 2 ) ;
+      }
+      else
+      {
+         /* Active line - the FIFO took elapsed_us to reach fillLevel, so it reaches the target in proportion */
+         if ( elapsed_us > MAXIMUM_MEASURED_INTERVAL_US )
+         {
+            elapsed_us = MAXIMUM_MEASURED_INTERVAL_US ;
+         }
+         interval_us = ( elapsed_us * schedule->targetFillLevel ) / fillLevel ;
+         schedule->idleInterval_us = schedule->minimumInterval_us ;
+      }
+
+      schedule->lastFillLevel = ( uint8_t ) fillLevel ;
+      schedule->lastPollTime_us = now_us ;
+      schedule->nextPollTime_us = now_us + ClampInterval ( schedule, interval_us ) ;
+      numBytesRead += fillLevel ;
+   }
+   return numBytesRead ;
+}
+
+uint32_t GetNextUARTPollTime ( const UART_POLL_SCHEDULE * schedules, const uint8_t numSchedules, const uint32_t now_us )
+{
+   if ( NULL == schedules )
+   {
+      return now_us ;
+   }
+
+   bool isScheduled = false ;
+   uint32_t earliestDelay_us = 0 ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numSchedules ; counter++ )
+   {
+      if ( NULL == schedules [ counter ].port )
+      {
+         continue ;
+      }
+      if ( IsPollDue ( &schedules [ counter ], now_us ) )
+      {
+         return now_us ;
+      }
+
+      uint32_t delay_us = schedules [ counter ].nextPollTime_us - now_us ;
+      if ( ( false == isScheduled ) ||
+           ( delay_us < earliestDelay_us ) )
+      {
+         earliestDelay_us = delay_us ;
+         isScheduled = true ;
+      }
+   }
+   return now_us + earliestDelay_us ;
+}
+
+static uint32_t CharactersToMicroseconds ( const UART_POLL_SCHEDULE * schedule, const uint32_t numCharacters )
+{
+   return ( numCharacters * 1000000UL ) / schedule->charactersPerSecond ;
+}
+
+static uint32_t ClampInterval ( const UART_POLL_SCHEDULE * schedule, const uint32_t interval_us )
+{
+   if ( interval_us < schedule->minimumInterval_us )
+   {
+      return schedule->minimumInterval_us ;
+   }
+   return ( interval_us > schedule->maximumInterval_us ) ? schedule->maximumInterval_us : interval_us ;
+}
+
+/* Signed difference keeps the comparison correct across a wrap of the microsecond clock. A port whose rx blocks were
+ released while throttled is due at once. */
+static inline bool IsPollDue ( const UART_POLL_SCHEDULE * schedule, const uint32_t now_us )
+{
+   return ( ( int32_t ) ( now_us - schedule->nextPollTime_us ) >= 0 ) ||
+          ( IsUARTRxBlockServiceRequested ( schedule->port->rxBlocks ) ) ;
+}
@@ -0,0 +1,36 @@
+#ifndef UART_POLL_SCHEDULER_H
+#define UART_POLL_SCHEDULER_H
+
+#include "SPItoUART.h"
+
+#define UART_POLL_SAFE_FILL_LEVEL ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES - 16 ) // Leaves 16 characters of poll latency before overflow
+#define UART_POLL_MINIMUM_INTERVAL_CHARACTERS 4 // First idle poll interval, doubled on every idle poll after it
+
+/* Receive poll timing of one port without interrupts. Times are microseconds from any free running clock and may wrap. */
+typedef struct UART_POLL_SCHEDULE_t {
+   MAX3109_UART_PORT * port ;
+   uint32_t charactersPerSecond ; // From the programmed baud rate and line config
+   uint32_t minimumInterval_us ;
+   uint32_t maximumInterval_us ; // Time for an empty RxFIFO to reach UART_POLL_SAFE_FILL_LEVEL at full line rate
+   uint32_t idleInterval_us ; // Current backoff interval while the line is idle
+   uint32_t lastPollTime_us ;
+   uint32_t nextPollTime_us ;
+   uint8_t targetFillLevel ; // Fill level active lines are drained at
+   uint8_t lastFillLevel ; // Bytes found in the RxFIFO at the last poll
+} UART_POLL_SCHEDULE ;
+
+/* Reads the baud rate and line config of the port's channel (after MAXInitializeMAX3109) and schedules the first poll
+ now. targetFillLevel is in bytes, 1 to UART_POLL_SAFE_FILL_LEVEL - higher means fewer polls per byte, lower means less
+ latency. Call again after changing the baud rate. Returns 1 on success, 0 on failure. */
+uint8_t InitializeUARTPollSchedule ( UART_POLL_SCHEDULE * schedule, MAX3109_UART_PORT * port, const uint32_t referenceClockHz,
+                                     const uint8_t targetFillLevel, const uint32_t now_us ) ;
+
+/* Drains every port whose poll is due and schedules its next poll. A port whose rx blocks are throttled reads no bytes
+ but is not idle - it is polled again after the minimum interval, or at once when a release asks for it. Returns the
+ total number of bytes read. */
+uint16_t ServiceUARTPollSchedules ( UART_POLL_SCHEDULE * schedules, const uint8_t numSchedules, const uint32_t now_us ) ;
+
+/* Returns the earliest scheduled poll time, so the caller can sleep or do other work until then */
+uint32_t GetNextUARTPollTime ( const UART_POLL_SCHEDULE * schedules, const uint8_t numSchedules, const uint32_t now_us ) ;
+
+#endif
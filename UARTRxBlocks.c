@@ -0,0 +1,251 @@
+/*
+ File: Block oriented receive path for MAX3109 UART ports
+ Author: Henry Gilbert
+
+ Each port owns a ring of fixed size blocks. Every block index is on the free queue, on the ready queue, or is the
+ active block being filled, so a queue can never overflow.
+ */
+
+#include "UARTRxBlocks.h"
+#include <stdbool.h>
+
+/* Local Function Prototypes */
+static void HandOverActiveBlock ( UART_RX_BLOCK_RING * ring ) ;
+static void HandOverTimedOutBlock ( UART_RX_BLOCK_RING * ring, const uint32_t now ) ;
+static uint8_t CountHeldBlocks ( UART_RX_BLOCK_RING * ring ) ;
+static bool IsDrainThrottled ( UART_RX_BLOCK_RING * ring ) ;
+
+uint8_t InitializeUARTRxBlockRing ( UART_RX_BLOCK_RING * ring, UART_RX_BLOCK * blocks, const uint8_t numBlocks,
+                                    const uint32_t timeout )
+{
+   if ( ( NULL == ring ) ||
+        ( NULL == blocks ) ||
+        ( numBlocks < 2 ) ||
+        ( numBlocks > UART_RX_MAX_BLOCKS ) ||
+        ( false == rq_init ( &ring->freeBlocks, ring->freeStorage, numBlocks ) ) ||
+        ( false == rq_init ( &ring->readyBlocks, ring->readyStorage, numBlocks ) ) )
+   {
+      return 0 ; // Error, invalid params
+   }
+
+   ring->blocks = blocks ;
+   ring->activeBlock = NULL ;
+   ring->timeout = timeout ;
+   ring->characterTime = 0 ;
+   ring->numBlocks = numBlocks ;
+   ring->highWatermark = 0 ;
+   ring->lowWatermark = 0 ;
+   ring->isThrottled = false ;
+   ring->isServiceRequested = false ;
+   ring->numThrottles = 0 ;
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numBlocks ; counter++ )
+   {
+      rq_push ( &ring->freeBlocks, counter ) ;
+   }
+   return 1 ;
+}
+
+uint16_t DrainUARTRxFIFOToBlocks ( const MAX3109_UART_SELECTION channel, UART_RX_BLOCK_RING * ring, const uint32_t now )
+{
+   if ( NULL == ring )
+   {
+      return 0 ;
+   }
+
+   ring->isServiceRequested = false ;
+   if ( IsDrainThrottled ( ring ) )
+   {
+      HandOverTimedOutBlock ( ring, now ) ;
+      return 0 ; // Leave the bytes in the RxFIFO so flow control holds off the sender
+   }
+
+   uint8_t fifoLevel = MAXGetUARTFIFOLevel ( channel, max3109_RxFIFOLvl ) ;
+   if ( fifoLevel > MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES )
+   {
+      return 0 ; // Error
+   }
+
+   uint16_t numBytesRead = 0 ;
+   while ( fifoLevel > 0 )
+   {
+      if ( NULL == ring->activeBlock )
+      {
+         uint32_t blockIndex ;
+         if ( false == rq_pop ( &ring->freeBlocks, &blockIndex ) )
+         {
+            break ; // Consumer holds every block - leave the rest in the RxFIFO
+         }
+         ring->activeBlock = &ring->blocks [ blockIndex ] ;
+         ring->activeBlock->numBytes = 0 ;
+      }
+
+      UART_RX_BLOCK * block = ring->activeBlock ;
+      uint16_t blockSpace = UART_RX_BLOCK_SIZE - block->numBytes ;
+      uint8_t numBytesToRead = ( fifoLevel < blockSpace ) ? fifoLevel : ( uint8_t ) blockSpace ;
+      if ( 0 == block->numBytes )
+      {
+         block->timestamp = now - ( ( uint32_t ) ( fifoLevel - 1 ) * ring->characterTime ) ;
+      }
+      block->lastTimestamp = now - ( ( uint32_t ) ( fifoLevel - numBytesToRead ) * ring->characterTime ) ;
+
+      uint8_t numBytesPopped = MAXPopBurstFromUARTRxFIFO ( channel, &block->data [ block->numBytes ], numBytesToRead ) ;
+      if ( 0 == numBytesPopped )
+      {
+         break ; // Error
+      }
+      block->numBytes += numBytesPopped ;
+      fifoLevel -= numBytesPopped ;
+      numBytesRead += numBytesPopped ;
+
+      if ( UART_RX_BLOCK_SIZE == block->numBytes )
+      {
+         HandOverActiveBlock ( ring ) ;
+      }
+   }
+
+   HandOverTimedOutBlock ( ring, now ) ;
+   return numBytesRead ;
+}
+
+uint8_t SetUARTRxBlockWatermarks ( UART_RX_BLOCK_RING * ring, const uint8_t highWatermark, const uint8_t lowWatermark )
+{
+   if ( ( NULL == ring ) ||
+        ( highWatermark > ring->numBlocks ) ||
+        ( ( 0 != highWatermark ) && ( lowWatermark >= highWatermark ) ) )
+   {
+      return 0 ; // Error, invalid params
+   }
+
+   ring->highWatermark = highWatermark ;
+   ring->lowWatermark = lowWatermark ;
+   ring->isThrottled = false ;
+   return 1 ;
+}
+
+bool IsUARTRxBlockRingThrottled ( const UART_RX_BLOCK_RING * ring )
+{
+   return ( NULL != ring ) && ( ring->isThrottled ) ;
+}
+
+bool IsUARTRxBlockServiceRequested ( const UART_RX_BLOCK_RING * ring )
+{
+   return ( NULL != ring ) && ( ring->isServiceRequested ) ;
+}
+
+bool IsUARTRxBlockTimeoutDue ( const UART_RX_BLOCK_RING * ring, const uint32_t now )
+{
+   if ( ( NULL == ring ) ||
+        ( 0 == ring->timeout ) )
+   {
+      return false ;
+   }
+
+   const UART_RX_BLOCK * block = ring->activeBlock ;
+   return ( NULL != block ) &&
+          ( block->numBytes > 0 ) &&
+          ( ( now - block->timestamp ) >= ring->timeout ) ;
+}
+
+void SetUARTRxBlockCharacterTime ( UART_RX_BLOCK_RING * ring, const uint32_t characterTime )
+{
+   if ( NULL == ring )
+   {
+      return ;
+   }
+   ring->characterTime = characterTime ;
+}
+
+uint32_t UARTRxBlockByteTime ( const UART_RX_BLOCK * block, const uint16_t index )
+{
+   if ( ( NULL == block ) ||
+        ( block->numBytes < 2 ) )
+   {
+      return ( NULL == block ) ? 0 : block->timestamp ;
+   }
+
+   uint16_t lastIndex = ( index < block->numBytes ) ? index : ( block->numBytes - 1 ) ;
+   uint32_t span = block->lastTimestamp - block->timestamp ;
+   return block->timestamp + ( uint32_t ) ( ( ( uint64_t ) span * lastIndex ) / ( block->numBytes - 1 ) ) ;
+}
+
+UART_RX_BLOCK * GetUARTRxBlock ( UART_RX_BLOCK_RING * ring )
+{
+   uint32_t blockIndex ;
+   if ( ( NULL == ring ) ||
+        ( false == rq_pop ( &ring->readyBlocks, &blockIndex ) ) )
+   {
+      return NULL ;
+   }
+   return &ring->blocks [ blockIndex ] ;
+}
+
+void ReleaseUARTRxBlock ( UART_RX_BLOCK_RING * ring, UART_RX_BLOCK * block )
+{
+   if ( ( NULL == ring ) ||
+        ( NULL == block ) )
+   {
+      return ;
+   }
+   rq_push ( &ring->freeBlocks, ( uint32_t ) ( block - ring->blocks ) ) ;
+
+   /* Every release while throttled asks for a drain rather than only the one reaching the low watermark - the consumer
+    cannot see the active block consistently, and a missed request would leave the port throttled for good */
+   if ( ring->isThrottled )
+   {
+      ring->isServiceRequested = true ;
+   }
+}
+
+static void HandOverActiveBlock ( UART_RX_BLOCK_RING * ring )
+{
+   rq_push ( &ring->readyBlocks, ( uint32_t ) ( ring->activeBlock - ring->blocks ) ) ;
+   ring->activeBlock = NULL ;
+}
+
+static void HandOverTimedOutBlock ( UART_RX_BLOCK_RING * ring, const uint32_t now )
+{
+   if ( IsUARTRxBlockTimeoutDue ( ring, now ) )
+   {
+      HandOverActiveBlock ( ring ) ;
+   }
+}
+
+/* Blocks held by the consumer are those neither free nor being filled */
+static uint8_t CountHeldBlocks ( UART_RX_BLOCK_RING * ring )
+{
+   return ring->numBlocks - ( uint8_t ) rq_numMsgsInQueue ( &ring->freeBlocks ) -
+          ( ( NULL == ring->activeBlock ) ? 0 : 1 ) ;
+}
+
+/* Hysteresis between the watermarks keeps RTS from toggling on every block */
+static bool IsDrainThrottled ( UART_RX_BLOCK_RING * ring )
+{
+   if ( 0 == ring->highWatermark )
+   {
+      return false ;
+   }
+
+   uint8_t numHeldBlocks = CountHeldBlocks ( ring ) ;
+   if ( ( false == ring->isThrottled ) &&
+        ( numHeldBlocks >= ring->highWatermark ) )
+   {
+      ring->isThrottled = true ;
+      ring->numThrottles++ ;
+
+      /* A release between the count and setting isThrottled saw the ring unthrottled and asked for no drain. Count
+       again now that releases see the throttle - if the consumer is already down to the low watermark nothing else
+       would end it. */
+      if ( CountHeldBlocks ( ring ) <= ring->lowWatermark )
+      {
+         ring->isThrottled = false ;
+      }
+   }
+   else if ( ( ring->isThrottled ) &&
+             ( numHeldBlocks <= ring->lowWatermark ) )
+   {
+      ring->isThrottled = false ;
+   }
+   return ring->isThrottled ;
+}
\ No newline at end of file
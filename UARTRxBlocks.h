@@ -0,0 +1,76 @@
+#ifndef UART_RX_BLOCKS_H
+#define UART_RX_BLOCKS_H
+
+#include "MAX3109.h"
+#include "ringQueue.h"
+
+#define UART_RX_BLOCK_SIZE 256
+#define UART_RX_MAX_BLOCKS 8 // Blocks per ring, a power of two from 2
+
+/* A fixed size block of received bytes. The RxFIFO is burst read straight into data. */
+typedef struct UART_RX_BLOCK_t {
+   uint8_t data [ UART_RX_BLOCK_SIZE ] ;
+   uint16_t numBytes ;
+   uint32_t timestamp ; // Estimated arrival of the first byte on the line - see UARTRxBlockByteTime
+   uint32_t lastTimestamp ; // Estimated arrival of the last byte
+} UART_RX_BLOCK ;
+
+/* The blocks of one port. The drain fills the active block and hands it to the consumer when it is full or times out.
+ Blocks move between the drain and the consumer as indices on two SPSC queues, so they are never copied and the drain
+ and the consumer can run in different contexts. */
+typedef struct UART_RX_BLOCK_RING_t {
+   UART_RX_BLOCK * blocks ;
+   UART_RX_BLOCK * activeBlock ; // Being filled, NULL until a free block is available
+   RingQueue freeBlocks ; // Empty blocks, consumer to drain
+   RingQueue readyBlocks ; // Filled blocks, drain to consumer
+   uint32_t freeStorage [ UART_RX_MAX_BLOCKS ] ;
+   uint32_t readyStorage [ UART_RX_MAX_BLOCKS ] ;
+   uint32_t timeout ; // Clock ticks after its first byte that a partly filled block is handed over, 0 waits until full
+   uint32_t characterTime ; // Clock ticks per character on the line, 0 timestamps every byte with the drain time
+   uint8_t numBlocks ;
+   uint8_t highWatermark ; // Blocks held by the consumer at which draining stops, 0 disables the watermarks
+   uint8_t lowWatermark ; // Blocks held by the consumer at which draining resumes
+   volatile bool isThrottled ; // Draining stopped at the high watermark, read by ReleaseUARTRxBlock
+   volatile bool isServiceRequested ; // A block was released while throttled - the drain must run again to resume
+   uint32_t numThrottles ; // Times draining stopped at the high watermark
+} UART_RX_BLOCK_RING ;
+
+/* numBlocks must be a power of two from 2 to UART_RX_MAX_BLOCKS. Returns 1 on success, 0 on failure. */
+uint8_t InitializeUARTRxBlockRing ( UART_RX_BLOCK_RING * ring, UART_RX_BLOCK * blocks, const uint8_t numBlocks,
+                                    const uint32_t timeout ) ;
+
+/* Burst reads the RxFIFO straight into the active block, moving on to the next free block as blocks fill, and hands over
+ a partly filled block whose timeout has passed. Bytes stay in the RxFIFO while no block is free. The chip must be
+ selected. Returns the number of bytes read. */
+uint16_t DrainUARTRxFIFOToBlocks ( const MAX3109_UART_SELECTION channel, UART_RX_BLOCK_RING * ring, const uint32_t now ) ;
+
+/* Lets the drain date each byte back from the drain time by its position in the RxFIFO. A byte with n bytes behind it
+ in the FIFO arrived about n character times before the drain - exact while the line is busy, early for idle gaps. */
+void SetUARTRxBlockCharacterTime ( UART_RX_BLOCK_RING * ring, const uint32_t characterTime ) ;
+
+/* Estimated arrival of byte index of a block, interpolated between its first and last byte timestamps */
+uint32_t UARTRxBlockByteTime ( const UART_RX_BLOCK * block, const uint16_t index ) ;
+
+/* Backpressure for hardware flow control (MAXConfigureFlowControl with auto RTS). Once the consumer holds highWatermark
+ filled blocks the drain leaves the RxFIFO alone, so it fills up to the FlowLvl halt level and the chip deasserts RTS.
+ Draining resumes when the consumer is down to lowWatermark blocks. Returns 1 on success, 0 on failure. */
+uint8_t SetUARTRxBlockWatermarks ( UART_RX_BLOCK_RING * ring, const uint8_t highWatermark, const uint8_t lowWatermark ) ;
+
+/* True while the drain is leaving the RxFIFO alone. A throttled drain reads 0 bytes from a line that is not idle. */
+bool IsUARTRxBlockRingThrottled ( const UART_RX_BLOCK_RING * ring ) ;
+
+/* True after a release while throttled, until the drain next runs. With auto RTS holding the sender no new receive
+ interrupt arrives, so whoever releases blocks must see that the drain runs again - ServiceUARTPortInterrupts and the
+ poll scheduler check this. */
+bool IsUARTRxBlockServiceRequested ( const UART_RX_BLOCK_RING * ring ) ;
+
+/* True once the partly filled active block has passed its timeout, until the drain hands it over. A quiet line raises
+ no receive interrupt to run the drain, so ServiceUARTPortInterrupts and IsUARTPortServiceRequested check this. Safe to
+ call from the consumer context - a stale answer only costs or puts off one drain. */
+bool IsUARTRxBlockTimeoutDue ( const UART_RX_BLOCK_RING * ring, const uint32_t now ) ;
+
+/* Consumer side: returns the oldest filled block, or NULL if none is ready. Hand it back with ReleaseUARTRxBlock. */
+UART_RX_BLOCK * GetUARTRxBlock ( UART_RX_BLOCK_RING * ring ) ;
+void ReleaseUARTRxBlock ( UART_RX_BLOCK_RING * ring, UART_RX_BLOCK * block ) ;
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ File: Serial gateway daemon - MAX3109 UART channels as pseudo-terminals on a Linux host
+ Author: Henry Gilbert
+
+ Runs the gateway on the host MAX3109 model with every channel's TX line looped back to its own RX line, so whatever
+ a client writes to a channel's PTY comes back out of the same PTY at the configured line rate. Auto RTS is on, so a
+ client that stops reading holds the loopback back instead of losing bytes.
+
+ Build: make -C tests tools, which writes tests/build/hostGateway
+ Usage: hostGateway [-c channels] [-b baud] [-p service period us]
+ Ctrl-C prints the per channel byte counts and the receive latency summary and exits.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "UARTGateway.h"
+#include "hostSPI.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define DEFAULT_NUM_CHANNELS 4
+#define DEFAULT_BAUD_RATE 115200UL
+#define DEFAULT_SERVICE_PERIOD_US 1000UL
+#define CRYSTAL_HZ 3686400UL
+#define LINE_CONFIG_8N1 0x03
+#define FLOW_HALT_LEVEL_BYTES 96
+#define FLOW_RESUME_LEVEL_BYTES 32
+#define BITS_PER_CHARACTER 10 // 8N1 on the line
+
+typedef struct LOOPBACK_MODEL_t {
+   HOST_MAX3109_MODEL chips [ HOST_SPI_MAX_DEVICES ] ;
+   uint8_t numChannels ;
+   uint8_t bytesPerTick ; // Line rate times the service period
+} LOOPBACK_MODEL ;
+
+static UART_GATEWAY gateway ;
+static LOOPBACK_MODEL loopbackModel ;
+static MAX3109_DEVICE devices [ HOST_SPI_MAX_DEVICES ] ;
+
+/* Local Function Prototypes */
+static void AdvanceLoopbackModel ( void * context ) ;
+static uint8_t InitializeLoopbackChips ( const uint8_t numChips, const uint32_t baudRate ) ;
+static void OnStopSignal ( int signalNumber ) ;
+static void PrintGatewaySummary ( const double elapsedSeconds ) ;
+
+int main ( int argc, char * * argv )
+{
+   unsigned long numChannels = DEFAULT_NUM_CHANNELS ;
+   unsigned long baudRate = DEFAULT_BAUD_RATE ;
+   unsigned long servicePeriod_us = DEFAULT_SERVICE_PERIOD_US ;
+
+   int option ;
+   while ( -1 != ( option = getopt ( argc, argv, "c:b:p:" ) ) )
+   {
+      switch ( option )
+      {
+         case 'c': numChannels = strtoul ( optarg, NULL, 0 ) ; break ;
+         case 'b': baudRate = strtoul ( optarg, NULL, 0 ) ; break ;
+         case 'p': servicePeriod_us = strtoul ( optarg, NULL, 0 ) ; break ;
+         default:
+            fprintf ( stderr, "Usage: %s [-c channels] [-b baud] [-p service period us]\n", argv [ 0 ] ) ;
+            return EXIT_FAILURE ;
+      }
+   }
+
+   unsigned long maximumChannels = 2UL * HOST_SPI_MAX_DEVICES ;
+   if ( maximumChannels > UART_GATEWAY_MAX_CHANNELS )
+   {
+      maximumChannels = UART_GATEWAY_MAX_CHANNELS ;
+   }
+   if ( ( 0 == numChannels ) ||
+        ( numChannels > maximumChannels ) ||
+        ( 0 == baudRate ) ||
+        ( 0 == servicePeriod_us ) ||
+        ( servicePeriod_us > 1000000UL ) )
+   {
+      fprintf ( stderr, "Channels must be 1 to %lu, baud and service period (up to 1 s) non-zero\n", maximumChannels ) ;
+      return EXIT_FAILURE ;
+   }
+
+   /* The RxFIFO must not pass the halt level within one service period, or auto RTS cannot hold the line back */
+   unsigned long bytesPerTick = ( ( baudRate / BITS_PER_CHARACTER ) * servicePeriod_us ) / 1000000UL ;
+   if ( bytesPerTick > ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES - FLOW_HALT_LEVEL_BYTES ) )
+   {
+      fprintf ( stderr, "%lu baud fills %lu bytes per service period - shorten the period\n", baudRate, bytesPerTick ) ;
+      return EXIT_FAILURE ;
+   }
+   loopbackModel.numChannels = ( uint8_t ) numChannels ;
+   loopbackModel.bytesPerTick = ( 0 == bytesPerTick ) ? 1 : ( uint8_t ) bytesPerTick ;
+
+   uint8_t numChips = ( uint8_t ) ( ( numChannels + 1 ) / 2 ) ;
+   if ( 0 == InitializeLoopbackChips ( numChips, ( uint32_t ) baudRate ) )
+   {
+      fprintf ( stderr, "MAX3109 model setup failed\n" ) ;
+      return EXIT_FAILURE ;
+   }
+
+   MAX3109_DEVICE * channelDevices [ HOST_SPI_MAX_DEVICES ] ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numChips ; counter++ )
+   {
+      channelDevices [ counter ] = &devices [ counter ] ;
+   }
+   if ( 0 == InitializeUARTGateway ( &gateway, channelDevices, ( uint8_t ) numChannels, CRYSTAL_HZ,
+                                     ( uint32_t ) servicePeriod_us ) )
+   {
+      perror ( "Gateway setup failed" ) ;
+      return EXIT_FAILURE ;
+   }
+   gateway.onServiceTick = AdvanceLoopbackModel ;
+   gateway.tickContext = &loopbackModel ;
+
+   for ( counter = 0 ; counter < numChannels ; counter++ )
+   {
+      printf ( "channel %u (chip %u UART_%u): %s\n", counter, counter / 2, counter & 0x01,
+               gateway.channels [ counter ].ptyName ) ;
+   }
+   fflush ( stdout ) ;
+
+   struct sigaction stopAction ;
+   memset ( &stopAction, 0, sizeof ( stopAction ) ) ;
+   stopAction.sa_handler = OnStopSignal ;
+   sigaction ( SIGINT, &stopAction, NULL ) ;
+   sigaction ( SIGTERM, &stopAction, NULL ) ;
+
+   struct timespec startTime ;
+   struct timespec stopTime ;
+   clock_gettime ( CLOCK_MONOTONIC, &startTime ) ;
+   uint8_t isStopped = RunUARTGateway ( &gateway ) ;
+   clock_gettime ( CLOCK_MONOTONIC, &stopTime ) ;
+
+   PrintGatewaySummary ( ( double ) ( stopTime.tv_sec - startTime.tv_sec ) +
+                         ( ( double ) ( stopTime.tv_nsec - startTime.tv_nsec ) / 1e9 ) ) ;
+   CloseUARTGateway ( &gateway ) ;
+   return ( isStopped ) ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
+
+/* Moves one service period worth of line time from every TxFIFO to its own RxFIFO */
+static void AdvanceLoopbackModel ( void * context )
+{
+   LOOPBACK_MODEL * model = ( LOOPBACK_MODEL * ) context ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < model->numChannels ; counter++ )
+   {
+      HostMAX3109Loopback ( &model->chips [ counter / 2 ], ( counter & 0x01 ) ? UART_1 : UART_0,
+                            model->bytesPerTick ) ;
+   }
+}
+
+/* One model per chip select line, each set up like a board chip: 8N1 at the requested rate with auto RTS */
+static uint8_t InitializeLoopbackChips ( const uint8_t numChips, const uint32_t baudRate )
+{
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   if ( 0 == MAXSolveBaudRate ( CRYSTAL_HZ, false, baudRate, &baudSettings ) )
+   {
+      return 0 ;
+   }
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numChips ; counter++ )
+   {
+      HostMAX3109ModelReset ( &loopbackModel.chips [ counter ] ) ;
+      if ( 0 != HostSPIAttachModel ( counter, &loopbackModel.chips [ counter ] ) )
+      {
+         return 0 ;
+      }
+
+      devices [ counter ].transport = &hostSPITransport ;
+      devices [ counter ].chipSelectLine = counter ;
+      MAXSelectDevice ( &devices [ counter ] ) ;
+      if ( ( 0 == MAXInitializeMAX3109 ( baudSettings.pllConfig, baudSettings.clockSource, LINE_CONFIG_8N1 ) ) ||
+           ( 0 == MAXConfigureBaudRate ( UART_0, &baudSettings ) ) ||
+           ( 0 == MAXConfigureBaudRate ( UART_1, &baudSettings ) ) ||
+           ( 0 == MAXConfigureFlowControl ( UART_0, FLOW_HALT_LEVEL_BYTES, FLOW_RESUME_LEVEL_BYTES, true, false ) ) ||
+           ( 0 == MAXConfigureFlowControl ( UART_1, FLOW_HALT_LEVEL_BYTES, FLOW_RESUME_LEVEL_BYTES, true, false ) ) )
+      {
+         return 0 ;
+      }
+   }
+   return 1 ;
+}
+
+static void OnStopSignal ( int signalNumber )
+{
+   ( void ) signalNumber ;
+   StopUARTGateway ( &gateway ) ;
+}
+
+static void PrintGatewaySummary ( const double elapsedSeconds )
+{
+   uint64_t totalBytes = 0 ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < gateway.numChannels ; counter++ )
+   {
+      UART_GATEWAY_CHANNEL * channel = &gateway.channels [ counter ] ;
+      printf ( "channel %u: %llu bytes to UART, %llu bytes from UART, %lu rx overruns, %lu throttles\n", counter,
+               ( unsigned long long ) channel->bytesToUART, ( unsigned long long ) channel->bytesFromUART,
+               ( unsigned long ) loopbackModel.chips [ counter / 2 ].channels [ counter & 0x01 ].rxOverruns,
+               ( unsigned long ) channel->rxBlocks.numThrottles ) ;
+      totalBytes += channel->bytesFromUART ;
+   }
+
+   /* Idle time would only dilute the rate, so it is taken over the service periods that moved bytes */
+   UART_LATENCY_SUMMARY latency ;
+   GetUARTLatencySummary ( &gateway.rxLatency, &latency ) ;
+   double activeSeconds = ( double ) gateway.activeTime_us / 1e6 ;
+   printf ( "%.1f s, %.1f s active, %.0f bytes/s received over all channels while active\n", elapsedSeconds,
+            activeSeconds, ( activeSeconds > 0.0 ) ? ( ( double ) totalBytes / activeSeconds ) : 0.0 ) ;
+   printf ( "rx latency us: p50 %lu, p99 %lu, max %lu over %lu bytes\n", ( unsigned long ) latency.p50,
+            ( unsigned long ) latency.p99, ( unsigned long ) latency.max, ( unsigned long ) latency.numSamples ) ;
+}
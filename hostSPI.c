@@ -0,0 +1,483 @@
+/* File: hostSPI
+ * Author: Henry Gilbert
+ * Description : Linux host SPI transport and MAX3109 software model. Commands are decoded exactly like the chip
+ *      decodes them: the first byte of a chip select frame is the command byte, every following byte is data. Data
+ *      bytes to the THR/RHR are FIFO bursts, data bytes to any other register go to the following addresses, as the
+ *      register address auto increments within a frame.
+ *      Interrupt bits are latched on FIFO edges and cleared when ISR_Status is read.
+ */
+
+#include "hostSPI.h"
+#include "SPIAsync.h"
+#include <stddef.h>
+#include <string.h>
+
+#define REGISTER_INDEX(reg) ((uint8_t) ((reg) >> 8))
+#define COMMAND_WRITE_BIT 0x80
+#define COMMAND_CHANNEL_BIT 0x20
+#define COMMAND_ADDRESS_MASK 0x1F
+
+#define ISR_LSR_ERROR 0x01
+#define ISR_RX_TRIGGER 0x08
+#define ISR_TX_EMPTY 0x20
+#define ISR_RX_EMPTY 0x40
+#define LSR_RX_TIMEOUT 0x01
+#define MODE2_RESET 0x01
+#define MODE2_FIFO_RESET 0x02
+#define MODE2_RX_EMPTY_INVERT 0x08
+#define FLOWCTRL_AUTO_RTS 0x01
+#define FLOWLVL_HALT_MASK 0x0F
+#define FLOW_LEVEL_STEP 8
+
+static HOST_MAX3109_MODEL * attachedModels[HOST_SPI_MAX_DEVICES];
+static HOST_MAX3109_MODEL * selectedModel = NULL;
+static bool isCommandPending = false;
+static uint8_t commandByte;
+static uint8_t frameDataByteIndex; // Data bytes clocked since the command byte of the current frame
+static HOST_SPI_STATS hostStats;
+static bool isInterruptEnabled = false;
+static bool isWordPending = false;
+static uint16_t pendingWord;
+
+/* Local Function Prototypes */
+static uint16_t hostSPItransferWord( const uint16_t writeData );
+static void hostSPItransferBuffer( const uint16_t * writeData,
+                                   uint16_t * readData,
+                                   const uint16_t numWords );
+static void hostSPIchipSelect( const uint16_t chipSelectLine,
+                               const bool isSelected );
+static void hostSPIstartWord( const uint16_t writeData );
+static void hostSPIenableCompletionInterrupt( const bool isEnabled );
+static uint8_t modelTransferByte( const uint8_t command,
+                                  const uint8_t dataByte );
+static uint8_t modelReadRegister( HOST_MAX3109_MODEL * model,
+                                  const uint8_t channelIndex,
+                                  const uint8_t address );
+static void modelWriteRegister( HOST_MAX3109_MODEL * model,
+                                const uint8_t channelIndex,
+                                const uint8_t address,
+                                const uint8_t value );
+static void modelResetChannel( HOST_MAX3109_CHANNEL_MODEL * channelModel );
+static uint8_t modelRxHaltLevel( const HOST_MAX3109_CHANNEL_MODEL * channelModel );
+static void modelLatchFIFOEdges( HOST_MAX3109_CHANNEL_MODEL * channelModel,
+                                 const uint8_t oldRxCount,
+                                 const uint8_t oldTxCount );
+static inline bool fifoPush( HOST_MAX3109_FIFO * fifo,
+                             const uint8_t value );
+static inline bool fifoPop( HOST_MAX3109_FIFO * fifo,
+                            uint8_t * value );
+
+const SPI_TRANSPORT hostSPITransport = {
+    hostSPItransferWord,
+    hostSPItransferBuffer,
+    hostSPIchipSelect,
+    hostSPIstartWord,
+    hostSPIenableCompletionInterrupt
+};
+
+void HostMAX3109ModelReset( HOST_MAX3109_MODEL * model )
+{
+    if (NULL == model)
+    {
+        return;
+    }
+    uint8_t channelIndex;
+    for (channelIndex = 0; channelIndex < HOST_MAX3109_NUM_CHANNELS; channelIndex++)
+    {
+        modelResetChannel( &model->channels[channelIndex] );
+    }
+}
+
+uint8_t HostSPIAttachModel( const uint16_t chipSelectLine,
+                            HOST_MAX3109_MODEL * model )
+{
+    if (chipSelectLine >= HOST_SPI_MAX_DEVICES)
+    {
+        return 1; // Error, invalid params
+    }
+    attachedModels[chipSelectLine] = model;
+    return 0;
+}
+
+uint8_t HostMAX3109InjectRx( HOST_MAX3109_MODEL * model,
+                             const MAX3109_UART_SELECTION channel,
+                             const uint8_t * src,
+                             const uint8_t numBytes )
+{
+    if ((NULL == model) || (NULL == src))
+    {
+        return 0;
+    }
+
+    HOST_MAX3109_CHANNEL_MODEL * channelModel = &model->channels[(UART_1 == channel) ? 1 : 0];
+    uint8_t oldRxCount = channelModel->rxFIFO.count;
+    uint8_t numAccepted = 0;
+    uint8_t byteIndex;
+    uint8_t haltLevel = modelRxHaltLevel( channelModel );
+    for (byteIndex = 0; byteIndex < numBytes; byteIndex++)
+    {
+        if (channelModel->rxFIFO.count >= haltLevel)
+        {
+            break;
+        }
+        if (fifoPush( &channelModel->rxFIFO, src[byteIndex] ))
+        {
+            numAccepted++;
+        }
+        else
+        {
+            channelModel->rxOverruns++;
+        }
+    }
+
+    /* Each injection is treated as a burst followed by an idle line, which raises the receive timeout */
+    if (numAccepted > 0)
+    {
+        channelModel->registers[REGISTER_INDEX( max3109_LSR )] |= LSR_RX_TIMEOUT;
+        if (channelModel->registers[REGISTER_INDEX( max3109_LSRIntEn )] & LSR_RX_TIMEOUT)
+        {
+            channelModel->latchedISR |= ISR_LSR_ERROR;
+        }
+    }
+    modelLatchFIFOEdges( channelModel, oldRxCount, channelModel->txFIFO.count );
+    return numAccepted;
+}
+
+uint8_t HostMAX3109DrainTx( HOST_MAX3109_MODEL * model,
+                            const MAX3109_UART_SELECTION channel,
+                            uint8_t * dst,
+                            const uint8_t maxBytes )
+{
+    if ((NULL == model) || (NULL == dst))
+    {
+        return 0;
+    }
+
+    HOST_MAX3109_CHANNEL_MODEL * channelModel = &model->channels[(UART_1 == channel) ? 1 : 0];
+    uint8_t oldTxCount = channelModel->txFIFO.count;
+    uint8_t numDrained = 0;
+    while ((numDrained < maxBytes) && fifoPop( &channelModel->txFIFO, &dst[numDrained] ))
+    {
+        numDrained++;
+    }
+    modelLatchFIFOEdges( channelModel, channelModel->rxFIFO.count, oldTxCount );
+    return numDrained;
+}
+
+uint8_t HostMAX3109Loopback( HOST_MAX3109_MODEL * model,
+                             const MAX3109_UART_SELECTION channel,
+                             const uint8_t maxBytes )
+{
+    if (NULL == model)
+    {
+        return 0;
+    }
+
+    /* Only take what the RxFIFO will accept, so flow control holds bytes back in the TxFIFO rather than losing them */
+    HOST_MAX3109_CHANNEL_MODEL * channelModel = &model->channels[(UART_1 == channel) ? 1 : 0];
+    uint8_t haltLevel = modelRxHaltLevel( channelModel );
+    uint8_t rxSpace = (channelModel->rxFIFO.count < haltLevel) ? (haltLevel - channelModel->rxFIFO.count) : 0;
+    uint8_t wireBytes[MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES];
+    uint8_t numBytes = HostMAX3109DrainTx( model, channel, wireBytes, (maxBytes < rxSpace) ? maxBytes : rxSpace );
+    return HostMAX3109InjectRx( model, channel, wireBytes, numBytes );
+}
+
+bool HostSPIServiceInterrupt( void )
+{
+    if (!isInterruptEnabled || !isWordPending)
+    {
+        return false;
+    }
+    isWordPending = false;
+    SPIAsyncWordComplete( pendingWord );
+    return true;
+}
+
+void HostSPIGetStats( HOST_SPI_STATS * stats )
+{
+    if (NULL != stats)
+    {
+        *stats = hostStats;
+    }
+}
+
+void HostSPIResetStats( void )
+{
+    memset( &hostStats, 0, sizeof (hostStats) );
+}
+
+/* Transport implementation */
+
+static uint16_t hostSPItransferWord( const uint16_t writeData )
+{
+    hostStats.words++;
+    uint8_t highByte = (uint8_t) (writeData >> 8);
+    uint8_t lowByte = (uint8_t) (writeData & 0xFF);
+
+    if (isCommandPending)
+    {
+        isCommandPending = false;
+        commandByte = highByte;
+        frameDataByteIndex = 0;
+        return modelTransferByte( commandByte, lowByte );
+    }
+
+    uint16_t responseHigh = modelTransferByte( commandByte, highByte );
+    uint16_t responseLow = modelTransferByte( commandByte, lowByte );
+    return (responseHigh << 8) | responseLow;
+}
+
+static void hostSPItransferBuffer( const uint16_t * writeData,
+                                   uint16_t * readData,
+                                   const uint16_t numWords )
+{
+    uint16_t wordIndex;
+    uint16_t receivedWord;
+    for (wordIndex = 0; wordIndex < numWords; wordIndex++)
+    {
+        receivedWord = hostSPItransferWord( writeData[wordIndex] );
+        if (NULL != readData)
+        {
+            readData[wordIndex] = receivedWord;
+        }
+    }
+}
+
+static void hostSPIchipSelect( const uint16_t chipSelectLine,
+                               const bool isSelected )
+{
+    if (isSelected)
+    {
+        selectedModel = (chipSelectLine < HOST_SPI_MAX_DEVICES) ? attachedModels[chipSelectLine] : NULL;
+        isCommandPending = true;
+        hostStats.transactions++;
+    }
+    else
+    {
+        selectedModel = NULL;
+        isCommandPending = false;
+    }
+}
+
+/* The model answers instantly - the response is held until HostSPIServiceInterrupt delivers it */
+static void hostSPIstartWord( const uint16_t writeData )
+{
+    pendingWord = hostSPItransferWord( writeData );
+    isWordPending = true;
+}
+
+static void hostSPIenableCompletionInterrupt( const bool isEnabled )
+{
+    isInterruptEnabled = isEnabled;
+}
+
+/* Model implementation */
+
+/* Clocks one data byte of the current frame through the selected model and returns the MISO byte */
+static uint8_t modelTransferByte( const uint8_t command,
+                                  const uint8_t dataByte )
+{
+    uint8_t byteIndex = frameDataByteIndex++;
+    if (NULL == selectedModel)
+    {
+        return 0; // Nothing attached on this line
+    }
+
+    uint8_t channelIndex = (command & COMMAND_CHANNEL_BIT) ? 1 : 0;
+    uint8_t address = command & COMMAND_ADDRESS_MASK;
+    bool isWrite = (command & COMMAND_WRITE_BIT) ? true : false;
+
+    if (REGISTER_INDEX( max3109_TRxHR ) == address)
+    {
+        HOST_MAX3109_CHANNEL_MODEL * channelModel = &selectedModel->channels[channelIndex];
+        uint8_t oldRxCount = channelModel->rxFIFO.count;
+        uint8_t oldTxCount = channelModel->txFIFO.count;
+        uint8_t value = 0;
+        if (isWrite)
+        {
+            if (fifoPush( &channelModel->txFIFO, dataByte ))
+            {
+                hostStats.txFIFOBytes++;
+            }
+            else
+            {
+                channelModel->txOverruns++;
+            }
+        }
+        else if (fifoPop( &channelModel->rxFIFO, &value ))
+        {
+            hostStats.rxFIFOBytes++;
+        }
+        modelLatchFIFOEdges( channelModel, oldRxCount, oldTxCount );
+        return value;
+    }
+
+    /* Every other register address auto increments, the model stops at the end of the register map */
+    if ((address + byteIndex) > COMMAND_ADDRESS_MASK)
+    {
+        return 0;
+    }
+    address += byteIndex;
+    hostStats.registerBytes++;
+
+    if (isWrite)
+    {
+        modelWriteRegister( selectedModel, channelIndex, address, dataByte );
+        return 0;
+    }
+    return modelReadRegister( selectedModel, channelIndex, address );
+}
+
+static uint8_t modelReadRegister( HOST_MAX3109_MODEL * model,
+                                  const uint8_t channelIndex,
+                                  const uint8_t address )
+{
+    HOST_MAX3109_CHANNEL_MODEL * channelModel = &model->channels[channelIndex];
+    uint8_t value;
+
+    switch (address)
+    {
+        case REGISTER_INDEX( max3109_ISR_Status ):
+            value = channelModel->latchedISR;
+            channelModel->latchedISR = 0; // Cleared on read
+            return value;
+
+        case REGISTER_INDEX( max3109_TxFIFOLvl ):
+            return channelModel->txFIFO.count;
+
+        case REGISTER_INDEX( max3109_RxFIFOLvl ):
+            return channelModel->rxFIFO.count;
+
+        case REGISTER_INDEX( max3109_GlobalIRQ ):
+        {
+            /* Active low - a cleared bit means that UART has an enabled interrupt pending */
+            uint8_t pending = 0;
+            uint8_t index;
+            for (index = 0; index < HOST_MAX3109_NUM_CHANNELS; index++)
+            {
+                if (model->channels[index].latchedISR & model->channels[index].registers[REGISTER_INDEX( max3109_IRQEn )])
+                {
+                    pending |= (uint8_t) (1 << index);
+                }
+            }
+            return (uint8_t) (0x03 & ~pending);
+        }
+
+        case REGISTER_INDEX( max3109_PLLConfig ):
+        case REGISTER_INDEX( max3109CLKSource ):
+            return model->channels[0].registers[address]; // Global registers live in UART0
+
+        default:
+            return channelModel->registers[address];
+    }
+}
+
+static void modelWriteRegister( HOST_MAX3109_MODEL * model,
+                                const uint8_t channelIndex,
+                                const uint8_t address,
+                                const uint8_t value )
+{
+    HOST_MAX3109_CHANNEL_MODEL * channelModel = &model->channels[channelIndex];
+
+    switch (address)
+    {
+        case REGISTER_INDEX( max3109_MODE2 ):
+            if (value & MODE2_RESET)
+            {
+                modelResetChannel( channelModel );
+            }
+            else if (value & MODE2_FIFO_RESET)
+            {
+                channelModel->rxFIFO.count = 0;
+                channelModel->txFIFO.count = 0;
+            }
+            channelModel->registers[address] = value;
+            break;
+
+        case REGISTER_INDEX( max3109_ISR_Status ):
+        case REGISTER_INDEX( max3109_TxFIFOLvl ):
+        case REGISTER_INDEX( max3109_RxFIFOLvl ):
+        case REGISTER_INDEX( max3109_GloblComnd ):
+            break; // Read only, or global commands the model does not implement
+
+        case REGISTER_INDEX( max3109_PLLConfig ):
+        case REGISTER_INDEX( max3109CLKSource ):
+            model->channels[0].registers[address] = value; // Global registers live in UART0
+            break;
+
+        default:
+            channelModel->registers[address] = value;
+            break;
+    }
+}
+
+static void modelResetChannel( HOST_MAX3109_CHANNEL_MODEL * channelModel )
+{
+    memset( channelModel, 0, sizeof (*channelModel) );
+    channelModel->registers[REGISTER_INDEX( max3109_DIVLSB )] = 0x01;
+    channelModel->registers[REGISTER_INDEX( max3109_PLLConfig )] = 0x01;
+    channelModel->registers[REGISTER_INDEX( max3109CLKSource )] = 0x08; // PLL bypassed
+}
+
+/* With AutoRTS the remote sender is held off at the halt level instead of overrunning the RxFIFO */
+static uint8_t modelRxHaltLevel( const HOST_MAX3109_CHANNEL_MODEL * channelModel )
+{
+    if (channelModel->registers[REGISTER_INDEX( max3109_FlowCtrl )] & FLOWCTRL_AUTO_RTS)
+    {
+        return (uint8_t) ((channelModel->registers[REGISTER_INDEX( max3109_FlowLvl )] & FLOWLVL_HALT_MASK) * FLOW_LEVEL_STEP);
+    }
+    return MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES;
+}
+
+/* Latches the interrupt bits raised by FIFO level transitions */
+static void modelLatchFIFOEdges( HOST_MAX3109_CHANNEL_MODEL * channelModel,
+                                 const uint8_t oldRxCount,
+                                 const uint8_t oldTxCount )
+{
+    uint8_t rxCount = channelModel->rxFIFO.count;
+    uint8_t rxTriggerLevel = (channelModel->registers[REGISTER_INDEX( max3109_FIFOTrgLvl )] >> 4) * 8;
+    bool isRxEmptyInverted = (channelModel->registers[REGISTER_INDEX( max3109_MODE2 )] & MODE2_RX_EMPTY_INVERT) ? true : false;
+
+    if ((rxTriggerLevel > 0) && (oldRxCount < rxTriggerLevel) && (rxCount >= rxTriggerLevel))
+    {
+        channelModel->latchedISR |= ISR_RX_TRIGGER;
+    }
+    if ((!isRxEmptyInverted && (oldRxCount > 0) && (0 == rxCount)) ||
+        (isRxEmptyInverted && (0 == oldRxCount) && (rxCount > 0)))
+    {
+        channelModel->latchedISR |= ISR_RX_EMPTY;
+    }
+    if (0 == rxCount)
+    {
+        channelModel->registers[REGISTER_INDEX( max3109_LSR )] &= (uint8_t) ~LSR_RX_TIMEOUT;
+    }
+    if ((oldTxCount > 0) && (0 == channelModel->txFIFO.count))
+    {
+        channelModel->latchedISR |= ISR_TX_EMPTY;
+    }
+}
+
+static inline bool fifoPush( HOST_MAX3109_FIFO * fifo,
+                             const uint8_t value )
+{
+    if (fifo->count >= MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES)
+    {
+        return false;
+    }
+    fifo->data[(fifo->head + fifo->count) % MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES] = value;
+    fifo->count++;
+    return true;
+}
+
+static inline bool fifoPop( HOST_MAX3109_FIFO * fifo,
+                            uint8_t * value )
+{
+    if (0 == fifo->count)
+    {
+        return false;
+    }
+    *value = fifo->data[fifo->head];
+    fifo->head = (uint8_t) ((fifo->head + 1) % MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES);
+    fifo->count--;
+    return true;
+}
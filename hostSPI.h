@@ -0,0 +1,83 @@
+/* File: hostSPI
+ * Author: Henry Gilbert
+ * Description : Linux host implementation of the SPI transport, backed by a software model of the MAX3109 register
+ *      file and FIFOs. Lets the MAX3109 and SPItoUART layers be compiled, exercised and profiled off target. The
+ *      transport counts chip select frames, words and FIFO bytes so throughput regressions show up as numbers.
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SPITransport.h"
+#include "MAX3109.h"
+
+#define HOST_SPI_MAX_DEVICES 16 // Chip select lines are model indexes on the host
+#define HOST_MAX3109_NUM_CHANNELS 2
+#define HOST_MAX3109_NUM_REGISTERS 0x20
+
+typedef struct HOST_MAX3109_FIFO_t {
+    uint8_t data[MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES];
+    uint8_t head;
+    uint8_t count;
+} HOST_MAX3109_FIFO;
+
+typedef struct HOST_MAX3109_CHANNEL_MODEL_t {
+    uint8_t registers[HOST_MAX3109_NUM_REGISTERS];
+    HOST_MAX3109_FIFO rxFIFO;
+    HOST_MAX3109_FIFO txFIFO;
+    uint8_t latchedISR; // Interrupt bits latched since the last ISR_Status read
+    uint32_t rxOverruns; // Bytes lost because the RxFIFO was full
+    uint32_t txOverruns; // Bytes lost because the TxFIFO was full
+} HOST_MAX3109_CHANNEL_MODEL;
+
+typedef struct HOST_MAX3109_MODEL_t {
+    HOST_MAX3109_CHANNEL_MODEL channels[HOST_MAX3109_NUM_CHANNELS];
+} HOST_MAX3109_MODEL;
+
+typedef struct HOST_SPI_STATS_t {
+    uint32_t transactions; // Chip select frames
+    uint32_t words; // 16 bit words clocked
+    uint32_t rxFIFOBytes; // Bytes popped from RxFIFOs
+    uint32_t txFIFOBytes; // Bytes pushed to TxFIFOs
+    uint32_t registerBytes; // Data bytes to or from every other register - one frame each without register bursts
+} HOST_SPI_STATS;
+
+/* Host implementation of the SPI transport */
+extern const SPI_TRANSPORT hostSPITransport;
+
+/* Puts a model into its power on reset state */
+void HostMAX3109ModelReset( HOST_MAX3109_MODEL * model );
+
+/* Attaches a model to a chip select line. Passing NULL detaches the line. Returns 0 on success, 1 on error. */
+uint8_t HostSPIAttachModel( const uint16_t chipSelectLine,
+                            HOST_MAX3109_MODEL * model );
+
+/* Simulates bytes arriving on the UART line. Returns the number of bytes accepted by the RxFIFO. With AutoRTS
+ * enabled the sender is held off at the FlowLvl halt level, so the remaining bytes are refused rather than overrun. */
+uint8_t HostMAX3109InjectRx( HOST_MAX3109_MODEL * model,
+                             const MAX3109_UART_SELECTION channel,
+                             const uint8_t * src,
+                             const uint8_t numBytes );
+
+/* Simulates the UART line shifting bytes out of the TxFIFO. Returns the number of bytes copied to dst. */
+uint8_t HostMAX3109DrainTx( HOST_MAX3109_MODEL * model,
+                            const MAX3109_UART_SELECTION channel,
+                            uint8_t * dst,
+                            const uint8_t maxBytes );
+
+/* Simulates the channel's TX line wired back to its own RX line: moves up to maxBytes from the TxFIFO to the RxFIFO,
+ * no more than the RxFIFO (and its AutoRTS halt level) accepts. Returns the number of bytes moved. */
+uint8_t HostMAX3109Loopback( HOST_MAX3109_MODEL * model,
+                             const MAX3109_UART_SELECTION channel,
+                             const uint8_t maxBytes );
+
+/* Stands in for the completion interrupt of the non-blocking path. If a word started by SPIAsync is pending and the
+ * interrupt is enabled, delivers it to SPIAsyncWordComplete. Returns true if a word was delivered. */
+bool HostSPIServiceInterrupt( void );
+
+void HostSPIGetStats( HOST_SPI_STATS * stats );
+void HostSPIResetStats( void );
+
+#endif
@@ -0,0 +1,105 @@
+#include "mpmcQueue.h"
+// Slot sequence protocol, for position pos in the ring:
+//	sequence == pos			slot is free for the producer that claims pos
+//	sequence == pos + 1		slot holds the value for the consumer that claims pos
+// A consumer frees the slot for the next lap by storing pos + capacity.
+
+/* Attaches caller owned slots. Returns false if capacity is not a power of two of at least 2.
+Not thread safe - initialize before sharing the queue */
+bool mq_init(MpmcQueue* q,
+			 MpmcSlot* storage,
+			 size_t capacity)
+{
+	if ((NULL == q) || (NULL == storage) || (capacity < 2) || (0 != (capacity & (capacity - 1))))
+	{
+		return false;
+	}
+
+	size_t index;
+	for (index = 0; index < capacity; index++)
+	{
+		atomic_store_explicit(&storage[index].sequence, index, memory_order_relaxed);
+	}
+	q->slots = storage;
+	q->mask = capacity - 1;
+	atomic_store_explicit(&q->write, 0, memory_order_relaxed);
+	atomic_store_explicit(&q->read, 0, memory_order_release);
+	return true;
+}
+
+/* Returns false if the queue is full */
+bool mq_push(MpmcQueue* q,
+			 uint32_t value)
+{
+	size_t pos = atomic_load_explicit(&q->write, memory_order_relaxed);
+	MpmcSlot* slot;
+	for (;;)
+	{
+		slot = &q->slots[pos & q->mask];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (0 == diff)
+		{
+			// Slot is free for this lap - claim it. On failure pos is reloaded with the current write
+			if (atomic_compare_exchange_weak_explicit(&q->write, &pos, pos + 1,
+													  memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false; // Slot still holds last lap's value - full
+		}
+		else
+		{
+			pos = atomic_load_explicit(&q->write, memory_order_relaxed); // Another producer claimed pos
+		}
+	}
+
+	slot->value = value;
+	atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+	return true;
+}
+
+/* Returns false if the queue is empty */
+bool mq_pop(MpmcQueue* q,
+			uint32_t* value)
+{
+	size_t pos = atomic_load_explicit(&q->read, memory_order_relaxed);
+	MpmcSlot* slot;
+	for (;;)
+	{
+		slot = &q->slots[pos & q->mask];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (0 == diff)
+		{
+			if (atomic_compare_exchange_weak_explicit(&q->read, &pos, pos + 1,
+													  memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false; // Slot not filled for this lap yet - empty
+		}
+		else
+		{
+			pos = atomic_load_explicit(&q->read, memory_order_relaxed); // Another consumer claimed pos
+		}
+	}
+
+	*value = slot->value;
+	atomic_store_explicit(&slot->sequence, pos + q->mask + 1, memory_order_release);
+	return true;
+}
+
+// Returns number of pushed entries in queue. Only a snapshot while other threads are running
+size_t mq_numMsgsInQueue(MpmcQueue* q)
+{
+	size_t read = atomic_load_explicit(&q->read, memory_order_acquire);
+	size_t write = atomic_load_explicit(&q->write, memory_order_acquire);
+	return (write > read) ? (write - read) : 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded multi producer / multi consumer queue for host builds (Linux gateway threads). Each slot carries a
+// sequence number that tells producers and consumers whether the slot is free or filled for their lap of the
+// ring, so a push or pop is one CAS on a counter plus one release store - no mutex, no lock convoy.
+// The write and read counters sit on separate cache lines so producers and consumers don't false share.
+
+#if defined(__STDC_NO_ATOMICS__) || !defined(__STDC_VERSION__) || (__STDC_VERSION__ < 201112L)
+#error "mpmcQueue requires C11 atomics - use ringQueue.h on targets without them"
+#endif
+#include <stdatomic.h>
+
+#define MPMC_CACHE_LINE_SIZE 64
+
+typedef struct MpmcSlot_t
+{
+	_Atomic size_t sequence;
+	uint32_t value;
+} MpmcSlot;
+
+typedef struct MpmcQueue_t
+{
+	_Alignas(MPMC_CACHE_LINE_SIZE) _Atomic size_t write; // next position to claim for a push
+	_Alignas(MPMC_CACHE_LINE_SIZE) _Atomic size_t read; // next position to claim for a pop
+	_Alignas(MPMC_CACHE_LINE_SIZE) MpmcSlot* slots; // read only after init, kept off the counter lines
+	size_t mask; // capacity - 1
+} MpmcQueue;
+
+bool mq_init(MpmcQueue* q,
+			 MpmcSlot* storage,
+			 size_t capacity);
+bool mq_push(MpmcQueue* q,
+			 uint32_t value);
+bool mq_pop(MpmcQueue* q,
+			uint32_t* value);
+size_t mq_numMsgsInQueue(MpmcQueue* q);
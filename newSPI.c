@@ -1,14 +1,30 @@
 /* File: newSPI
  * Author: Henry Gilbert
- * Description : Basic function calls for using SPI port.
+ * Description : Basic function calls for using SPI port. Implements the SPI transport on the dsPIC SPI1 peripheral.
  */
 
 #include "newSPI.h"
+#include "SPIAsync.h"
 #include "pic_h/p30F6014A.h"
+#include <stddef.h>
 
 /* Local Function Prototypes */
-static inline void csLow( );
-static inline void csHigh( );
+static uint16_t dsPICSPItransferWord( const uint16_t writeData );
+static void dsPICSPItransferBuffer( const uint16_t * writeData,
+                                    uint16_t * readData,
+                                    const uint16_t numWords );
+static void dsPICSPIchipSelect( const uint16_t chipSelectLine,
+                                const bool isSelected );
+static void dsPICSPIstartWord( const uint16_t writeData );
+static void dsPICSPIenableCompletionInterrupt( const bool isEnabled );
+
+const SPI_TRANSPORT dsPICSPITransport = {
+    dsPICSPItransferWord,
+    dsPICSPItransferBuffer,
+    dsPICSPIchipSelect,
+    dsPICSPIstartWord,
+    dsPICSPIenableCompletionInterrupt
+};
 
 /* Initializes the SPI port based on configuration mode and status config - sets chip select high */
 void InitializeSPI( uint16_t uModeConfig,
@@ -20,36 +36,81 @@ void InitializeSPI( uint16_t uModeConfig,
 
     /* Clear the Interrupt flag, setup interrupt enable, set interrupt priority */
     IFS0bits.SPI1IF = 0;
-    IPC2bits.SPI1IP = 0;
+    IPC2bits.SPI1IP = SPI1_ASYNC_INTERRUPT_PRIORITY;
     IEC0bits.SPI1IE = 0;
     //    SPI1STATbits.SPIROV = 0;
 
     SPI1CON = uModeConfig;
     SPI1STAT = SPI1StatusConfig;
-    csHigh( );
+    dsPICSPIchipSelect( AFC004_SPI_CS_LINE, false );
+    SPISetTransport( &dsPICSPITransport, AFC004_SPI_CS_LINE );
+}
+
+void SPIConfigureChipSelectLine( const uint16_t chipSelectLine )
+{
+    dsPICSPIchipSelect( chipSelectLine, false );
+    TRISB &= ~chipSelectLine;
 }
 
 /* Reads and writes a single 16 bit word to MOSI.  */
-uint8_t SPIreadWriteWord( uint16_t writeData,
-                          uint16_t * readData )
+static uint16_t dsPICSPItransferWord( const uint16_t writeData )
 {
-    csLow( );
     SPI1BUF = writeData;
     while (!SPI1STATbits.SPIRBF);
-    *readData = SPI1BUF;
-    csHigh( );
-    return 0;
+    return SPI1BUF;
 }
 
-/* These are specific to the AFC004 project - must be updated per implementation */
-static inline void csLow( )
+/* Reads and writes a buffer of 16 bit words back to back. readData may point at writeData (each word is
+ * sent before its response is stored), or be NULL if the response words are not needed. */
+static void dsPICSPItransferBuffer( const uint16_t * writeData,
+                                    uint16_t * readData,
+                                    const uint16_t numWords )
 {
-    LATBbits.LATB4 = 0;
-    LATBbits.LATB2 = 0;
+    uint16_t wordIndex;
+    uint16_t receivedWord;
+    for (wordIndex = 0; wordIndex < numWords; wordIndex++)
+    {
+        SPI1BUF = writeData[wordIndex];
+        while (!SPI1STATbits.SPIRBF);
+        receivedWord = SPI1BUF;
+        if (NULL != readData)
+        {
+            readData[wordIndex] = receivedWord;
+        }
+    }
+}
+
+/* Non-blocking path. The interrupt flag is cleared before each word so a flag left over from a synchronous
+ * transfer can never be taken as an async completion */
+static void dsPICSPIstartWord( const uint16_t writeData )
+{
+    IFS0bits.SPI1IF = 0;
+    SPI1BUF = writeData;
 }
 
-static inline void csHigh( )
+static void dsPICSPIenableCompletionInterrupt( const bool isEnabled )
 {
-    LATBbits.LATB4 = 1;
-    LATBbits.LATB2 = 1;
-}
\ No newline at end of file
+    IEC0bits.SPI1IE = (isEnabled) ? 1 : 0;
+}
+
+/* SPI1 receive complete - hand the word to the async engine, which starts the next word if there is one */
+void __attribute__((__interrupt__, no_auto_psv)) _SPI1Interrupt( void )
+{
+    uint16_t receivedWord = SPI1BUF;
+    IFS0bits.SPI1IF = 0;
+    SPIAsyncWordComplete( receivedWord );
+}
+
+/* Chip select is active low. The line is a LATB bit mask - see AFC004_SPI_CS_LINE */
+static void dsPICSPIchipSelect( const uint16_t chipSelectLine,
+                                const bool isSelected )
+{
+    if (isSelected)
+    {
+        LATB &= ~chipSelectLine;
+    }
+    else
+    {
+        LATB |= chipSelectLine;
+    }
+}
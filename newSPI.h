@@ -3,11 +3,22 @@
 
 #include <stdint.h>
 #include "p30F6014A.h"
+#include "SPITransport.h"
 
+/* Chip select lines are LATB bit masks. AFC004 drives RB2 and RB4 together. */
+#define AFC004_SPI_CS_LINE ((1 << 2) | (1 << 4))
+
+/* SPI1 interrupt priority used by the non-blocking path (SPIAsync). The interrupt stays disabled until a transfer is queued */
+#define SPI1_ASYNC_INTERRUPT_PRIORITY 4
+
+/* dsPIC SPI1 implementation of the SPI transport */
+extern const SPI_TRANSPORT dsPICSPITransport;
+
+/* Configures SPI1 and selects it as the active transport on the AFC004 chip select line */
 void InitializeSPI(uint16_t u16ModeConfig,
         uint16_t u16SPI1StatusConfig);
 
-uint8_t SPIreadWriteWord(uint16_t writeData,
-        uint16_t * readData);
+/* Makes the LATB pins of a chip select line outputs and deselects them - call once per additional chip on the bus */
+void SPIConfigureChipSelectLine(const uint16_t chipSelectLine);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,256 @@
+#include "nmeaFramer.h"
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+// The ring only ever holds the sentence being received: nf_feed copies in at most the free space, scans it, and frees
+// every completed or discarded sentence before copying more. Scanning works on the contiguous runs of the ring, so a
+// word or vector load never crosses the wrap.
+
+#define NF_LINE_FEED 0x0A
+#define NF_CARRIAGE_RETURN 0x0D
+#define NF_SWAR_ONES 0x01010101UL
+#define NF_SWAR_HIGHS 0x80808080UL
+#define NF_SWAR_LINE_FEEDS (NF_SWAR_ONES * NF_LINE_FEED)
+
+// Non zero if any byte of word is zero
+#define NF_SWAR_HAS_ZERO_BYTE(word) (((word) - NF_SWAR_ONES) & ~(word) & NF_SWAR_HIGHS)
+
+static size_t nf_scan_run(NmeaFramer* f,
+						  size_t end);
+static void nf_complete_line(NmeaFramer* f,
+							 size_t lineFeed);
+static uint8_t nf_fold_xor(uint32_t value);
+static int nf_hex_value(uint8_t c);
+
+bool nf_init(NmeaFramer* f,
+			 uint8_t* storage,
+			 size_t capacity,
+			 size_t maxFrameLength,
+			 NMEA_FRAME_CALLBACK onFrame,
+			 void* context)
+{
+	if (0 == maxFrameLength)
+	{
+		maxFrameLength = NF_MAX_SENTENCE_LENGTH;
+	}
+	if ((NULL == f) || (NULL == storage) || (NULL == onFrame) || (0 != (capacity & (capacity - 1))) ||
+		(capacity <= maxFrameLength))
+	{
+		return false;
+	}
+	f->data = storage;
+	f->mask = capacity - 1;
+	f->maxFrameLength = maxFrameLength;
+	f->onFrame = onFrame;
+	f->context = context;
+	nf_reset(f);
+	return true;
+}
+
+void nf_reset(NmeaFramer* f)
+{
+	f->write = 0;
+	f->frameStart = 0;
+	f->scan = 0;
+	f->runningXor = 0;
+	f->isDiscarding = false;
+	f->framesDelivered = 0;
+	f->checksumErrors = 0;
+	f->malformedFrames = 0;
+}
+
+size_t nf_feed(NmeaFramer* f,
+			   const uint8_t* bytes,
+			   size_t count)
+{
+	if ((NULL == f) || (NULL == bytes))
+	{
+		return 0;
+	}
+
+	uint32_t framesBefore = f->framesDelivered;
+	while (count > 0)
+	{
+		// Copy in as much as fits, in up to two contiguous pieces
+		size_t space = (f->mask + 1) - (f->write - f->frameStart);
+		size_t chunk = (count < space) ? count : space;
+		size_t offset = f->write & f->mask;
+		size_t firstCount = ((f->mask + 1) - offset < chunk) ? ((f->mask + 1) - offset) : chunk;
+		memcpy(&f->data[offset], bytes, firstCount);
+		memcpy(f->data, bytes + firstCount, chunk - firstCount);
+		f->write += chunk;
+		bytes += chunk;
+		count -= chunk;
+
+		// Scan the new bytes one contiguous run at a time
+		while (f->scan != f->write)
+		{
+			size_t runEnd = f->write;
+			size_t toWrap = (f->mask + 1) - (f->scan & f->mask);
+			if ((runEnd - f->scan) > toWrap)
+			{
+				runEnd = f->scan + toWrap;
+			}
+			f->scan = nf_scan_run(f, runEnd);
+		}
+
+		// A sentence that outgrew the limit is dropped here, which also guarantees space for the next chunk
+		if ((f->write - f->frameStart) > f->maxFrameLength)
+		{
+			if (false == f->isDiscarding)
+			{
+				f->malformedFrames++;
+			}
+			f->isDiscarding = true;
+			f->frameStart = f->write;
+			f->runningXor = 0;
+		}
+	}
+	return f->framesDelivered - framesBefore;
+}
+
+/* Scans [f->scan, end), which does not wrap, up to and including the first line feed. Returns the index to resume at */
+static size_t nf_scan_run(NmeaFramer* f,
+						  size_t end)
+{
+	size_t index = f->scan;
+	const uint8_t* p = &f->data[index & f->mask];
+	uint32_t runningXor = f->runningXor;
+
+#if defined(__SSE2__)
+	const __m128i lineFeeds = _mm_set1_epi8(NF_LINE_FEED);
+	__m128i vectorXor = _mm_setzero_si128();
+	while ((end - index) >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)p);
+		if (0 != _mm_movemask_epi8(_mm_cmpeq_epi8(block, lineFeeds)))
+		{
+			break;
+		}
+		vectorXor = _mm_xor_si128(vectorXor, block);
+		p += 16;
+		index += 16;
+	}
+	vectorXor = _mm_xor_si128(vectorXor, _mm_srli_si128(vectorXor, 8));
+	vectorXor = _mm_xor_si128(vectorXor, _mm_srli_si128(vectorXor, 4));
+	runningXor ^= (uint32_t)_mm_cvtsi128_si32(vectorXor);
+#endif
+
+	// Four bytes at a time - the XOR of the words folds down to the XOR of the bytes
+	while ((end - index) >= sizeof(uint32_t))
+	{
+		uint32_t word;
+		memcpy(&word, p, sizeof(word));
+		if (NF_SWAR_HAS_ZERO_BYTE(word ^ NF_SWAR_LINE_FEEDS))
+		{
+			break;
+		}
+		runningXor ^= word;
+		p += sizeof(word);
+		index += sizeof(word);
+	}
+
+	// Byte at a time through the word holding the line feed, or the tail of the run
+	while (index != end)
+	{
+		uint8_t c = *p++;
+		index++;
+		if (NF_LINE_FEED == c)
+		{
+			f->runningXor = runningXor;
+			nf_complete_line(f, index - 1);
+			return index;
+		}
+		runningXor ^= c;
+	}
+	f->runningXor = runningXor;
+	return index;
+}
+
+/* Checks and delivers the sentence ending at the line feed, then starts the next sentence after it */
+static void nf_complete_line(NmeaFramer* f,
+							 size_t lineFeed)
+{
+	size_t start = f->frameStart;
+	size_t length = lineFeed - start;
+	uint8_t checksum = nf_fold_xor(f->runningXor);
+	bool isDiscarding = f->isDiscarding;
+
+	f->frameStart = lineFeed + 1;
+	f->runningXor = 0;
+	f->isDiscarding = false;
+	if (isDiscarding)
+	{
+		return; // Tail of an oversized sentence
+	}
+
+	// The limit counts the line feed, like nf_feed does for a sentence still being received, so a sentence is
+	// judged the same however its bytes were split across nf_feed calls
+	bool isTooLong = (length + 1) > f->maxFrameLength;
+	if ((length > 0) && (NF_CARRIAGE_RETURN == f->data[(lineFeed - 1) & f->mask]))
+	{
+		checksum ^= NF_CARRIAGE_RETURN;
+		length--;
+	}
+	if (0 == length)
+	{
+		return; // Blank line
+	}
+	uint8_t delimiter = f->data[start & f->mask];
+	if ((('$' != delimiter) && ('!' != delimiter)) || isTooLong)
+	{
+		f->malformedFrames++;
+		return; // No start delimiter, or over the limit
+	}
+	checksum ^= delimiter; // The checksum covers the bytes between the delimiter and the '*'
+
+	NmeaFrameView view;
+	view.checksumStatus = nf_ChecksumAbsent;
+	if ((length >= 4) && ('*' == f->data[(start + length - 3) & f->mask]))
+	{
+		uint8_t high = f->data[(start + length - 2) & f->mask];
+		uint8_t low = f->data[(start + length - 1) & f->mask];
+		int expected = (nf_hex_value(high) << 4) | nf_hex_value(low);
+		checksum ^= (uint8_t)('*' ^ high ^ low);
+		if ((nf_hex_value(high) < 0) || (nf_hex_value(low) < 0) || (expected != checksum))
+		{
+			f->checksumErrors++;
+			return;
+		}
+		view.checksumStatus = nf_ChecksumValid;
+	}
+
+	size_t offset = start & f->mask;
+	size_t toWrap = (f->mask + 1) - offset;
+	view.first = &f->data[offset];
+	view.firstLength = (length < toWrap) ? length : toWrap;
+	view.second = f->data;
+	view.secondLength = length - view.firstLength;
+	f->framesDelivered++;
+	f->onFrame(f->context, &view);
+}
+
+static uint8_t nf_fold_xor(uint32_t value)
+{
+	value ^= value >> 16;
+	value ^= value >> 8;
+	return (uint8_t)value;
+}
+
+static int nf_hex_value(uint8_t c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
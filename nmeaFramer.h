@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Incremental NMEA 0183 sentence framer. Received bytes are copied once into the framer's own power of two ring,
+// scanned for the line feed a word at a time (SSE2 on hosts that have it), and the XOR checksum is accumulated in the
+// same pass. Each complete sentence is handed to the callback as a view into the ring - no copy is made, and the
+// view is only valid until the callback returns.
+
+#define NF_MAX_SENTENCE_LENGTH 82 // NMEA 0183 limit, '$' through the line feed
+
+typedef enum NmeaChecksumStatus_t
+{
+	nf_ChecksumValid = 0,
+	nf_ChecksumAbsent // No "*hh" field - some proprietary sentences omit it
+} NmeaChecksumStatus;
+
+// A sentence from '$' or '!' up to, not including, the "\r\n". The second span is only used when the sentence wraps
+// the end of the ring.
+typedef struct NmeaFrameView_t
+{
+	const uint8_t* first;
+	size_t firstLength;
+	const uint8_t* second;
+	size_t secondLength;
+	NmeaChecksumStatus checksumStatus;
+} NmeaFrameView;
+
+typedef void (*NMEA_FRAME_CALLBACK)(void* context,
+									const NmeaFrameView* frame);
+
+typedef struct NmeaFramer_t
+{
+	uint8_t* data;
+	size_t mask; // capacity - 1
+	size_t write; // free running
+	size_t frameStart; // free running index of the first byte of the sentence being received
+	size_t scan; // free running index of the next byte to scan
+	uint32_t runningXor; // XOR of the scanned bytes of the current sentence, folded to a byte when it completes
+	size_t maxFrameLength;
+	bool isDiscarding; // Sentence grew past maxFrameLength - skip to the next line feed
+	NMEA_FRAME_CALLBACK onFrame;
+	void* context;
+	uint32_t framesDelivered;
+	uint32_t checksumErrors;
+	uint32_t malformedFrames; // No start delimiter, or longer than maxFrameLength
+} NmeaFramer;
+
+// Attaches caller owned storage. capacity must be a power of two larger than maxFrameLength (0 uses
+// NF_MAX_SENTENCE_LENGTH). Returns false on invalid params.
+bool nf_init(NmeaFramer* f,
+			 uint8_t* storage,
+			 size_t capacity,
+			 size_t maxFrameLength,
+			 NMEA_FRAME_CALLBACK onFrame,
+			 void* context);
+
+// Feeds received bytes. Complete sentences are delivered from inside this call. Returns the number of sentences delivered.
+size_t nf_feed(NmeaFramer* f,
+			   const uint8_t* bytes,
+			   size_t count);
+
+// Drops any partial sentence and clears the counters
+void nf_reset(NmeaFramer* f);
@@ -1,4 +1,5 @@
 #include "queue.h"
+#include <string.h>
 // Push operation determines is q is full
 // Pop operaetion determines is q should be reset.
 // Control: Pop only allows a reset if all values have been read. Popping a value 
@@ -57,6 +58,52 @@ uint32_t q_pop(Queue* q)
 	return returnval;
 }
 
+/* Pushes up to count values with a single copy. Returns the number pushed - the rest didn't fit.
+Follows q_push: writing the final index leaves write there and sets isQueueFull. */
+size_t q_push_n(Queue* q,
+				const uint32_t* values,
+				size_t count)
+{
+	size_t space = (q->isQueueFull) ? 0 : q->capacity - q->write;
+	size_t n = (count < space) ? count : space;
+	if (0 == n)
+	{
+		return 0;
+	}
+
+	memcpy(&q->data[q->write], values, n * sizeof(uint32_t));
+	q->write += n;
+	if (q->write == q->capacity)
+	{
+		q->write = q->capacity - 1;
+		q->isQueueFull = true;
+	}
+	return n;
+}
+
+/* Pops up to count values with a single copy. Returns the number popped.
+Popping the last pushed value resets the queue, so its space is reclaimed at once. */
+size_t q_pop_n(Queue* q,
+			   uint32_t* values,
+			   size_t count)
+{
+	size_t end = (q->isQueueFull) ? q->capacity : q->write; // one past the last pushed value
+	size_t available = end - q->read;
+	size_t n = (count < available) ? count : available;
+	if (0 == n)
+	{
+		return 0;
+	}
+
+	memcpy(values, &q->data[q->read], n * sizeof(uint32_t));
+	q->read += n;
+	if (q->read == end)
+	{
+		q_reset(q);
+	}
+	return n;
+}
+
 /* Reads the first in value but doesn't pop */
 uint32_t q_peek(Queue* q, size_t offset)
 {
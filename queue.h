@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct Queue_t
 {
@@ -14,6 +15,12 @@ typedef struct Queue_t
 void q_push(Queue* q,
 			uint32_t value);
 uint32_t q_pop(Queue* q);
-uint32_t q_peek(Queue* q);
+size_t q_push_n(Queue* q,
+				const uint32_t* values,
+				size_t count);
+size_t q_pop_n(Queue* q,
+			   uint32_t* values,
+			   size_t count);
+uint32_t q_peek(Queue* q, size_t offset);
 void q_reset(Queue* q);
 size_t q_numMsgsInQueue(Queue* q);
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "ringQueue.h"
+#include <string.h>
+// Producer: writes the slot, then publishes it with a release store of write.
+// Consumer: reads the slot after an acquire load of write, then frees it with a release store of read.
+// Each side only loads the other side's counter, so no lock is needed between one producer and one consumer.
+
+/* Attaches caller owned storage. Returns false if capacity is not a non-zero power of two */
+bool rq_init(RingQueue* q,
+			 uint32_t* storage,
+			 size_t capacity)
+{
+	if ((NULL == q) || (NULL == storage) || (0 == capacity) || (0 != (capacity & (capacity - 1))))
+	{
+		return false;
+	}
+	q->data = storage;
+	q->mask = capacity - 1;
+	rq_reset(q);
+	return true;
+}
+
+/* Returns false if the queue is full */
+bool rq_push(RingQueue* q,
+			 uint32_t value)
+{
+	size_t write = RQ_LOAD_RELAXED(q->write);
+	if ((write - RQ_LOAD_ACQUIRE(q->read)) > q->mask)
+	{
+		return false;
+	}
+	q->data[write & q->mask] = value;
+	RQ_STORE_RELEASE(q->write, write + 1);
+	return true;
+}
+
+/* Returns false if the queue is empty - unlike q_pop, zero is never used as an empty marker */
+bool rq_pop(RingQueue* q,
+			uint32_t* value)
+{
+	size_t read = RQ_LOAD_RELAXED(q->read);
+	if (read == RQ_LOAD_ACQUIRE(q->write))
+	{
+		return false;
+	}
+	*value = q->data[read & q->mask];
+	RQ_STORE_RELEASE(q->read, read + 1);
+	return true;
+}
+
+/* Reads the value offset entries behind the oldest without popping. Any offset below the fill level is valid */
+bool rq_peek(RingQueue* q,
+			 size_t offset,
+			 uint32_t* value)
+{
+	size_t read = RQ_LOAD_RELAXED(q->read);
+	if (offset >= (RQ_LOAD_ACQUIRE(q->write) - read))
+	{
+		return false;
+	}
+	*value = q->data[(read + offset) & q->mask];
+	return true;
+}
+
+/* Splits count entries starting at free running index start into the spans before and after the wrap */
+static void rq_fill_spans(RingQueue* q,
+						  size_t start,
+						  size_t count,
+						  RingQueueSpans* spans)
+{
+	size_t index = start & q->mask;
+	size_t untilWrap = (q->mask + 1) - index;
+	spans->first = &q->data[index];
+	spans->firstCount = (count < untilWrap) ? count : untilWrap;
+	spans->second = q->data;
+	spans->secondCount = count - spans->firstCount;
+}
+
+/* Hands out up to count free slots. Returns the number reserved */
+size_t rq_write_reserve(RingQueue* q,
+						size_t count,
+						RingQueueSpans* spans)
+{
+	size_t write = RQ_LOAD_RELAXED(q->write);
+	size_t space = (q->mask + 1) - (write - RQ_LOAD_ACQUIRE(q->read));
+	size_t n = (count < space) ? count : space;
+	rq_fill_spans(q, write, n, spans);
+	return n;
+}
+
+/* Publishes count reserved slots to the consumer */
+void rq_write_commit(RingQueue* q,
+					 size_t count)
+{
+	RQ_STORE_RELEASE(q->write, RQ_LOAD_RELAXED(q->write) + count);
+}
+
+/* Hands out up to count pushed entries. Returns the number acquired */
+size_t rq_read_acquire(RingQueue* q,
+					   size_t count,
+					   RingQueueSpans* spans)
+{
+	size_t read = RQ_LOAD_RELAXED(q->read);
+	size_t available = RQ_LOAD_ACQUIRE(q->write) - read;
+	size_t n = (count < available) ? count : available;
+	rq_fill_spans(q, read, n, spans);
+	return n;
+}
+
+/* Returns count acquired entries to the producer */
+void rq_read_release(RingQueue* q,
+					 size_t count)
+{
+	RQ_STORE_RELEASE(q->read, RQ_LOAD_RELAXED(q->read) + count);
+}
+
+/* Pushes up to count values with at most two copies. Returns the number pushed */
+size_t rq_push_n(RingQueue* q,
+				 const uint32_t* values,
+				 size_t count)
+{
+	RingQueueSpans spans;
+	size_t n = rq_write_reserve(q, count, &spans);
+	memcpy(spans.first, values, spans.firstCount * sizeof(uint32_t));
+	memcpy(spans.second, &values[spans.firstCount], spans.secondCount * sizeof(uint32_t));
+	rq_write_commit(q, n);
+	return n;
+}
+
+/* Pops up to count values with at most two copies. Returns the number popped */
+size_t rq_pop_n(RingQueue* q,
+				uint32_t* values,
+				size_t count)
+{
+	RingQueueSpans spans;
+	size_t n = rq_read_acquire(q, count, &spans);
+	memcpy(values, spans.first, spans.firstCount * sizeof(uint32_t));
+	memcpy(&values[spans.firstCount], spans.second, spans.secondCount * sizeof(uint32_t));
+	rq_read_release(q, n);
+	return n;
+}
+
+// Returns number of pushed entries in queue
+size_t rq_numMsgsInQueue(RingQueue* q)
+{
+	size_t read = RQ_LOAD_ACQUIRE(q->read);
+	return RQ_LOAD_ACQUIRE(q->write) - read;
+}
+
+// Only safe while neither the producer nor the consumer is running
+void rq_reset(RingQueue* q)
+{
+	RQ_STORE_RELEASE(q->read, 0);
+	RQ_STORE_RELEASE(q->write, 0);
+}
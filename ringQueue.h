@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Wraparound queue: capacity is a power of two, read/write are free running counters masked on access.
+// Space is reclaimed as soon as a value is popped - there is no full flag and no reset-on-empty.
+// Safe for one producer and one consumer in different contexts (ISR producer, main loop consumer).
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define RQ_ATOMIC _Atomic
+#define RQ_LOAD_RELAXED(x) atomic_load_explicit(&(x), memory_order_relaxed)
+#define RQ_LOAD_ACQUIRE(x) atomic_load_explicit(&(x), memory_order_acquire)
+#define RQ_STORE_RELEASE(x, v) atomic_store_explicit(&(x), (v), memory_order_release)
+#else
+// No C11 atomics (XC16): single core, aligned word loads/stores are atomic and volatile keeps them in program order
+#define RQ_ATOMIC volatile
+#define RQ_LOAD_RELAXED(x) (x)
+#define RQ_LOAD_ACQUIRE(x) (x)
+#define RQ_STORE_RELEASE(x, v) ((x) = (v))
+#endif
+
+typedef struct RingQueue_t
+{
+	RQ_ATOMIC size_t write; // free running, only advanced by the producer
+	RQ_ATOMIC size_t read; // free running, only advanced by the consumer
+	uint32_t* data;
+	size_t mask; // capacity - 1
+} RingQueue;
+
+// Up to two contiguous regions of queue storage - the second is only used when the region wraps the end
+typedef struct RingQueueSpans_t
+{
+	uint32_t* first;
+	size_t firstCount;
+	uint32_t* second;
+	size_t secondCount;
+} RingQueueSpans;
+
+bool rq_init(RingQueue* q,
+			 uint32_t* storage,
+			 size_t capacity);
+bool rq_push(RingQueue* q,
+			 uint32_t value);
+bool rq_pop(RingQueue* q,
+			uint32_t* value);
+bool rq_peek(RingQueue* q,
+			 size_t offset,
+			 uint32_t* value);
+size_t rq_push_n(RingQueue* q,
+				 const uint32_t* values,
+				 size_t count);
+size_t rq_pop_n(RingQueue* q,
+				uint32_t* values,
+				size_t count);
+
+// Zero copy: reserve/acquire hand out storage directly, commit/release publish it. Producer side only
+// calls reserve/commit, consumer side only acquire/release. Committing or releasing less than was handed out is fine.
+size_t rq_write_reserve(RingQueue* q,
+						size_t count,
+						RingQueueSpans* spans);
+void rq_write_commit(RingQueue* q,
+					 size_t count);
+size_t rq_read_acquire(RingQueue* q,
+					   size_t count,
+					   RingQueueSpans* spans);
+void rq_read_release(RingQueue* q,
+					 size_t count);
+size_t rq_numMsgsInQueue(RingQueue* q);
+void rq_reset(RingQueue* q);
@@ -0,0 +1,34 @@
+#include "CircularBuffer.h"
+
+void cb_init ( circBuffer_t * cb, uint8_t * storage, const uint16_t size )
+{
+   cb->data = storage ;
+   cb->size = size ;
+   cb->head = 0 ;
+   cb->tail = 0 ;
+}
+
+/* Drops the value when full */
+void cb_push ( circBuffer_t * cb, const uint8_t value )
+{
+   if ( cb_count ( cb ) < cb->size )
+   {
+      cb->data [ cb->head & ( cb->size - 1 ) ] = value ;
+      cb->head++ ;
+   }
+}
+
+uint8_t cb_peek ( circBuffer_t * cb, const uint16_t offset )
+{
+   return cb->data [ ( uint16_t ) ( cb->tail + offset ) & ( cb->size - 1 ) ] ;
+}
+
+void cb_advance_tail ( circBuffer_t * cb, const uint16_t numValues )
+{
+   cb->tail += ( numValues < cb_count ( cb ) ) ? numValues : cb_count ( cb ) ;
+}
+
+uint16_t cb_count ( const circBuffer_t * cb )
+{
+   return ( uint16_t ) ( cb->head - cb->tail ) ;
+}
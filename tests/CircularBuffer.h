@@ -0,0 +1,28 @@
+/*
+ File: Host stand-in for the common library CircularBuffer module
+ Author: Henry Gilbert
+
+ Covers only the calls the MAX3109 layers make, so the host tests link without the target library. Size is a power
+ of two.
+ */
+
+#ifndef CIRCULAR_BUFFER_H
+#define CIRCULAR_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct circBuffer_t_ {
+   uint8_t * data ;
+   uint16_t size ;
+   uint16_t head ; // Free running write count
+   uint16_t tail ; // Free running read count
+} circBuffer_t ;
+
+void cb_init ( circBuffer_t * cb, uint8_t * storage, const uint16_t size ) ;
+void cb_push ( circBuffer_t * cb, const uint8_t value ) ;
+uint8_t cb_peek ( circBuffer_t * cb, const uint16_t offset ) ;
+void cb_advance_tail ( circBuffer_t * cb, const uint16_t numValues ) ;
+uint16_t cb_count ( const circBuffer_t * cb ) ;
+
+#endif
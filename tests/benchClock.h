@@ -0,0 +1,27 @@
+/*
+ File: Clocks shared by the host tests and benchmarks
+ Author: Henry Gilbert
+ */
+
+#ifndef BENCH_CLOCK_H
+#define BENCH_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* CPU time used by the calling thread */
+static inline uint64_t BenchCPUTimeNs ( void )
+{
+   struct timespec now ;
+   clock_gettime ( CLOCK_THREAD_CPUTIME_ID, &now ) ;
+   return ( ( uint64_t ) now.tv_sec * 1000000000ULL ) + ( uint64_t ) now.tv_nsec ;
+}
+
+static inline uint64_t BenchWallTimeNs ( void )
+{
+   struct timespec now ;
+   clock_gettime ( CLOCK_MONOTONIC, &now ) ;
+   return ( ( uint64_t ) now.tv_sec * 1000000000ULL ) + ( uint64_t ) now.tv_nsec ;
+}
+
+#endif
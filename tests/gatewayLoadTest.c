@@ -0,0 +1,274 @@
+/*
+ File: Load test of the serial gateway - every channel's PTY saturated at once, for growing channel counts
+ Author: Henry Gilbert
+
+ The gateway runs in its own thread on the host MAX3109 model with each channel looped back TX to RX, as hostGateway
+ does. For each channel count the client opens every PTY and keeps LOAD_WINDOW_BYTES in flight on each, so every line
+ stays busy, until LOAD_SECONDS of line time has gone through every channel. It reports the received rate over the
+ time the bytes were arriving against the line rate, and the gateway's receive latency. The test fails if any channel
+ loses, reorders or stalls bytes, or any RxFIFO overruns.
+ */
+
+#define _GNU_SOURCE
+#include "UARTGateway.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include "benchClock.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define BAUD_RATE 115200UL
+#define BITS_PER_CHARACTER 10 // 8N1 on the line
+#define SERVICE_PERIOD_US 1000UL
+#define FLOW_HALT_LEVEL_BYTES 96
+#define FLOW_RESUME_LEVEL_BYTES 32
+#define LOAD_SECONDS 1UL
+#define LOAD_WINDOW_BYTES 4096 // Written and not yet read back, per channel
+#define STALL_TIMEOUT_NS 2000000000ULL // No channel made progress for this long
+#define MAXIMUM_LOAD_CHANNELS ( 2 * HOST_SPI_MAX_DEVICES )
+
+typedef struct LOAD_CLIENT_t {
+   int fd ; // Slave side of the channel's PTY
+   uint64_t numBytesSent ;
+   uint64_t numBytesReceived ;
+   bool isCorrupted ;
+} LOAD_CLIENT ;
+
+typedef struct LOAD_RESULT_t {
+   uint64_t numBytes ;
+   uint64_t firstReceiveNs ;
+   uint64_t lastReceiveNs ;
+   uint32_t numOverruns ;
+   uint32_t numThrottles ;
+   bool isStalled ;
+} LOAD_RESULT ;
+
+static const uint8_t channelCounts [ ] = { 1, 2, 4, 8, 16, 32 } ;
+
+static UART_GATEWAY gateway ;
+static HOST_MAX3109_MODEL chips [ HOST_SPI_MAX_DEVICES ] ;
+static MAX3109_DEVICE devices [ HOST_SPI_MAX_DEVICES ] ;
+static LOAD_CLIENT clients [ MAXIMUM_LOAD_CHANNELS ] ;
+static uint8_t numLoopbackChannels ;
+static uint8_t loopbackBytesPerTick ;
+
+/* Every channel sends its own sequence, so a byte delivered to the wrong PTY or out of order shows up */
+static inline uint8_t SequenceByte ( const uint8_t channel, const uint64_t index )
+{
+   return ( uint8_t ) ( ( index * 31 ) + channel ) ;
+}
+
+static void AdvanceLoopback ( void * context )
+{
+   ( void ) context ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numLoopbackChannels ; counter++ )
+   {
+      HostMAX3109Loopback ( &chips [ counter / 2 ], ( counter & 0x01 ) ? UART_1 : UART_0, loopbackBytesPerTick ) ;
+   }
+}
+
+static void * GatewayThread ( void * context )
+{
+   ( void ) context ;
+   RunUARTGateway ( &gateway ) ;
+   return NULL ;
+}
+
+static uint8_t InitializeLoadChips ( const uint8_t numChips )
+{
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numChips ; counter++ )
+   {
+      if ( ( 0 == HostChipAttach ( &chips [ counter ], &devices [ counter ], counter ) ) ||
+           ( 0 == HostChipInitialize ( BAUD_RATE, &baudSettings ) ) ||
+           ( 0 == MAXConfigureFlowControl ( UART_0, FLOW_HALT_LEVEL_BYTES, FLOW_RESUME_LEVEL_BYTES, true, false ) ) ||
+           ( 0 == MAXConfigureFlowControl ( UART_1, FLOW_HALT_LEVEL_BYTES, FLOW_RESUME_LEVEL_BYTES, true, false ) ) )
+      {
+         return 0 ;
+      }
+   }
+   return 1 ;
+}
+
+/* Tops up the client's window with the next bytes of its sequence */
+static void SendToChannel ( LOAD_CLIENT * client, const uint8_t channel, const uint64_t numBytesToSend )
+{
+   uint8_t data [ LOAD_WINDOW_BYTES ] ;
+   uint64_t numBytes = LOAD_WINDOW_BYTES - ( client->numBytesSent - client->numBytesReceived ) ;
+   if ( numBytes > ( numBytesToSend - client->numBytesSent ) )
+   {
+      numBytes = numBytesToSend - client->numBytesSent ;
+   }
+
+   uint64_t counter ;
+   for ( counter = 0 ; counter < numBytes ; counter++ )
+   {
+      data [ counter ] = SequenceByte ( channel, client->numBytesSent + counter ) ;
+   }
+   ssize_t numBytesWritten = write ( client->fd, data, ( size_t ) numBytes ) ;
+   if ( numBytesWritten > 0 )
+   {
+      client->numBytesSent += ( uint64_t ) numBytesWritten ;
+   }
+}
+
+static uint64_t ReceiveFromChannel ( LOAD_CLIENT * client, const uint8_t channel )
+{
+   uint8_t data [ LOAD_WINDOW_BYTES ] ;
+   ssize_t numBytesRead = read ( client->fd, data, sizeof ( data ) ) ;
+   if ( numBytesRead <= 0 )
+   {
+      return 0 ;
+   }
+
+   ssize_t counter ;
+   for ( counter = 0 ; counter < numBytesRead ; counter++ )
+   {
+      if ( data [ counter ] != SequenceByte ( channel, client->numBytesReceived + ( uint64_t ) counter ) )
+      {
+         client->isCorrupted = true ;
+      }
+   }
+   client->numBytesReceived += ( uint64_t ) numBytesRead ;
+   return ( uint64_t ) numBytesRead ;
+}
+
+/* Drives every channel until each has looped numBytesToSend back, or nothing moves for STALL_TIMEOUT_NS */
+static void DriveClients ( const uint8_t numChannels, const uint64_t numBytesToSend, LOAD_RESULT * result )
+{
+   struct pollfd pollFds [ MAXIMUM_LOAD_CHANNELS ] ;
+   uint64_t lastProgressNs = BenchWallTimeNs ( ) ;
+   while ( result->numBytes < ( numBytesToSend * numChannels ) )
+   {
+      uint8_t counter ;
+      for ( counter = 0 ; counter < numChannels ; counter++ )
+      {
+         LOAD_CLIENT * client = &clients [ counter ] ;
+         pollFds [ counter ].fd = client->fd ;
+         pollFds [ counter ].events = POLLIN ;
+         pollFds [ counter ].revents = 0 ;
+         if ( ( client->numBytesSent < numBytesToSend ) &&
+              ( ( client->numBytesSent - client->numBytesReceived ) < LOAD_WINDOW_BYTES ) )
+         {
+            pollFds [ counter ].events |= POLLOUT ;
+         }
+      }
+      if ( poll ( pollFds, numChannels, 10 ) < 0 )
+      {
+         if ( EINTR == errno )
+         {
+            continue ;
+         }
+         break ;
+      }
+
+      uint64_t now = BenchWallTimeNs ( ) ;
+      for ( counter = 0 ; counter < numChannels ; counter++ )
+      {
+         if ( pollFds [ counter ].revents & POLLIN )
+         {
+            uint64_t numBytesRead = ReceiveFromChannel ( &clients [ counter ], counter ) ;
+            if ( numBytesRead > 0 )
+            {
+               if ( 0 == result->numBytes )
+               {
+                  result->firstReceiveNs = now ;
+               }
+               result->numBytes += numBytesRead ;
+               result->lastReceiveNs = now ;
+               lastProgressNs = now ;
+            }
+         }
+         if ( pollFds [ counter ].revents & POLLOUT )
+         {
+            SendToChannel ( &clients [ counter ], counter, numBytesToSend ) ;
+         }
+      }
+      if ( ( now - lastProgressNs ) > STALL_TIMEOUT_NS )
+      {
+         result->isStalled = true ;
+         break ;
+      }
+   }
+}
+
+static void RunLoad ( const uint8_t numChannels, LOAD_RESULT * result )
+{
+   memset ( result, 0, sizeof ( *result ) ) ;
+   numLoopbackChannels = numChannels ;
+   loopbackBytesPerTick = ( uint8_t ) ( ( ( BAUD_RATE / BITS_PER_CHARACTER ) * SERVICE_PERIOD_US ) / 1000000UL ) ;
+
+   uint8_t numChips = ( uint8_t ) ( ( numChannels + 1 ) / 2 ) ;
+   MAX3109_DEVICE * channelDevices [ HOST_SPI_MAX_DEVICES ] ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numChips ; counter++ )
+   {
+      channelDevices [ counter ] = &devices [ counter ] ;
+   }
+   CHECK ( 1 == InitializeLoadChips ( numChips ) ) ;
+   CHECK ( 1 == InitializeUARTGateway ( &gateway, channelDevices, numChannels, HOST_CHIP_CRYSTAL_HZ, SERVICE_PERIOD_US ) ) ;
+   gateway.onServiceTick = AdvanceLoopback ;
+
+   for ( counter = 0 ; counter < numChannels ; counter++ )
+   {
+      memset ( &clients [ counter ], 0, sizeof ( clients [ counter ] ) ) ;
+      clients [ counter ].fd = open ( gateway.channels [ counter ].ptyName, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC ) ;
+      CHECK ( clients [ counter ].fd >= 0 ) ;
+   }
+
+   pthread_t gatewayThread ;
+   CHECK ( 0 == pthread_create ( &gatewayThread, NULL, GatewayThread, NULL ) ) ;
+   DriveClients ( numChannels, ( BAUD_RATE / BITS_PER_CHARACTER ) * LOAD_SECONDS, result ) ;
+   StopUARTGateway ( &gateway ) ;
+   pthread_join ( gatewayThread, NULL ) ;
+
+   for ( counter = 0 ; counter < numChannels ; counter++ )
+   {
+      CHECK ( false == clients [ counter ].isCorrupted ) ;
+      result->numOverruns += chips [ counter / 2 ].channels [ counter & 0x01 ].rxOverruns ;
+      result->numThrottles += gateway.channels [ counter ].rxBlocks.numThrottles ;
+      close ( clients [ counter ].fd ) ;
+   }
+   CloseUARTGateway ( &gateway ) ;
+}
+
+int main ( void )
+{
+   printf ( "%lu baud 8N1 per channel, %lu us service period, %lu s of line time per channel, %u bytes in flight\n",
+            BAUD_RATE, SERVICE_PERIOD_US, LOAD_SECONDS, LOAD_WINDOW_BYTES ) ;
+   printf ( "%8s %10s %12s %12s %8s | %10s %10s %10s | %9s %9s\n", "channels", "bytes", "bytes/s", "per channel",
+            "of line", "p50 us", "p99 us", "max us", "overruns", "throttles" ) ;
+
+   uint8_t index ;
+   for ( index = 0 ; index < ( sizeof ( channelCounts ) / sizeof ( channelCounts [ 0 ] ) ) ; index++ )
+   {
+      uint8_t numChannels = channelCounts [ index ] ;
+      LOAD_RESULT result ;
+      RunLoad ( numChannels, &result ) ;
+
+      /* The rate is taken over the time bytes were coming back, not the setup around it */
+      UART_LATENCY_SUMMARY latency ;
+      GetUARTLatencySummary ( &gateway.rxLatency, &latency ) ;
+      double receiveSeconds = ( double ) ( result.lastReceiveNs - result.firstReceiveNs ) / 1e9 ;
+      double bytesPerSecond = ( receiveSeconds > 0.0 ) ? ( ( double ) result.numBytes / receiveSeconds ) : 0.0 ;
+      double lineBytesPerSecond = ( double ) numChannels * ( BAUD_RATE / BITS_PER_CHARACTER ) ;
+      printf ( "%8u %10llu %12.0f %12.0f %7.1f%% | %10lu %10lu %10lu | %9lu %9lu%s\n", numChannels,
+               ( unsigned long long ) result.numBytes, bytesPerSecond, bytesPerSecond / numChannels,
+               ( 100.0 * bytesPerSecond ) / lineBytesPerSecond, ( unsigned long ) latency.p50,
+               ( unsigned long ) latency.p99, ( unsigned long ) latency.max, ( unsigned long ) result.numOverruns,
+               ( unsigned long ) result.numThrottles, ( result.isStalled ) ? " STALLED" : "" ) ;
+
+      CHECK ( false == result.isStalled ) ;
+      CHECK ( 0 == result.numOverruns ) ;
+      CHECK ( ( ( BAUD_RATE / BITS_PER_CHARACTER ) * LOAD_SECONDS * numChannels ) == result.numBytes ) ;
+   }
+
+   return TestVerdict ( "gatewayLoadTest" ) ;
+}
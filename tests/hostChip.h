@@ -0,0 +1,40 @@
+/*
+ File: MAX3109 bring up on the host model, shared by the host tests and benchmarks
+ Author: Henry Gilbert
+ */
+
+#ifndef HOST_CHIP_H
+#define HOST_CHIP_H
+
+#include "hostSPI.h"
+#include <string.h>
+
+#define HOST_CHIP_CRYSTAL_HZ 3686400UL
+#define HOST_CHIP_LINE_CONFIG_8N1 0x03
+
+/* Powers the model up on chipSelectLine and selects a device for it with empty shadow registers */
+static inline uint8_t HostChipAttach ( HOST_MAX3109_MODEL * model, MAX3109_DEVICE * device, const uint8_t chipSelectLine )
+{
+   HostMAX3109ModelReset ( model ) ;
+   memset ( device, 0, sizeof ( *device ) ) ;
+   device->transport = &hostSPITransport ;
+   device->chipSelectLine = chipSelectLine ;
+   MAXSelectDevice ( device ) ;
+   return ( 0 == HostSPIAttachModel ( chipSelectLine, model ) ) ? 1 : 0 ;
+}
+
+/* Sets the selected chip up like a board chip: clock from HOST_CHIP_CRYSTAL_HZ, both UARTs 8N1 at baudRate. The
+ solved settings are returned for a caller that goes on to give a UART its own divisor. Returns 1 on success. */
+static inline uint8_t HostChipInitialize ( const uint32_t baudRate, MAX3109_BAUD_SETTINGS * baudSettings )
+{
+   if ( ( 0 == MAXSolveBaudRate ( HOST_CHIP_CRYSTAL_HZ, false, baudRate, baudSettings ) ) ||
+        ( 0 == MAXInitializeMAX3109 ( baudSettings->pllConfig, baudSettings->clockSource, HOST_CHIP_LINE_CONFIG_8N1 ) ) ||
+        ( 0 == MAXConfigureBaudRate ( UART_0, baudSettings ) ) ||
+        ( 0 == MAXConfigureBaudRate ( UART_1, baudSettings ) ) )
+   {
+      return 0 ;
+   }
+   return 1 ;
+}
+
+#endif
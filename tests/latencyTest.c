@@ -0,0 +1,185 @@
+/*
+ File: Host test for the receive latency histograms and rx block byte timestamps
+ Author: Henry Gilbert
+
+ Checks the histogram bucket edges and that every bucket bound is within 25% of the values it holds, the rank rounding
+ of the percentiles, the back dating of block timestamps by RxFIFO position on the host model, the interpolation of
+ byte times between them, and that recording a block gives the same histogram as recording each interpolated byte.
+ */
+
+#include "UARTLatency.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CHARACTER_TIME 87 // Clock ticks per character, 115200 baud on a 1 MHz clock
+#define FIRST_DRAIN_TIME 100000UL
+#define SECOND_DRAIN_TIME 103000UL
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static UART_LATENCY_HISTOGRAM histogram ;
+
+/* The bound reported for a latency, read back as the lowest percentile against a sample too large to clamp it */
+static uint32_t BucketBound ( const uint32_t latency )
+{
+   ResetUARTLatencyHistogram ( &histogram ) ;
+   RecordUARTLatency ( &histogram, latency ) ;
+   RecordUARTLatency ( &histogram, 0xFFFFFFFFUL ) ;
+   return GetUARTLatencyPercentile ( &histogram, 0 ) ;
+}
+
+static void TestBucketEdges ( void )
+{
+   uint32_t latency ;
+   for ( latency = 0 ; latency < 8 ; latency++ )
+   {
+      CHECK ( latency == BucketBound ( latency ) ) ; // One bucket per value below 8
+   }
+   CHECK ( 9 == BucketBound ( 8 ) ) ;
+   CHECK ( 9 == BucketBound ( 9 ) ) ;
+   CHECK ( 11 == BucketBound ( 10 ) ) ;
+   CHECK ( 15 == BucketBound ( 14 ) ) ;
+   CHECK ( 19 == BucketBound ( 16 ) ) ;
+   CHECK ( 1023 == BucketBound ( 896 ) ) ;
+   CHECK ( 895 == BucketBound ( 895 ) ) ;
+   CHECK ( 0xFFFFFFFFUL == BucketBound ( 0xE0000000UL ) ) ;
+   CHECK ( 0xDFFFFFFFUL == BucketBound ( 0xDFFFFFFFUL ) ) ;
+
+   /* Every bound is at or above its value and within a quarter of it, over the whole clock range */
+   uint8_t highestBit ;
+   for ( highestBit = 2 ; highestBit < 32 ; highestBit++ )
+   {
+      uint32_t powerOfTwo = 1UL << highestBit ;
+      const uint32_t samples [ ] = { powerOfTwo, powerOfTwo + 1, powerOfTwo + ( powerOfTwo / 3 ), ( powerOfTwo - 1 ) * 2 + 1 } ;
+      uint8_t sample ;
+      for ( sample = 0 ; sample < sizeof ( samples ) / sizeof ( samples [ 0 ] ) ; sample++ )
+      {
+         uint32_t bound = BucketBound ( samples [ sample ] ) ;
+         CHECK ( ( bound >= samples [ sample ] ) && ( ( bound - samples [ sample ] ) <= ( samples [ sample ] / 4 ) ) ) ;
+      }
+   }
+}
+
+static void TestPercentileRanks ( void )
+{
+   ResetUARTLatencyHistogram ( &histogram ) ;
+   CHECK ( 0 == GetUARTLatencyPercentile ( &histogram, 500 ) ) ;
+
+   RecordUARTLatency ( &histogram, 1 ) ;
+   RecordUARTLatency ( &histogram, 2 ) ;
+   RecordUARTLatency ( &histogram, 3 ) ;
+   CHECK ( 1 == GetUARTLatencyPercentile ( &histogram, 0 ) ) ; // Rank 0 is taken as the first sample
+   CHECK ( 2 == GetUARTLatencyPercentile ( &histogram, 500 ) ) ; // Rank 1.5 rounds up to 2
+   CHECK ( 3 == GetUARTLatencyPercentile ( &histogram, 990 ) ) ;
+   CHECK ( 3 == GetUARTLatencyPercentile ( &histogram, 1000 ) ) ;
+
+   /* 101 samples: p99 is rank 99.99, rounded up to the 100th sample - truncating would report the 99th */
+   ResetUARTLatencyHistogram ( &histogram ) ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < 99 ; counter++ )
+   {
+      RecordUARTLatency ( &histogram, 1 ) ;
+   }
+   RecordUARTLatency ( &histogram, 6 ) ;
+   RecordUARTLatency ( &histogram, 7 ) ;
+   UART_LATENCY_SUMMARY summary ;
+   GetUARTLatencySummary ( &histogram, &summary ) ;
+   CHECK ( 1 == summary.p50 ) ;
+   CHECK ( 6 == summary.p99 ) ;
+   CHECK ( 7 == summary.max ) ;
+   CHECK ( 101 == summary.numSamples ) ;
+
+   /* A bound past the largest sample is clamped to it */
+   ResetUARTLatencyHistogram ( &histogram ) ;
+   RecordUARTLatency ( &histogram, 1000 ) ;
+   CHECK ( 1000 == GetUARTLatencyPercentile ( &histogram, 500 ) ) ;
+}
+
+/* Each drain dates the first byte of a block back by the bytes behind it in the RxFIFO, and the last byte taken by
+ the bytes left behind when the block fills */
+static void TestBlockTimestamps ( void )
+{
+   static UART_RX_BLOCK blocks [ 2 ] ;
+   static UART_RX_BLOCK_RING ring ;
+   static const uint8_t lineBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] = { 0 } ;
+   CHECK ( 1 == InitializeUARTRxBlockRing ( &ring, blocks, 2, 0 ) ) ;
+   SetUARTRxBlockCharacterTime ( &ring, CHARACTER_TIME ) ;
+
+   HostMAX3109InjectRx ( &model, UART_0, lineBytes, 100 ) ;
+   CHECK ( 100 == DrainUARTRxFIFOToBlocks ( UART_0, &ring, FIRST_DRAIN_TIME ) ) ;
+   const UART_RX_BLOCK * block = ring.activeBlock ;
+   CHECK ( ( FIRST_DRAIN_TIME - 99 * CHARACTER_TIME ) == block->timestamp ) ;
+   CHECK ( FIRST_DRAIN_TIME == block->lastTimestamp ) ;
+
+   /* 156 of the next 128 + 72 bytes fill the block, so its last byte had 44 behind it */
+   HostMAX3109InjectRx ( &model, UART_0, lineBytes, MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == DrainUARTRxFIFOToBlocks ( UART_0, &ring, SECOND_DRAIN_TIME ) ) ;
+   HostMAX3109InjectRx ( &model, UART_0, lineBytes, 72 ) ;
+   CHECK ( 72 == DrainUARTRxFIFOToBlocks ( UART_0, &ring, SECOND_DRAIN_TIME ) ) ;
+   UART_RX_BLOCK * fullBlock = GetUARTRxBlock ( &ring ) ;
+   CHECK ( NULL != fullBlock ) ;
+   if ( NULL == fullBlock )
+   {
+      return ;
+   }
+   CHECK ( UART_RX_BLOCK_SIZE == fullBlock->numBytes ) ;
+   CHECK ( ( FIRST_DRAIN_TIME - 99 * CHARACTER_TIME ) == fullBlock->timestamp ) ;
+   CHECK ( ( SECOND_DRAIN_TIME - 44 * CHARACTER_TIME ) == fullBlock->lastTimestamp ) ;
+   CHECK ( ( SECOND_DRAIN_TIME - 43 * CHARACTER_TIME ) == ring.activeBlock->timestamp ) ;
+
+   /* Byte times run from the first timestamp to the last, clamped past the end */
+   uint32_t span = fullBlock->lastTimestamp - fullBlock->timestamp ;
+   CHECK ( fullBlock->timestamp == UARTRxBlockByteTime ( fullBlock, 0 ) ) ;
+   CHECK ( ( fullBlock->timestamp + ( span * 100 ) / 255 ) == UARTRxBlockByteTime ( fullBlock, 100 ) ) ;
+   CHECK ( fullBlock->lastTimestamp == UARTRxBlockByteTime ( fullBlock, UART_RX_BLOCK_SIZE - 1 ) ) ;
+   CHECK ( fullBlock->lastTimestamp == UARTRxBlockByteTime ( fullBlock, UART_RX_BLOCK_SIZE + 10 ) ) ;
+   ReleaseUARTRxBlock ( &ring, fullBlock ) ;
+}
+
+/* Recording a block steps through its byte times without a divide per byte, and must land on the same buckets. The
+ last byte is read at once, so short spans give latencies in the exact buckets. */
+static void TestBlockRecordMatchesByteTimes ( void )
+{
+   static UART_RX_BLOCK block ;
+   static UART_LATENCY_HISTOGRAM expected ;
+   const uint16_t numBytes [ ] = { 0, 1, 2, 3, 100, UART_RX_BLOCK_SIZE } ;
+   const uint32_t spans [ ] = { 0, 1, 254, 256, 12345, 0x7FFFFFFFUL } ;
+   const uint32_t now = 0x100 ;
+   uint8_t sizeIndex ;
+   uint8_t spanIndex ;
+   for ( sizeIndex = 0 ; sizeIndex < sizeof ( numBytes ) / sizeof ( numBytes [ 0 ] ) ; sizeIndex++ )
+   {
+      for ( spanIndex = 0 ; spanIndex < sizeof ( spans ) / sizeof ( spans [ 0 ] ) ; spanIndex++ )
+      {
+         block.numBytes = numBytes [ sizeIndex ] ;
+         block.timestamp = now - spans [ spanIndex ] ; // Wraps for the longer spans, as a free running clock does
+         block.lastTimestamp = block.timestamp + spans [ spanIndex ] ;
+
+         ResetUARTLatencyHistogram ( &expected ) ;
+         uint16_t index ;
+         for ( index = 0 ; index < block.numBytes ; index++ )
+         {
+            RecordUARTLatency ( &expected, now - UARTRxBlockByteTime ( &block, index ) ) ;
+         }
+         ResetUARTLatencyHistogram ( &histogram ) ;
+         RecordUARTRxBlockLatency ( &histogram, &block, now ) ;
+         CHECK ( 0 == memcmp ( &expected, &histogram, sizeof ( histogram ) ) ) ;
+      }
+   }
+}
+
+int main ( void )
+{
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   CHECK ( 1 == HostChipAttach ( &model, &device, 0 ) ) ;
+   CHECK ( 1 == HostChipInitialize ( 115200UL, &baudSettings ) ) ;
+
+   TestBucketEdges ( ) ;
+   TestPercentileRanks ( ) ;
+   TestBlockTimestamps ( ) ;
+   TestBlockRecordMatchesByteTimes ( ) ;
+
+   return TestVerdict ( "latencyTest" ) ;
+}
@@ -0,0 +1,169 @@
+/*
+ File: Host test for the MAX3109 register configuration tables
+ Author: Henry Gilbert
+
+ Runs configuration tables against the host model and checks that neighbouring entries for consecutive registers go
+ out as one chip select burst, that the model auto increments the register address within a frame like the chip, and
+ that readback still catches a register that does not match. Also checks that the baud rate solver keeps the PLL input
+ inside the range of the chosen factor, and that divisor only settings leave the shared clock registers alone. Last,
+ reports the SPI frames of a board bring up against the one frame per register byte it took before register bursts.
+ */
+
+#include "hostChip.h"
+#include "testCheck.h"
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+
+/* UART_1 RxTimeOut..IrDA is an odd run - one burst. UART_0 FlowLvl..FIFOTrgLvl is an even run - a burst of one plus a
+ single. LCR stands alone. */
+static const MAX3109_REGISTER_CONFIG runTable [ ] = {
+   { UART_1, max3109_RxTimeOut, 0x11, 0xFF },
+   { UART_1, max3109_HDplxDelay, 0x22, 0xFF },
+   { UART_1, max3109_IrDA, 0x00, 0xFF },
+   { UART_0, max3109_FlowLvl, 0x41, 0xFF },
+   { UART_0, max3109_FIFOTrgLvl, 0x80, 0xFF },
+   { UART_0, max3109_LCR, 0x07, 0xFF }
+} ;
+#define RUN_TABLE_ENTRIES ( sizeof ( runTable ) / sizeof ( runTable [ 0 ] ) )
+#define RUN_TABLE_BURSTS 4
+#define RUN_TABLE_WORDS 5
+#define INIT_TRANSACTIONS 16 // 4 reset writes with nothing to read back, 4 default checks, 4 config writes and readbacks
+#define BAUD_TRANSACTIONS 8 // UART_0 PLLConfig to CLKSource, then UART_1 PLLConfig, BRGConfig to DIVMSB, CLKSource - each way
+#define BAUD_TRANSACTIONS_BEFORE_BURSTS 20 // Five registers per UART, each way
+
+static void TestBurstsPerRun ( void )
+{
+   HOST_SPI_STATS stats ;
+   HostSPIResetStats ( ) ;
+   CHECK ( 1 == MAXApplyRegisterConfiguration ( runTable, RUN_TABLE_ENTRIES ) ) ;
+   HostSPIGetStats ( &stats ) ;
+   CHECK ( ( 2 * RUN_TABLE_BURSTS ) == stats.transactions ) ; // Write pass, then readback pass
+   CHECK ( ( 2 * RUN_TABLE_WORDS ) == stats.words ) ;
+
+   uint8_t counter ;
+   for ( counter = 0 ; counter < RUN_TABLE_ENTRIES ; counter++ )
+   {
+      const MAX3109_REGISTER_CONFIG * entry = &runTable [ counter ] ;
+      CHECK ( entry->value == model.channels [ ( UART_1 == entry->channel ) ? 1 : 0 ].registers [ entry->maxRegister >> 8 ] ) ;
+   }
+}
+
+/* A register changed behind the driver's back fails the check, which only reads, so its retries cannot fix it. The
+ apply that follows writes the register again. */
+static void TestReadbackMismatch ( void )
+{
+   CHECK ( 1 == MAXCheckRegisterConfiguration ( runTable, RUN_TABLE_ENTRIES ) ) ;
+   model.channels [ 1 ].registers [ max3109_HDplxDelay >> 8 ] = 0x23 ;
+   CHECK ( 0 == MAXCheckRegisterConfiguration ( runTable, RUN_TABLE_ENTRIES ) ) ;
+   CHECK ( 1 == MAXApplyRegisterConfiguration ( runTable, RUN_TABLE_ENTRIES ) ) ;
+   CHECK ( 0x22 == model.channels [ 1 ].registers [ max3109_HDplxDelay >> 8 ] ) ;
+}
+
+/* Each data byte of a register burst goes to the next address, on reads and writes */
+static void TestModelAutoIncrement ( void )
+{
+   uint16_t words [ 2 ] = { 0x8000 | UART_1 | max3109_RxTimeOut | 0x31, 0x3233 } ;
+   SPIreadWriteBuffer ( words, NULL, 2 ) ;
+   CHECK ( 0x31 == model.channels [ 1 ].registers [ max3109_RxTimeOut >> 8 ] ) ;
+   CHECK ( 0x32 == model.channels [ 1 ].registers [ max3109_HDplxDelay >> 8 ] ) ;
+   CHECK ( 0x33 == model.channels [ 1 ].registers [ max3109_IrDA >> 8 ] ) ;
+
+   words [ 0 ] = UART_1 | max3109_RxTimeOut ;
+   words [ 1 ] = 0 ;
+   SPIreadWriteBuffer ( words, words, 2 ) ;
+   CHECK ( 0x31 == ( words [ 0 ] & 0xFF ) ) ;
+   CHECK ( 0x3233 == words [ 1 ] ) ;
+}
+
+/* PLL input limits per factor code (6, 48, 96, 144), from the data sheet */
+static void TestSolvedPLLInput ( void )
+{
+   static const uint32_t minimumHz [ 4 ] = { 500000UL, 850000UL, 425000UL, 390000UL } ;
+   static const uint32_t maximumHz [ 4 ] = { 800000UL, 1200000UL, 1000000UL, 667000UL } ;
+   static const uint32_t clocks [ ] = { 1843200UL, 3686400UL, 4000000UL, 7372800UL, 16000000UL } ;
+   static const uint32_t bauds [ ] = { 9600UL, 115200UL, 230400UL, 921600UL, 1000000UL, 3000000UL } ;
+   uint8_t clockIndex ;
+   uint8_t baudIndex ;
+   for ( clockIndex = 0 ; clockIndex < ( sizeof ( clocks ) / sizeof ( clocks [ 0 ] ) ) ; clockIndex++ )
+   {
+      for ( baudIndex = 0 ; baudIndex < ( sizeof ( bauds ) / sizeof ( bauds [ 0 ] ) ) ; baudIndex++ )
+      {
+         MAX3109_BAUD_SETTINGS settings ;
+         CHECK ( 1 == MAXSolveBaudRate ( clocks [ clockIndex ], false, bauds [ baudIndex ], &settings ) ) ;
+         CHECK ( settings.isClockIncluded ) ;
+         if ( settings.clockSource & MAX3109_CLKSOURCE_PLL_ENABLE )
+         {
+            uint8_t factorCode = settings.pllConfig >> MAX3109_PLLCONFIG_FACTOR_SHIFT ;
+            uint32_t pllInputHz = clocks [ clockIndex ] / ( settings.pllConfig & MAX3109_PLLCONFIG_PREDIV_MASK ) ;
+            CHECK ( ( pllInputHz >= minimumHz [ factorCode ] ) && ( pllInputHz <= maximumHz [ factorCode ] ) ) ;
+         }
+      }
+   }
+}
+
+/* The second UART takes a divisor for the first UART's fREF - writing it must not touch PLLConfig or CLKSource */
+static void TestDivisorOnlySettings ( void )
+{
+   MAX3109_BAUD_SETTINGS clockSettings ;
+   MAX3109_BAUD_SETTINGS divisorSettings ;
+   CHECK ( 1 == MAXSolveBaudRate ( 3686400UL, false, 921600UL, &clockSettings ) ) ;
+   CHECK ( 1 == MAXConfigureBaudRate ( UART_0, &clockSettings ) ) ;
+
+   divisorSettings.clockSource = 0 ; // Nonsense clock fields that must never reach the chip
+   divisorSettings.pllConfig = 0 ;
+   CHECK ( 1 == MAXSolveBaudDivisor ( clockSettings.referenceHz, 9600UL, &divisorSettings ) ) ;
+   CHECK ( false == divisorSettings.isClockIncluded ) ;
+
+   HOST_SPI_STATS stats ;
+   HostSPIResetStats ( ) ;
+   CHECK ( 1 == MAXConfigureBaudRate ( UART_1, &divisorSettings ) ) ;
+   HostSPIGetStats ( &stats ) ;
+   CHECK ( 2 == stats.transactions ) ; // BRGConfig to DIVMSB is one burst each way
+   CHECK ( clockSettings.pllConfig == model.channels [ 0 ].registers [ max3109_PLLConfig >> 8 ] ) ;
+   CHECK ( clockSettings.clockSource == model.channels [ 0 ].registers [ max3109CLKSource >> 8 ] ) ;
+   CHECK ( divisorSettings.divLSB == model.channels [ 1 ].registers [ max3109_DIVLSB >> 8 ] ) ;
+}
+
+/* Board bring up: MAXInitializeMAX3109, then the baud rate of each UART. Without register bursts every register byte
+ was its own chip select frame of one word, so registerBytes is the frame and word count before bursting. */
+static void TestInitTransactions ( void )
+{
+   HOST_SPI_STATS initStats ;
+   HOST_SPI_STATS baudStats ;
+   MAX3109_BAUD_SETTINGS settings ;
+   CHECK ( 1 == MAXSolveBaudRate ( HOST_CHIP_CRYSTAL_HZ, false, 115200UL, &settings ) ) ;
+   HostSPIResetStats ( ) ;
+   CHECK ( 1 == MAXInitializeMAX3109 ( settings.pllConfig, settings.clockSource, HOST_CHIP_LINE_CONFIG_8N1 ) ) ;
+   HostSPIGetStats ( &initStats ) ;
+   HostSPIResetStats ( ) ;
+   CHECK ( 1 == MAXConfigureBaudRate ( UART_0, &settings ) ) ;
+   CHECK ( 1 == MAXConfigureBaudRate ( UART_1, &settings ) ) ;
+   HostSPIGetStats ( &baudStats ) ;
+
+   printf ( "MAXInitializeMAX3109: %lu frames %lu words, %lu frames of one word before bursts\n",
+            ( unsigned long ) initStats.transactions, ( unsigned long ) initStats.words,
+            ( unsigned long ) initStats.registerBytes ) ;
+   printf ( "MAXConfigureBaudRate on both UARTs: %lu frames %lu words, %lu frames of one word before bursts\n",
+            ( unsigned long ) baudStats.transactions, ( unsigned long ) baudStats.words,
+            ( unsigned long ) baudStats.registerBytes ) ;
+
+   CHECK ( INIT_TRANSACTIONS == initStats.transactions ) ;
+   CHECK ( initStats.registerBytes == initStats.transactions ) ; // No neighbouring registers in the init tables
+   CHECK ( BAUD_TRANSACTIONS == baudStats.transactions ) ;
+   CHECK ( BAUD_TRANSACTIONS_BEFORE_BURSTS == baudStats.registerBytes ) ;
+}
+
+int main ( void )
+{
+   HostChipAttach ( &model, &device, 0 ) ;
+
+   TestBurstsPerRun ( ) ;
+   TestReadbackMismatch ( ) ;
+   TestModelAutoIncrement ( ) ;
+   TestSolvedPLLInput ( ) ;
+   TestDivisorOnlySettings ( ) ;
+   TestInitTransactions ( ) ;
+
+   return TestVerdict ( "maxConfigTest" ) ;
+}
@@ -0,0 +1,146 @@
+/*
+ File: Host test for the MAX3109 hot path instrumentation - built with MAX3109_ENABLE_STATS
+ Author: Henry Gilbert
+
+ Drives receive bursts, transmit bursts and a configuration table through the driver on the host model, then checks
+ that the per call site SPI counts add up to the frames and words the host transport actually clocked, and that the
+ byte counts, FIFO high water marks, deferred bytes and cycle histograms hold what the traffic should produce.
+ Finally checks that a snapshot is a copy and that a reset clears every counter.
+ */
+
+#include "SPItoUART.h"
+#include "MAX3109Stats.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef MAX3109_ENABLE_STATS
+#error "maxStatsTest needs MAX3109_ENABLE_STATS - see tests/Makefile"
+#endif
+
+#define CYCLES_PER_COUNT 100 // Every read of the fake cycle counter moves it on this far
+#define CYCLE_BUCKET 6 // 100 cycles falls in 64 to 127
+#define BUF_SIZE 512 // A power of two
+#define FIRST_RX_BYTES 40
+#define SECOND_RX_BYTES 100
+#define TX_BYTES 200
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static uint32_t fakeCycles ;
+
+/* One call site's worth of register traffic - LCR of each UART, so no burst forms */
+static const MAX3109_REGISTER_CONFIG lineTable [ ] = {
+   { UART_0, max3109_LCR, 0x03, 0xFF },
+   { UART_1, max3109_LCR, 0x03, 0xFF }
+} ;
+
+static uint32_t FakeCycleCounter ( void )
+{
+   fakeCycles += CYCLES_PER_COUNT ;
+   return fakeCycles ;
+}
+
+static void InjectBytes ( const MAX3109_UART_SELECTION channel, const uint8_t numBytes )
+{
+   static const uint8_t lineBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] = { 0 } ;
+   HostMAX3109InjectRx ( &model, channel, lineBytes, numBytes ) ;
+}
+
+/* Every SPI frame leaves the driver through one of the instrumented call sites */
+static void CheckCallSiteTotals ( const MAX3109_STATS * stats )
+{
+   HOST_SPI_STATS spiStats ;
+   HostSPIGetStats ( &spiStats ) ;
+   uint32_t numTransactions = 0 ;
+   uint32_t numWords = 0 ;
+   uint8_t site ;
+   for ( site = 0 ; site < NUM_STATS_CALL_SITES ; site++ )
+   {
+      numTransactions += stats->callSites [ site ].transactions ;
+      numWords += stats->callSites [ site ].words ;
+   }
+   printf ( "call sites: %lu frames %lu words, host transport: %lu frames %lu words\n", ( unsigned long ) numTransactions,
+            ( unsigned long ) numWords, ( unsigned long ) spiStats.transactions, ( unsigned long ) spiStats.words ) ;
+   CHECK ( spiStats.transactions == numTransactions ) ;
+   CHECK ( spiStats.words == numWords ) ;
+   CHECK ( 0 < stats->callSites [ statsSite_RegisterRead ].transactions ) ;
+   CHECK ( 3 == stats->callSites [ statsSite_RxBurst ].transactions ) ;
+   CHECK ( 1 == stats->callSites [ statsSite_TxBurst ].transactions ) ;
+   CHECK ( 4 == stats->callSites [ statsSite_ConfigBatch ].transactions ) ; // Each entry written, then read back
+}
+
+int main ( void )
+{
+   circBuffer_t rxBuf ;
+   circBuffer_t txBuf ;
+   static uint8_t rxStorage [ BUF_SIZE ] ;
+   static uint8_t txStorage [ BUF_SIZE ] ;
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   CHECK ( 1 == HostChipAttach ( &model, &device, 0 ) ) ;
+   CHECK ( 1 == HostChipInitialize ( 115200UL, &baudSettings ) ) ;
+   cb_init ( &rxBuf, rxStorage, BUF_SIZE ) ;
+   cb_init ( &txBuf, txStorage, BUF_SIZE ) ;
+
+   MAXStatsSetCycleCounter ( FakeCycleCounter ) ;
+   MAXStatsReset ( ) ;
+   HostSPIResetStats ( ) ;
+
+   /* UART_0 peaks at SECOND_RX_BYTES, UART_1 is read full */
+   InjectBytes ( UART_0, FIRST_RX_BYTES ) ;
+   CHECK ( FIRST_RX_BYTES == ReadDataFromUARTBuffer ( UART_0, &rxBuf ) ) ;
+   InjectBytes ( UART_0, SECOND_RX_BYTES ) ;
+   CHECK ( SECOND_RX_BYTES == ReadDataFromUARTBuffer ( UART_0, &rxBuf ) ) ;
+   InjectBytes ( UART_1, MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == ReadDataFromUARTBuffer ( UART_1, &rxBuf ) ) ;
+
+   /* The first write fills the empty TxFIFO, the second finds it full and defers everything */
+   uint16_t counter ;
+   for ( counter = 0 ; counter < TX_BYTES ; counter++ )
+   {
+      cb_push ( &txBuf, ( uint8_t ) counter ) ;
+   }
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == WriteDataToUARTTransmitBuffer ( UART_0, &txBuf, TX_BYTES ) ) ;
+   uint8_t numBytesLeft = ( uint8_t ) cb_count ( &txBuf ) ;
+   CHECK ( 0 == WriteDataToUARTTransmitBuffer ( UART_0, &txBuf, numBytesLeft ) ) ;
+
+   CHECK ( 1 == MAXApplyRegisterConfiguration ( lineTable, sizeof ( lineTable ) / sizeof ( lineTable [ 0 ] ) ) ) ;
+
+   MAX3109_STATS stats ;
+   MAXStatsSnapshot ( &stats ) ;
+   CheckCallSiteTotals ( &stats ) ;
+
+   CHECK ( ( FIRST_RX_BYTES + SECOND_RX_BYTES ) == stats.channels [ 0 ].rxBytes ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == stats.channels [ 1 ].rxBytes ) ;
+   CHECK ( SECOND_RX_BYTES == stats.channels [ 0 ].rxFIFOHighWater ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == stats.channels [ 1 ].rxFIFOHighWater ) ;
+   CHECK ( 0 == stats.channels [ 0 ].rxFIFOFullEvents ) ;
+   CHECK ( 1 == stats.channels [ 1 ].rxFIFOFullEvents ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == stats.channels [ 0 ].txBytes ) ;
+   CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == stats.channels [ 0 ].txFIFOHighWater ) ;
+   CHECK ( ( 2U * numBytesLeft ) == stats.channels [ 0 ].txBytesDeferred ) ;
+   CHECK ( 0 == stats.channels [ 0 ].fifoLevelErrors ) ;
+
+   CHECK ( 3 == stats.readCycles.numCalls ) ;
+   CHECK ( 3 == stats.readCycles.buckets [ CYCLE_BUCKET ] ) ;
+   CHECK ( CYCLES_PER_COUNT == stats.readCycles.maxCycles ) ;
+   CHECK ( 2 == stats.writeCycles.numCalls ) ;
+   CHECK ( 2 == stats.writeCycles.buckets [ CYCLE_BUCKET ] ) ;
+
+   /* The snapshot keeps its values while the live counters move on, and reset clears them all */
+   InjectBytes ( UART_0, FIRST_RX_BYTES ) ;
+   ReadDataFromUARTBuffer ( UART_0, &rxBuf ) ;
+   CHECK ( ( FIRST_RX_BYTES + SECOND_RX_BYTES ) == stats.channels [ 0 ].rxBytes ) ;
+   MAX3109_STATS liveStats ;
+   MAXStatsSnapshot ( &liveStats ) ;
+   CHECK ( ( 2 * FIRST_RX_BYTES + SECOND_RX_BYTES ) == liveStats.channels [ 0 ].rxBytes ) ;
+
+   MAX3109_STATS zeroStats ;
+   memset ( &zeroStats, 0, sizeof ( zeroStats ) ) ;
+   MAXStatsReset ( ) ;
+   MAXStatsSnapshot ( &liveStats ) ;
+   CHECK ( 0 == memcmp ( &zeroStats, &liveStats, sizeof ( liveStats ) ) ) ;
+
+   return TestVerdict ( "maxStatsTest" ) ;
+}
@@ -0,0 +1,127 @@
+// Scaling of mpmcQueue against a mutex wrapped RingQueue - the lock the gateway threads used before - at 1 to N
+// producers and as many consumers. N is twice the number of online CPUs, at least 4.
+
+#include "mpmcQueue.h"
+#include "ringQueue.h"
+#include "benchClock.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define CAPACITY 1024
+#define VALUES_PER_PRODUCER 1000000UL
+#define MAXIMUM_THREADS 64
+
+static MpmcQueue mpmc;
+static MpmcSlot mpmcStorage[CAPACITY];
+static RingQueue locked;
+static uint32_t lockedStorage[CAPACITY];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic size_t numPopped;
+static size_t totalValues;
+static bool isMutexRun;
+
+static bool push(uint32_t value)
+{
+	if (!isMutexRun)
+	{
+		return mq_push(&mpmc, value);
+	}
+	pthread_mutex_lock(&lock);
+	bool isPushed = rq_push(&locked, value);
+	pthread_mutex_unlock(&lock);
+	return isPushed;
+}
+
+static bool pop(uint32_t* value)
+{
+	if (!isMutexRun)
+	{
+		return mq_pop(&mpmc, value);
+	}
+	pthread_mutex_lock(&lock);
+	bool isPopped = rq_pop(&locked, value);
+	pthread_mutex_unlock(&lock);
+	return isPopped;
+}
+
+static void* producer(void* arg)
+{
+	(void)arg;
+	uint32_t value = 0;
+	while (value < VALUES_PER_PRODUCER)
+	{
+		if (push(value))
+		{
+			value++;
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void* consumer(void* arg)
+{
+	(void)arg;
+	uint32_t value;
+	while (atomic_load_explicit(&numPopped, memory_order_relaxed) < totalValues)
+	{
+		if (pop(&value))
+		{
+			atomic_fetch_add_explicit(&numPopped, 1, memory_order_relaxed);
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static double run(size_t numThreadsEachSide, bool isMutex)
+{
+	pthread_t threads[2 * MAXIMUM_THREADS];
+	size_t index;
+	isMutexRun = isMutex;
+	mq_init(&mpmc, mpmcStorage, CAPACITY);
+	rq_init(&locked, lockedStorage, CAPACITY);
+	totalValues = numThreadsEachSide * VALUES_PER_PRODUCER;
+	atomic_store(&numPopped, 0);
+
+	uint64_t start = BenchWallTimeNs();
+	for (index = 0; index < numThreadsEachSide; index++)
+	{
+		pthread_create(&threads[index], NULL, consumer, NULL);
+		pthread_create(&threads[numThreadsEachSide + index], NULL, producer, NULL);
+	}
+	for (index = 0; index < 2 * numThreadsEachSide; index++)
+	{
+		pthread_join(threads[index], NULL);
+	}
+	return ((double)totalValues * 1e3) / (double)(BenchWallTimeNs() - start);
+}
+
+int main(void)
+{
+	long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t maximumThreads = (numCPUs > 2) ? (size_t)(2 * numCPUs) : 4;
+	if (maximumThreads > MAXIMUM_THREADS)
+	{
+		maximumThreads = MAXIMUM_THREADS;
+	}
+
+	printf("mpmcQueueBench: %ld CPUs, %lu values per producer, capacity %u\n", numCPUs, VALUES_PER_PRODUCER, CAPACITY);
+	printf("  producers+consumers   mpmcQueue M values/s   mutex RingQueue M values/s\n");
+	size_t numThreads;
+	for (numThreads = 1; numThreads <= maximumThreads; numThreads *= 2)
+	{
+		double lockFree = run(numThreads, false);
+		double mutex = run(numThreads, true);
+		printf("  %4zu + %-4zu           %10.2f             %10.2f\n", numThreads, numThreads, lockFree, mutex);
+	}
+	return 0;
+}
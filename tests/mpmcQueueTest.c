@@ -0,0 +1,136 @@
+// pthread stress test for mpmcQueue: several producers and consumers share one small queue, so slots are reused on
+// every lap while other threads are mid claim. Each value carries its producer and a per-producer sequence number.
+// Every value must arrive exactly once, and any one consumer must see each producer's values in increasing order.
+
+#include "mpmcQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CAPACITY 16 // Small, so the ring wraps constantly
+#define VALUES_PER_PRODUCER 200000UL
+#define PRODUCER_SHIFT 24
+
+static MpmcQueue queue;
+static MpmcSlot storage[CAPACITY];
+static _Atomic size_t numPopped;
+static size_t totalValues;
+static _Atomic uint8_t* seen; // One flag per value, set by the consumer that popped it
+static _Atomic uint32_t duplicates;
+static _Atomic uint32_t outOfOrder;
+
+typedef struct ConsumerState_t
+{
+	uint32_t lastSequence[8]; // Per producer, + 1 so 0 means nothing seen yet
+	size_t numProducers;
+} ConsumerState;
+
+static void* producer(void* arg)
+{
+	uint32_t producerId = (uint32_t)(uintptr_t)arg;
+	uint32_t sequence = 0;
+	while (sequence < VALUES_PER_PRODUCER)
+	{
+		if (mq_push(&queue, (producerId << PRODUCER_SHIFT) | sequence))
+		{
+			sequence++;
+		}
+		else
+		{
+			sched_yield(); // full
+		}
+	}
+	return NULL;
+}
+
+static void* consumer(void* arg)
+{
+	ConsumerState* state = (ConsumerState*)arg;
+	uint32_t value;
+	while (atomic_load(&numPopped) < totalValues)
+	{
+		if (!mq_pop(&queue, &value))
+		{
+			sched_yield(); // empty
+			continue;
+		}
+		atomic_fetch_add(&numPopped, 1);
+
+		uint32_t producerId = value >> PRODUCER_SHIFT;
+		uint32_t sequence = value & ((1UL << PRODUCER_SHIFT) - 1);
+		if ((producerId >= state->numProducers) || (sequence >= VALUES_PER_PRODUCER))
+		{
+			atomic_fetch_add(&outOfOrder, 1); // corrupt value
+			continue;
+		}
+		if (sequence + 1 <= state->lastSequence[producerId])
+		{
+			atomic_fetch_add(&outOfOrder, 1);
+		}
+		state->lastSequence[producerId] = sequence + 1;
+		if (0 != atomic_exchange(&seen[(producerId * VALUES_PER_PRODUCER) + sequence], 1))
+		{
+			atomic_fetch_add(&duplicates, 1);
+		}
+	}
+	return NULL;
+}
+
+static int runStress(size_t numProducers, size_t numConsumers)
+{
+	pthread_t threads[16];
+	ConsumerState states[8] = { 0 };
+	size_t index;
+
+	mq_init(&queue, storage, CAPACITY);
+	totalValues = numProducers * VALUES_PER_PRODUCER;
+	seen = calloc(totalValues, sizeof(*seen));
+	atomic_store(&numPopped, 0);
+	atomic_store(&duplicates, 0);
+	atomic_store(&outOfOrder, 0);
+
+	for (index = 0; index < numConsumers; index++)
+	{
+		states[index].numProducers = numProducers;
+		pthread_create(&threads[index], NULL, consumer, &states[index]);
+	}
+	for (index = 0; index < numProducers; index++)
+	{
+		pthread_create(&threads[numConsumers + index], NULL, producer, (void*)(uintptr_t)index);
+	}
+	for (index = 0; index < numConsumers + numProducers; index++)
+	{
+		pthread_join(threads[index], NULL);
+	}
+
+	size_t numMissing = 0;
+	for (index = 0; index < totalValues; index++)
+	{
+		numMissing += (0 == atomic_load(&seen[index])) ? 1 : 0;
+	}
+	free((void*)seen);
+
+	bool isPass = (0 == numMissing) && (0 == atomic_load(&duplicates)) && (0 == atomic_load(&outOfOrder)) &&
+		(0 == mq_numMsgsInQueue(&queue));
+	printf("  %zu producers, %zu consumers: %zu values, %zu missing, %u duplicate, %u out of order - %s\n",
+		numProducers, numConsumers, totalValues, numMissing, (unsigned)atomic_load(&duplicates),
+		(unsigned)atomic_load(&outOfOrder), isPass ? "pass" : "FAIL");
+	return isPass ? 0 : 1;
+}
+
+int main(void)
+{
+	int failures = 0;
+	MpmcQueue invalid;
+	failures += mq_init(&invalid, storage, 12) ? 1 : 0; // not a power of two
+
+	printf("mpmcQueueTest:\n");
+	failures += runStress(1, 1);
+	failures += runStress(4, 1);
+	failures += runStress(1, 4);
+	failures += runStress(4, 4);
+	failures += runStress(8, 8);
+	printf("mpmcQueueTest: %s\n", (0 == failures) ? "pass" : "FAIL");
+	return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// Bytes per cycle of nmeaFramer on a 1 Hz GPS burst fed in RxFIFO sized chunks, against the per byte cb_peek scan
+// the application code did over the rx circular buffer. Cycles are time stamp counter cycles where the host has one.
+
+#include "nmeaFramer.h"
+#include "CircularBuffer.h"
+#include "benchClock.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+#define FIFO_CHUNK 128 // Bytes handed over per RxFIFO drain
+#define NUM_BURSTS 20000UL
+#define RX_BUF_SIZE 1024 // A power of two
+#define LINE_RATE_BYTES_PER_SECOND 11520UL // 115200 baud 8N1
+
+// One second of output from a typical receiver
+static const char gpsBurst[] =
+	"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+	"$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n"
+	"$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n"
+	"$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74\r\n"
+	"$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D\r\n"
+	"$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"
+	"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n";
+
+typedef struct BenchResult_t
+{
+	uint64_t wallNs;
+	uint64_t cycles;
+	uint32_t numFrames;
+	uint32_t numChecksumErrors;
+} BenchResult;
+
+static volatile uint32_t sink;
+
+static inline uint64_t readCycles(void)
+{
+#if defined(BENCH_HAS_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void countFrame(void* context,
+					   const NmeaFrameView* frame)
+{
+	(void)context;
+	sink += (uint32_t)(frame->firstLength + frame->secondLength);
+}
+
+static int hexValue(uint8_t c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	return ((c >= 'A') && (c <= 'F')) ? (c - 'A' + 10) : -1;
+}
+
+// Per byte scan of the circular buffer: find the line feed with cb_peek, then checksum and copy the sentence out
+static uint32_t scanCircularBuffer(circBuffer_t* cb,
+								   uint32_t* numChecksumErrors)
+{
+	uint8_t sentence[NF_MAX_SENTENCE_LENGTH];
+	uint32_t numFrames = 0;
+	uint16_t count = cb_count(cb);
+	uint16_t index;
+	for (index = 0; index < count; index++)
+	{
+		if ('\n' != cb_peek(cb, index))
+		{
+			continue;
+		}
+		uint16_t length = (index > NF_MAX_SENTENCE_LENGTH) ? NF_MAX_SENTENCE_LENGTH : index;
+		uint16_t at;
+		uint8_t checksum = 0;
+		for (at = 0; at < length; at++)
+		{
+			sentence[at] = cb_peek(cb, at);
+		}
+		for (at = 1; (at < length) && ('*' != sentence[at]); at++)
+		{
+			checksum ^= sentence[at];
+		}
+		if (((at + 2) < length) && (((hexValue(sentence[at + 1]) << 4) | hexValue(sentence[at + 2])) == checksum))
+		{
+			sink += length;
+			numFrames++;
+		}
+		else
+		{
+			(*numChecksumErrors)++;
+		}
+		cb_advance_tail(cb, index + 1);
+		count -= index + 1;
+		index = (uint16_t)-1;
+	}
+	return numFrames;
+}
+
+static void benchFramer(BenchResult* result)
+{
+	static uint8_t storage[256];
+	NmeaFramer f;
+	nf_init(&f, storage, sizeof(storage), 0, countFrame, NULL);
+	size_t burstLength = sizeof(gpsBurst) - 1;
+
+	uint64_t startNs = BenchWallTimeNs();
+	uint64_t startCycles = readCycles();
+	unsigned long burst;
+	for (burst = 0; burst < NUM_BURSTS; burst++)
+	{
+		size_t offset;
+		for (offset = 0; offset < burstLength; offset += FIFO_CHUNK)
+		{
+			nf_feed(&f, (const uint8_t*)&gpsBurst[offset], ((burstLength - offset) < FIFO_CHUNK) ? (burstLength - offset) : FIFO_CHUNK);
+		}
+	}
+	result->cycles = readCycles() - startCycles;
+	result->wallNs = BenchWallTimeNs() - startNs;
+	result->numFrames = f.framesDelivered;
+	result->numChecksumErrors = f.checksumErrors;
+}
+
+static void benchCircularBuffer(BenchResult* result)
+{
+	static uint8_t storage[RX_BUF_SIZE];
+	circBuffer_t cb;
+	cb_init(&cb, storage, RX_BUF_SIZE);
+	size_t burstLength = sizeof(gpsBurst) - 1;
+	result->numFrames = 0;
+	result->numChecksumErrors = 0;
+
+	uint64_t startNs = BenchWallTimeNs();
+	uint64_t startCycles = readCycles();
+	unsigned long burst;
+	for (burst = 0; burst < NUM_BURSTS; burst++)
+	{
+		size_t offset;
+		for (offset = 0; offset < burstLength; offset++)
+		{
+			cb_push(&cb, (uint8_t)gpsBurst[offset]);
+			if ((FIFO_CHUNK - 1) == (offset % FIFO_CHUNK))
+			{
+				result->numFrames += scanCircularBuffer(&cb, &result->numChecksumErrors);
+			}
+		}
+		result->numFrames += scanCircularBuffer(&cb, &result->numChecksumErrors);
+	}
+	result->cycles = readCycles() - startCycles;
+	result->wallNs = BenchWallTimeNs() - startNs;
+}
+
+static void printResult(const char* name,
+						const BenchResult* result,
+						double numBytes)
+{
+	printf("%-28s %8lu frames %4lu bad  %7.2f ns/byte", name, (unsigned long)result->numFrames,
+		   (unsigned long)result->numChecksumErrors, (double)result->wallNs / numBytes);
+	if (0 != result->cycles)
+	{
+		printf("  %6.3f bytes/cycle", numBytes / (double)result->cycles);
+	}
+	printf("  %6.3f%% of a CPU at %lu bytes/s\n", (100.0 * (double)result->wallNs * LINE_RATE_BYTES_PER_SECOND) / (numBytes * 1e9),
+		   (unsigned long)LINE_RATE_BYTES_PER_SECOND);
+}
+
+int main(void)
+{
+	BenchResult framer;
+	BenchResult circular;
+	double numBytes = (double)(sizeof(gpsBurst) - 1) * NUM_BURSTS;
+
+	benchFramer(&framer); // warm up
+	benchFramer(&framer);
+	benchCircularBuffer(&circular);
+
+	printf("%lu GPS bursts of %zu bytes fed %u bytes at a time\n", NUM_BURSTS, sizeof(gpsBurst) - 1, FIFO_CHUNK);
+	printResult("nmeaFramer", &framer, numBytes);
+	printResult("cb_peek scan", &circular, numBytes);
+	printf("speedup %.1fx\n", (double)circular.wallNs / (double)framer.wallNs);
+	return ((framer.numFrames != circular.numFrames) || (0 != framer.numChecksumErrors)) ? 1 : 0;
+}
@@ -0,0 +1,297 @@
+// Host test for nmeaFramer: checksum and delimiter handling, sentences wrapping the ring, and a random stream with
+// corrupted, oversized and blank lines fed in every chunk size from 1 to 200 bytes, checked against a byte at a time
+// reference framer.
+
+#include "nmeaFramer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testCheck.h"
+
+#define RING_CAPACITY 128
+#define STREAM_CAPACITY 65536
+#define MAX_FRAMES 4096
+
+// Every delivered sentence, joined from its views and separated by '\n'
+typedef struct FrameLog_t
+{
+	char text[STREAM_CAPACITY];
+	size_t length;
+	size_t numFrames;
+	size_t numWrapped;
+	size_t numAbsent;
+} FrameLog;
+
+typedef struct FramerCounts_t
+{
+	size_t numFrames;
+	size_t numChecksumErrors;
+	size_t numMalformed;
+} FramerCounts;
+
+static uint8_t ringStorage[RING_CAPACITY];
+static char stream[STREAM_CAPACITY];
+static FrameLog framerLog;
+static FrameLog referenceLog;
+
+static void logFrame(void* context,
+					 const NmeaFrameView* frame)
+{
+	FrameLog* log = (FrameLog*)context;
+	memcpy(&log->text[log->length], frame->first, frame->firstLength);
+	memcpy(&log->text[log->length + frame->firstLength], frame->second, frame->secondLength);
+	log->length += frame->firstLength + frame->secondLength;
+	log->text[log->length++] = '\n';
+	log->numFrames++;
+	log->numWrapped += (frame->secondLength > 0) ? 1 : 0;
+	log->numAbsent += (nf_ChecksumAbsent == frame->checksumStatus) ? 1 : 0;
+}
+
+// Appends "$body*hh\r\n", with the checksum off by corruptBy
+static size_t appendSentence(char* dst,
+							 const char* body,
+							 uint8_t corruptBy)
+{
+	uint8_t checksum = 0;
+	size_t index;
+	for (index = 0; body[index] != '\0'; index++)
+	{
+		checksum ^= (uint8_t)body[index];
+	}
+	return (size_t)sprintf(dst, "$%s*%02X\r\n", body, (uint8_t)(checksum ^ corruptBy));
+}
+
+static int hexValue(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+// Splits the stream at each line feed and applies the framer's rules one line at a time. A trailing partial line is
+// left undelivered, as the framer leaves it.
+static void referenceFrame(const char* bytes,
+						   size_t count,
+						   size_t maxFrameLength,
+						   FramerCounts* counts)
+{
+	size_t start = 0;
+	size_t index;
+	memset(counts, 0, sizeof(*counts));
+	for (index = 0; index < count; index++)
+	{
+		if ('\n' != bytes[index])
+		{
+			continue;
+		}
+		const char* line = &bytes[start];
+		size_t length = index - start;
+		bool isTooLong = (length + 1) > maxFrameLength;
+		start = index + 1;
+		if ((length > 0) && ('\r' == line[length - 1]))
+		{
+			length--;
+		}
+		if (0 == length)
+		{
+			continue;
+		}
+		if ((('$' != line[0]) && ('!' != line[0])) || isTooLong)
+		{
+			counts->numMalformed++;
+			continue;
+		}
+		if ((length >= 4) && ('*' == line[length - 3]))
+		{
+			uint8_t checksum = 0;
+			size_t at;
+			for (at = 1; at < (length - 3); at++)
+			{
+				checksum ^= (uint8_t)line[at];
+			}
+			int high = hexValue(line[length - 2]);
+			int low = hexValue(line[length - 1]);
+			if ((high < 0) || (low < 0) || (((high << 4) | low) != checksum))
+			{
+				counts->numChecksumErrors++;
+				continue;
+			}
+		}
+		NmeaFrameView view = { (const uint8_t*)line, length, NULL, 0, nf_ChecksumValid };
+		logFrame(&referenceLog, &view);
+		counts->numFrames++;
+	}
+}
+
+static void testSingleSentences(void)
+{
+	NmeaFramer f;
+	char sentence[128];
+	FrameLog log;
+	memset(&log, 0, sizeof(log));
+	CHECK(!nf_init(&f, ringStorage, 96, 0, logFrame, &log)); // not a power of two
+	CHECK(!nf_init(&f, ringStorage, 64, 0, logFrame, &log)); // no larger than the longest sentence
+	CHECK(nf_init(&f, ringStorage, RING_CAPACITY, 0, logFrame, &log));
+
+	size_t length = appendSentence(sentence, "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", 0);
+	CHECK(1 == nf_feed(&f, (const uint8_t*)sentence, length));
+	CHECK(0 == strncmp(log.text, sentence, length - 2));
+	CHECK(0 == log.numAbsent);
+
+	length = appendSentence(sentence, "GPVTG,054.7,T,034.4,M,005.5,N,010.2,K", 0x01);
+	CHECK(0 == nf_feed(&f, (const uint8_t*)sentence, length));
+	CHECK(1 == f.checksumErrors);
+
+	const char* lowercase = "$PX*58\r\n"; // 'P' ^ 'X' = 0x08, so a wrong digit - then the same with the right one
+	CHECK(0 == nf_feed(&f, (const uint8_t*)lowercase, strlen(lowercase)));
+	CHECK(1 == nf_feed(&f, (const uint8_t*)"$PX*08\r\n", 8));
+	const char* unchecked = "!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0\r\n"; // no checksum field
+	CHECK(1 == nf_feed(&f, (const uint8_t*)unchecked, strlen(unchecked)));
+	CHECK(1 == log.numAbsent);
+	CHECK(0 == nf_feed(&f, (const uint8_t*)"\r\n\n", 3)); // blank lines are not counted
+	CHECK(0 == f.malformedFrames);
+	const char* undelimited = "GPGLL,4916.45,N\r\n";
+	CHECK(0 == nf_feed(&f, (const uint8_t*)undelimited, strlen(undelimited)));
+	CHECK(1 == f.malformedFrames);
+	CHECK(3 == f.framesDelivered);
+}
+
+// Sentences of 82 bytes from '$' to the line feed are the longest accepted, whether they arrive whole or a byte at a time
+static void testLengthLimit(void)
+{
+	NmeaFramer f;
+	char body[96];
+	char sentence[128];
+	FrameLog log;
+	memset(&log, 0, sizeof(log));
+	memset(body, 'A', sizeof(body));
+
+	size_t chunk;
+	for (chunk = 1; chunk <= 2; chunk++)
+	{
+		CHECK(nf_init(&f, ringStorage, RING_CAPACITY, 0, logFrame, &log));
+		body[NF_MAX_SENTENCE_LENGTH - 6] = '\0'; // '$', "*hh" and "\r\n" make it 82
+		size_t length = appendSentence(sentence, body, 0);
+		CHECK(NF_MAX_SENTENCE_LENGTH == length);
+		size_t offset;
+		for (offset = 0; offset < length; offset += ((chunk == 1) ? 1 : length))
+		{
+			nf_feed(&f, (const uint8_t*)&sentence[offset], (chunk == 1) ? 1 : length);
+		}
+		CHECK(1 == f.framesDelivered);
+
+		body[NF_MAX_SENTENCE_LENGTH - 6] = 'A';
+		body[NF_MAX_SENTENCE_LENGTH - 5] = '\0';
+		length = appendSentence(sentence, body, 0);
+		for (offset = 0; offset < length; offset += ((chunk == 1) ? 1 : length))
+		{
+			nf_feed(&f, (const uint8_t*)&sentence[offset], (chunk == 1) ? 1 : length);
+		}
+		CHECK(1 == f.framesDelivered);
+		CHECK(1 == f.malformedFrames);
+	}
+}
+
+// Builds a stream of valid, corrupted, oversized, undelimited and blank lines
+static size_t buildRandomStream(char* dst,
+								size_t capacity)
+{
+	static const char* const bodies[] = {
+		"GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,",
+		"GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W",
+		"GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45",
+		"GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+		"GPVTG,054.7,T,034.4,M,005.5,N,010.2,K",
+		"PX"
+	};
+	size_t length = 0;
+	while (length < (capacity - 256))
+	{
+		int kind = rand() % 16;
+		if (kind < 10)
+		{
+			length += appendSentence(&dst[length], bodies[rand() % 6], 0);
+		}
+		else if (kind < 12)
+		{
+			length += appendSentence(&dst[length], bodies[rand() % 6], (uint8_t)(1 + (rand() % 255)));
+		}
+		else if (kind < 13)
+		{
+			size_t count = 70 + (size_t)(rand() % 40); // either side of the limit
+			dst[length++] = '$';
+			memset(&dst[length], 'B', count);
+			length += count;
+			dst[length++] = '\n';
+		}
+		else if (kind < 14)
+		{
+			length += (size_t)sprintf(&dst[length], "GPZDA,201530.00,04,07,2002\r\n");
+		}
+		else if (kind < 15)
+		{
+			length += (size_t)sprintf(&dst[length], "\r\n");
+		}
+		else
+		{
+			length += (size_t)sprintf(&dst[length], "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0\n");
+		}
+	}
+	return length;
+}
+
+static void testRandomStream(void)
+{
+	FramerCounts expected;
+	NmeaFramer f;
+	size_t length = buildRandomStream(stream, sizeof(stream));
+	stream[length++] = '$'; // a partial sentence at the end is held back
+	referenceFrame(stream, length, NF_MAX_SENTENCE_LENGTH, &expected);
+	CHECK(expected.numFrames > 100);
+	CHECK(expected.numChecksumErrors > 10);
+	CHECK(expected.numMalformed > 10);
+
+	size_t chunk;
+	for (chunk = 1; chunk <= 200; chunk++)
+	{
+		memset(&framerLog, 0, sizeof(framerLog));
+		CHECK(nf_init(&f, ringStorage, RING_CAPACITY, 0, logFrame, &framerLog));
+		size_t offset;
+		size_t numDelivered = 0;
+		for (offset = 0; offset < length; offset += chunk)
+		{
+			numDelivered += nf_feed(&f, (const uint8_t*)&stream[offset], ((length - offset) < chunk) ? (length - offset) : chunk);
+		}
+		CHECK(numDelivered == expected.numFrames);
+		CHECK(f.framesDelivered == expected.numFrames);
+		CHECK(f.checksumErrors == expected.numChecksumErrors);
+		CHECK(f.malformedFrames == expected.numMalformed);
+		CHECK(framerLog.length == referenceLog.length);
+		CHECK(0 == memcmp(framerLog.text, referenceLog.text, referenceLog.length));
+		CHECK(framerLog.numWrapped > 0);
+		if (0 != failures)
+		{
+			printf("  chunk size %zu\n", chunk);
+			return;
+		}
+	}
+}
+
+int main(void)
+{
+	srand(1);
+	testSingleSentences();
+	testLengthLimit();
+	testRandomStream();
+	return TestVerdict("nmeaFramerTest");
+}
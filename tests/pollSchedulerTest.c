@@ -0,0 +1,250 @@
+/*
+ File: Host simulation of the adaptive receive poll scheduler against fixed rate polling
+ Author: Henry Gilbert
+
+ One MAX3109 channel on the host model receives canned traffic at each baud rate. The simulated clock jumps from poll
+ to poll, and the bytes the line delivered in between are put into the RxFIFO at each poll, where the model drops
+ whatever does not fit - so the overflow count is exact. Every poll lands POLL_LATENCY_CHARACTERS late, as a busy main
+ loop would.
+
+ The fixed rate baseline is the main loop before the scheduler: every port polled at the longest period that still
+ keeps a full rate line at the highest board baud rate from overflowing. The test fails on any overflow, or if the
+ scheduler does not poll less than the baseline on the slower lines. At the highest baud rate neither can poll an idle
+ line less often than the time a burst takes to fill the FIFO, so there it only has to stay free of overflows.
+
+ A last check drains into rx blocks whose consumer falls behind: the throttled port must not back off as if idle, and a
+ release must bring both the scheduler and the interrupt path back to drain it with no IRQ pending.
+ */
+
+#include "UARTPollScheduler.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TARGET_FILL_LEVEL 96
+#define POLL_LATENCY_CHARACTERS 4
+#define SIMULATED_SECONDS 20UL
+#define RX_BUF_SIZE 4096 // A power of two, emptied after every poll
+#define THROTTLE_BLOCKS 4
+#define THROTTLE_HIGH_WATERMARK 3
+#define THROTTLE_LOW_WATERMARK 1
+
+/* Bursts of burstBytes at full line rate every period_ms, idle in between. A burst longer than the period is a
+ continuous stream. */
+typedef struct TRAFFIC_PATTERN_t {
+   const char * name ;
+   uint32_t period_ms ;
+   uint32_t burstBytes ;
+} TRAFFIC_PATTERN ;
+
+typedef struct SIMULATION_RESULT_t {
+   uint32_t numPolls ;
+   uint32_t numBytes ;
+   uint32_t numOverflows ;
+   uint32_t numTransactions ;
+} SIMULATION_RESULT ;
+
+static const uint32_t baudRates [ ] = { 9600UL, 115200UL, 460800UL, 921600UL } ; // Highest board rate last
+#define NUM_BAUD_RATES ( sizeof ( baudRates ) / sizeof ( baudRates [ 0 ] ) )
+static const TRAFFIC_PATTERN patterns [ ] = {
+   { "continuous", 1000, 0xFFFFFFFFUL },
+   { "gps 1 Hz", 1000, 600 },
+   { "telemetry 10 Hz", 100, 40 },
+   { "idle", 5000, 8 }
+} ;
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static MAX3109_UART_PORT port ;
+static circBuffer_t rxBuf ;
+static circBuffer_t txBuf ;
+static uint8_t rxStorage [ RX_BUF_SIZE ] ;
+static uint8_t txStorage [ 1 ] ;
+static UART_RX_BLOCK throttleBlocks [ THROTTLE_BLOCKS ] ;
+static UART_RX_BLOCK_RING throttleRing ;
+
+/* Bytes the line has delivered by time_us since the start of the run */
+static uint64_t BytesArrivedBy ( const TRAFFIC_PATTERN * pattern, const uint32_t charactersPerSecond, const uint64_t time_us )
+{
+   uint64_t period_us = ( uint64_t ) pattern->period_ms * 1000 ;
+   uint64_t lineBytes = ( ( time_us % period_us ) * charactersPerSecond ) / 1000000UL ;
+   uint64_t periodBytes = ( ( period_us * charactersPerSecond ) / 1000000UL ) ;
+   uint64_t burstBytes = ( pattern->burstBytes < periodBytes ) ? pattern->burstBytes : periodBytes ;
+   return ( ( time_us / period_us ) * burstBytes ) + ( ( lineBytes < burstBytes ) ? lineBytes : burstBytes ) ;
+}
+
+static void DeliverLineBytes ( uint64_t * numDelivered, const uint64_t numArrived )
+{
+   static const uint8_t lineBytes [ 255 ] = { 0 } ;
+   while ( *numDelivered < numArrived )
+   {
+      uint64_t numBytes = numArrived - *numDelivered ;
+      numBytes = ( numBytes > sizeof ( lineBytes ) ) ? sizeof ( lineBytes ) : numBytes ;
+      HostMAX3109InjectRx ( &model, UART_0, lineBytes, ( uint8_t ) numBytes ) ; // Refused bytes count as rxOverruns
+      *numDelivered += numBytes ;
+   }
+}
+
+static uint8_t ConfigureLine ( const uint32_t baudRate, uint32_t * charactersPerSecond )
+{
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   if ( ( 0 == HostChipAttach ( &model, &device, 0 ) ) ||
+        ( 0 == HostChipInitialize ( baudRate, &baudSettings ) ) )
+   {
+      return 0 ;
+   }
+   *charactersPerSecond = MAXGetUARTBaudRate ( UART_0, HOST_CHIP_CRYSTAL_HZ ) / MAXGetUARTBitsPerCharacter ( UART_0 ) ;
+   cb_init ( &rxBuf, rxStorage, RX_BUF_SIZE ) ;
+   InitializeUARTPort ( &port, &device, UART_0, &rxBuf, &txBuf, 0 ) ;
+   HostSPIResetStats ( ) ;
+   return 1 ;
+}
+
+static void FinishRun ( SIMULATION_RESULT * result, const uint64_t numDelivered )
+{
+   HOST_SPI_STATS spiStats ;
+   HostSPIGetStats ( &spiStats ) ;
+   result->numBytes = ( uint32_t ) numDelivered ;
+   result->numOverflows = model.channels [ 0 ].rxOverruns ;
+   result->numTransactions = spiStats.transactions ;
+}
+
+static void RunAdaptive ( const TRAFFIC_PATTERN * pattern, const uint32_t baudRate, SIMULATION_RESULT * result )
+{
+   uint32_t charactersPerSecond ;
+   UART_POLL_SCHEDULE schedule ;
+   memset ( result, 0, sizeof ( *result ) ) ;
+   CHECK ( 1 == ConfigureLine ( baudRate, &charactersPerSecond ) ) ;
+   CHECK ( 1 == InitializeUARTPollSchedule ( &schedule, &port, HOST_CHIP_CRYSTAL_HZ, TARGET_FILL_LEVEL, 0 ) ) ;
+
+   uint32_t latency_us = ( POLL_LATENCY_CHARACTERS * 1000000UL ) / charactersPerSecond ;
+   uint64_t numDelivered = 0 ;
+   uint64_t now_us = 0 ;
+   while ( now_us < ( SIMULATED_SECONDS * 1000000UL ) )
+   {
+      DeliverLineBytes ( &numDelivered, BytesArrivedBy ( pattern, charactersPerSecond, now_us ) ) ;
+      ServiceUARTPollSchedules ( &schedule, 1, ( uint32_t ) now_us ) ;
+      cb_advance_tail ( &rxBuf, cb_count ( &rxBuf ) ) ;
+      result->numPolls++ ;
+      now_us += ( uint32_t ) ( GetNextUARTPollTime ( &schedule, 1, ( uint32_t ) now_us ) - ( uint32_t ) now_us ) + latency_us ;
+   }
+   FinishRun ( result, numDelivered ) ;
+}
+
+static void RunFixedRate ( const TRAFFIC_PATTERN * pattern, const uint32_t baudRate, SIMULATION_RESULT * result )
+{
+   uint32_t charactersPerSecond ;
+   memset ( result, 0, sizeof ( *result ) ) ;
+   CHECK ( 1 == ConfigureLine ( baudRate, &charactersPerSecond ) ) ;
+
+   uint32_t fastestCharactersPerSecond = baudRates [ NUM_BAUD_RATES - 1 ] / 10 ; // 8N1
+   uint32_t period_us = ( ( UART_POLL_SAFE_FILL_LEVEL - POLL_LATENCY_CHARACTERS ) * 1000000UL ) / fastestCharactersPerSecond ;
+   uint64_t numDelivered = 0 ;
+   uint64_t now_us ;
+   for ( now_us = 0 ; now_us < ( SIMULATED_SECONDS * 1000000UL ) ; now_us += period_us )
+   {
+      DeliverLineBytes ( &numDelivered, BytesArrivedBy ( pattern, charactersPerSecond, now_us ) ) ;
+      ReadDataFromUARTPort ( &port ) ;
+      cb_advance_tail ( &rxBuf, cb_count ( &rxBuf ) ) ;
+      result->numPolls++ ;
+   }
+   FinishRun ( result, numDelivered ) ;
+}
+
+/* Fills the blocks to the high watermark without consuming them, then releases them one at a time */
+static void RunThrottleCheck ( void )
+{
+   static const uint8_t fifoBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] = { 0 } ;
+   uint32_t charactersPerSecond ;
+   UART_POLL_SCHEDULE schedule ;
+   MAX3109_UART_PORT_SET throttlePortSet ;
+   CHECK ( 1 == ConfigureLine ( 115200UL, &charactersPerSecond ) ) ;
+   InitializeUARTPortSet ( &throttlePortSet, &port, 1 ) ;
+   CHECK ( 1 == InitializeUARTRxBlockRing ( &throttleRing, throttleBlocks, THROTTLE_BLOCKS, 0 ) ) ;
+   CHECK ( 1 == SetUARTRxBlockWatermarks ( &throttleRing, THROTTLE_HIGH_WATERMARK, THROTTLE_LOW_WATERMARK ) ) ;
+   AttachUARTPortRxBlocks ( &port, &throttleRing ) ;
+   CHECK ( 1 == InitializeUARTPollSchedule ( &schedule, &port, HOST_CHIP_CRYSTAL_HZ, TARGET_FILL_LEVEL, 0 ) ) ;
+
+   uint32_t now_us = 0 ;
+   uint32_t numBytesToFill = THROTTLE_HIGH_WATERMARK * UART_RX_BLOCK_SIZE ;
+   while ( numBytesToFill > 0 )
+   {
+      HostMAX3109InjectRx ( &model, UART_0, fifoBytes, sizeof ( fifoBytes ) ) ;
+      now_us = GetNextUARTPollTime ( &schedule, 1, now_us ) ;
+      CHECK ( sizeof ( fifoBytes ) == ServiceUARTPollSchedules ( &schedule, 1, now_us ) ) ;
+      numBytesToFill -= sizeof ( fifoBytes ) ;
+   }
+
+   /* The consumer holds the high watermark - the next poll leaves the bytes in the RxFIFO but keeps polling quickly */
+   HostMAX3109InjectRx ( &model, UART_0, fifoBytes, sizeof ( fifoBytes ) ) ;
+   uint32_t idleInterval_us = schedule.idleInterval_us ;
+   now_us = GetNextUARTPollTime ( &schedule, 1, now_us ) ;
+   CHECK ( 0 == ServiceUARTPollSchedules ( &schedule, 1, now_us ) ) ;
+   CHECK ( IsUARTRxBlockRingThrottled ( &throttleRing ) ) ;
+   CHECK ( schedule.minimumInterval_us == ( schedule.nextPollTime_us - now_us ) ) ;
+   CHECK ( idleInterval_us == schedule.idleInterval_us ) ;
+   CHECK ( 0 == model.channels [ 0 ].rxOverruns ) ;
+
+   /* Above the low watermark a release asks for a drain, which stays throttled */
+   ReleaseUARTRxBlock ( &throttleRing, GetUARTRxBlock ( &throttleRing ) ) ;
+   CHECK ( IsUARTPortServiceRequested ( &throttlePortSet ) ) ;
+   CHECK ( now_us == GetNextUARTPollTime ( &schedule, 1, now_us ) ) ;
+   CHECK ( 0 == ServiceUARTPollSchedules ( &schedule, 1, now_us ) ) ;
+   CHECK ( false == IsUARTPortServiceRequested ( &throttlePortSet ) ) ;
+   CHECK ( IsUARTRxBlockRingThrottled ( &throttleRing ) ) ;
+
+   /* Down to the low watermark the interrupt path drains the port with no IRQ enabled */
+   ReleaseUARTRxBlock ( &throttleRing, GetUARTRxBlock ( &throttleRing ) ) ;
+   CHECK ( IsUARTPortServiceRequested ( &throttlePortSet ) ) ;
+   CHECK ( sizeof ( fifoBytes ) == ServiceUARTPortInterrupts ( &throttlePortSet ) ) ;
+   CHECK ( false == IsUARTRxBlockRingThrottled ( &throttleRing ) ) ;
+   CHECK ( false == IsUARTPortServiceRequested ( &throttlePortSet ) ) ;
+   printf ( "throttled port: %lu throttles, resumed on release\n", ( unsigned long ) throttleRing.numThrottles ) ;
+}
+
+static double PerByte ( const uint32_t count, const uint32_t numBytes )
+{
+   return ( 0 == numBytes ) ? 0.0 : ( double ) count / numBytes ;
+}
+
+int main ( void )
+{
+   cb_init ( &txBuf, txStorage, sizeof ( txStorage ) ) ;
+
+   printf ( "%u s simulated per run, target fill %u bytes, polls %u characters late\n", ( unsigned ) SIMULATED_SECONDS,
+            TARGET_FILL_LEVEL, POLL_LATENCY_CHARACTERS ) ;
+   printf ( "%8s %-16s %10s | %14s %14s %9s | %14s %14s %9s\n", "baud", "traffic", "bytes", "fixed polls/B",
+            "fixed SPI/B", "overflow", "adapt polls/B", "adapt SPI/B", "overflow" ) ;
+
+   uint8_t baudIndex ;
+   uint8_t patternIndex ;
+   for ( baudIndex = 0 ; baudIndex < NUM_BAUD_RATES ; baudIndex++ )
+   {
+      for ( patternIndex = 0 ; patternIndex < ( sizeof ( patterns ) / sizeof ( patterns [ 0 ] ) ) ; patternIndex++ )
+      {
+         const TRAFFIC_PATTERN * pattern = &patterns [ patternIndex ] ;
+         SIMULATION_RESULT fixed ;
+         SIMULATION_RESULT adaptive ;
+         RunFixedRate ( pattern, baudRates [ baudIndex ], &fixed ) ;
+         RunAdaptive ( pattern, baudRates [ baudIndex ], &adaptive ) ;
+
+         printf ( "%8lu %-16s %10lu | %14.4f %14.4f %9lu | %14.4f %14.4f %9lu\n", ( unsigned long ) baudRates [ baudIndex ],
+                  pattern->name, ( unsigned long ) adaptive.numBytes, PerByte ( fixed.numPolls, fixed.numBytes ),
+                  PerByte ( fixed.numTransactions, fixed.numBytes ), ( unsigned long ) fixed.numOverflows,
+                  PerByte ( adaptive.numPolls, adaptive.numBytes ), PerByte ( adaptive.numTransactions, adaptive.numBytes ),
+                  ( unsigned long ) adaptive.numOverflows ) ;
+
+         CHECK ( 0 == fixed.numOverflows ) ;
+         CHECK ( 0 == adaptive.numOverflows ) ;
+         if ( baudIndex < ( NUM_BAUD_RATES - 1 ) )
+         {
+            CHECK ( adaptive.numPolls < fixed.numPolls ) ;
+         }
+      }
+   }
+
+   RunThrottleCheck ( ) ;
+
+   return TestVerdict ( "pollSchedulerTest" ) ;
+}
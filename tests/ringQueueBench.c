@@ -0,0 +1,90 @@
+// Push/pop throughput of RingQueue against the reset-on-empty Queue, single element and bulk, in values per second.
+// Queue has to drain every round to get its space back, RingQueue keeps a batch in flight the whole time.
+
+#include "queue.h"
+#include "ringQueue.h"
+#include "benchClock.h"
+#include <stdio.h>
+
+#define CAPACITY 256
+#define BATCH 64
+#define NUM_ROUNDS 200000UL
+
+static uint32_t queueStorage[CAPACITY];
+static uint32_t ringStorage[CAPACITY];
+static volatile uint32_t sink;
+
+static void report(const char* name, uint64_t elapsedNs, uint64_t numOps)
+{
+	printf("  %-22s %8.1f M values/s\n", name, ((double)numOps * 1e3) / (double)elapsedNs);
+}
+
+int main(void)
+{
+	Queue q = { 0, 0, queueStorage, CAPACITY, false };
+	RingQueue rq;
+	rq_init(&rq, ringStorage, CAPACITY);
+	uint32_t values[BATCH] = { 0 };
+	uint64_t numOps = 2ULL * BATCH * NUM_ROUNDS;
+	uint32_t sum = 0;
+	unsigned long round;
+	size_t counter;
+	printf("ringQueueBench: %lu rounds of %u pushes then %u pops, capacity %u\n", NUM_ROUNDS, BATCH, BATCH, CAPACITY);
+
+	uint64_t start = BenchWallTimeNs();
+	for (round = 0; round < NUM_ROUNDS; round++)
+	{
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			q_push(&q, (uint32_t)counter);
+		}
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			sum += q_pop(&q);
+		}
+		q_reset(&q);
+	}
+	report("Queue push/pop", BenchWallTimeNs() - start, numOps);
+
+	// RingQueue keeps BATCH values in flight the whole time
+	for (counter = 0; counter < BATCH; counter++)
+	{
+		rq_push(&rq, (uint32_t)counter);
+	}
+	start = BenchWallTimeNs();
+	for (round = 0; round < NUM_ROUNDS; round++)
+	{
+		uint32_t value;
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			rq_push(&rq, (uint32_t)counter);
+		}
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			rq_pop(&rq, &value);
+			sum += value;
+		}
+	}
+	report("RingQueue push/pop", BenchWallTimeNs() - start, numOps);
+
+	start = BenchWallTimeNs();
+	for (round = 0; round < NUM_ROUNDS; round++)
+	{
+		q_push_n(&q, values, BATCH);
+		q_pop_n(&q, values, BATCH);
+		sum += values[0];
+	}
+	report("Queue push_n/pop_n", BenchWallTimeNs() - start, numOps);
+
+	start = BenchWallTimeNs();
+	for (round = 0; round < NUM_ROUNDS; round++)
+	{
+		rq_push_n(&rq, values, BATCH);
+		rq_pop_n(&rq, values, BATCH);
+		sum += values[0];
+	}
+	report("RingQueue push_n/pop_n", BenchWallTimeNs() - start, numOps);
+
+	sink = sum;
+	return 0;
+}
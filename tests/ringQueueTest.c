@@ -0,0 +1,112 @@
+// Host test for ringQueue: wraparound reuse of freed slots, zero copy spans across the wrap, and a producer and a
+// consumer thread hammering one queue to check the SPSC ordering with C11 atomics.
+
+#include "ringQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include "testCheck.h"
+
+#define STRESS_CAPACITY 64
+#define STRESS_VALUES 2000000UL
+
+static RingQueue stressQueue;
+static uint32_t stressStorage[STRESS_CAPACITY];
+
+static void testWraparound(void)
+{
+	RingQueue q;
+	uint32_t storage[8];
+	uint32_t value = 0;
+	CHECK(!rq_init(&q, storage, 6)); // not a power of two
+	CHECK(rq_init(&q, storage, 8));
+
+	// Keep the queue from ever draining - a reset-on-empty queue reports full here
+	uint32_t next = 0;
+	uint32_t expected = 0;
+	size_t counter;
+	for (counter = 0; counter < 7; counter++)
+	{
+		CHECK(rq_push(&q, next++));
+	}
+	for (counter = 0; counter < 1000; counter++)
+	{
+		CHECK(rq_push(&q, next++));
+		CHECK(rq_pop(&q, &value) && (value == expected++));
+	}
+	CHECK(rq_push(&q, next++));
+	CHECK(8 == rq_numMsgsInQueue(&q));
+	CHECK(!rq_push(&q, next));
+	CHECK(rq_peek(&q, 7, &value) && (value == next - 1));
+	CHECK(!rq_peek(&q, 8, &value));
+
+	// Spans split at the end of storage
+	RingQueueSpans spans;
+	uint32_t popped[8];
+	CHECK(4 == rq_pop_n(&q, popped, 4));
+	CHECK(4 == rq_write_reserve(&q, 8, &spans));
+	CHECK((spans.firstCount + spans.secondCount) == 4);
+	for (counter = 0; counter < spans.firstCount; counter++)
+	{
+		spans.first[counter] = next++;
+	}
+	for (counter = 0; counter < spans.secondCount; counter++)
+	{
+		spans.second[counter] = next++;
+	}
+	rq_write_commit(&q, 4);
+	CHECK(8 == rq_read_acquire(&q, 8, &spans));
+	CHECK(spans.first[0] == expected + 4);
+	rq_read_release(&q, 8);
+	CHECK(0 == rq_numMsgsInQueue(&q));
+}
+
+static void* stressProducer(void* arg)
+{
+	(void)arg;
+	uint32_t value = 0;
+	while (value < STRESS_VALUES)
+	{
+		if (rq_push(&stressQueue, value))
+		{
+			value++;
+		}
+		else
+		{
+			sched_yield(); // full - let the consumer run on a single core host
+		}
+	}
+	return NULL;
+}
+
+static void testProducerConsumerThreads(void)
+{
+	pthread_t producer;
+	CHECK(rq_init(&stressQueue, stressStorage, STRESS_CAPACITY));
+	pthread_create(&producer, NULL, stressProducer, NULL);
+
+	uint32_t expected = 0;
+	uint32_t outOfOrder = 0;
+	uint32_t value;
+	while (expected < STRESS_VALUES)
+	{
+		if (rq_pop(&stressQueue, &value))
+		{
+			outOfOrder += (value != expected) ? 1 : 0;
+			expected++;
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+	pthread_join(producer, NULL);
+	CHECK(0 == outOfOrder);
+	CHECK(0 == rq_numMsgsInQueue(&stressQueue));
+}
+
+int main(void)
+{
+	testWraparound();
+	testProducerConsumerThreads();
+	return TestVerdict("ringQueueTest");
+}
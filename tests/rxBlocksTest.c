@@ -0,0 +1,162 @@
+/*
+ File: Host test for the block oriented receive path
+ Author: Henry Gilbert
+
+ One MAX3109 channel on the host model drains into a ring of rx blocks through the port layer. The line carries a
+ running byte count, so every block handed over can be checked for lost, repeated or reordered bytes. Covers a block
+ filled across several drains and handed over when full, a partly filled block handed over on its timeout with no
+ receive interrupt to run the drain, and the RxFIFO holding its bytes while the consumer holds every block.
+ */
+
+#include "SPItoUART.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include <stdio.h>
+
+#define NUM_BLOCKS 4
+#define BLOCK_TIMEOUT 1000 // Clock ticks
+#define DRAIN_BYTES 100 // Bytes on the line between drains, so blocks fill across drain boundaries
+#define BUF_SIZE 16 // A power of two, unused while rx blocks are attached
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static MAX3109_UART_PORT port ;
+static MAX3109_UART_PORT_SET portSet ;
+static UART_RX_BLOCK blocks [ NUM_BLOCKS ] ;
+static UART_RX_BLOCK_RING ring ;
+static uint32_t clockTicks ;
+static uint8_t nextLineByte ; // Running count carried by the line
+static uint8_t nextBlockByte ; // Running count expected in the next block handed over
+
+static uint32_t FakeClock ( void )
+{
+   return clockTicks ;
+}
+
+static void InjectLineBytes ( const uint8_t numBytes )
+{
+   uint8_t lineBytes [ MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ] ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < numBytes ; counter++ )
+   {
+      lineBytes [ counter ] = nextLineByte++ ;
+   }
+   CHECK ( numBytes == HostMAX3109InjectRx ( &model, UART_0, lineBytes, numBytes ) ) ;
+}
+
+/* Takes the next block handed over and checks it holds the next numBytes of the running count */
+static UART_RX_BLOCK * TakeBlock ( const uint16_t numBytes )
+{
+   UART_RX_BLOCK * block = GetUARTRxBlock ( &ring ) ;
+   CHECK ( NULL != block ) ;
+   if ( NULL == block )
+   {
+      return NULL ;
+   }
+
+   CHECK ( numBytes == block->numBytes ) ;
+   uint16_t counter ;
+   for ( counter = 0 ; counter < block->numBytes ; counter++ )
+   {
+      if ( nextBlockByte != block->data [ counter ] )
+      {
+         printf ( "byte %u of block: expected %u, got %u\n", counter, nextBlockByte, block->data [ counter ] ) ;
+         CHECK ( false ) ;
+         break ;
+      }
+      nextBlockByte++ ;
+   }
+   return block ;
+}
+
+/* 300 bytes in three drains: the first block fills on the third drain and goes over at once, the rest stays active */
+static void TestFullBlockAcrossDrains ( void )
+{
+   uint8_t counter ;
+   for ( counter = 0 ; counter < 2 ; counter++ )
+   {
+      InjectLineBytes ( DRAIN_BYTES ) ;
+      CHECK ( DRAIN_BYTES == ReadDataFromUARTPort ( &port ) ) ;
+      CHECK ( NULL == GetUARTRxBlock ( &ring ) ) ;
+   }
+   InjectLineBytes ( DRAIN_BYTES ) ;
+   CHECK ( DRAIN_BYTES == ReadDataFromUARTPort ( &port ) ) ;
+
+   ReleaseUARTRxBlock ( &ring, TakeBlock ( UART_RX_BLOCK_SIZE ) ) ;
+   CHECK ( NULL == GetUARTRxBlock ( &ring ) ) ;
+}
+
+/* The partly filled block from the last test goes over once its timeout passes, with no IRQ and no new bytes */
+static void TestTimeoutHandOver ( void )
+{
+   uint16_t numBytesActive = ( 3 * DRAIN_BYTES ) - UART_RX_BLOCK_SIZE ;
+
+   clockTicks += BLOCK_TIMEOUT - 1 ;
+   CHECK ( false == IsUARTPortServiceRequested ( &portSet ) ) ;
+   CHECK ( 0 == ServiceUARTPortInterrupts ( &portSet ) ) ;
+   CHECK ( NULL == GetUARTRxBlock ( &ring ) ) ;
+
+   clockTicks++ ;
+   CHECK ( IsUARTPortServiceRequested ( &portSet ) ) ;
+   CHECK ( 0 == ServiceUARTPortInterrupts ( &portSet ) ) ;
+   CHECK ( false == IsUARTPortServiceRequested ( &portSet ) ) ;
+   ReleaseUARTRxBlock ( &ring, TakeBlock ( numBytesActive ) ) ;
+}
+
+/* With every block held the drain reads nothing and the bytes wait in the RxFIFO, in order, for a release */
+static void TestConsumerHoldsEveryBlock ( void )
+{
+   UART_RX_BLOCK * heldBlocks [ NUM_BLOCKS ] ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < NUM_BLOCKS ; counter++ )
+   {
+      InjectLineBytes ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+      CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == ReadDataFromUARTPort ( &port ) ) ;
+      InjectLineBytes ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+      CHECK ( MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES == ReadDataFromUARTPort ( &port ) ) ;
+      heldBlocks [ counter ] = TakeBlock ( UART_RX_BLOCK_SIZE ) ;
+   }
+
+   InjectLineBytes ( DRAIN_BYTES ) ;
+   CHECK ( 0 == ReadDataFromUARTPort ( &port ) ) ;
+   CHECK ( DRAIN_BYTES == MAXGetUARTFIFOLevel ( UART_0, max3109_RxFIFOLvl ) ) ;
+   CHECK ( NULL == GetUARTRxBlock ( &ring ) ) ;
+
+   ReleaseUARTRxBlock ( &ring, heldBlocks [ 0 ] ) ;
+   CHECK ( DRAIN_BYTES == ReadDataFromUARTPort ( &port ) ) ;
+   CHECK ( 0 == MAXGetUARTFIFOLevel ( UART_0, max3109_RxFIFOLvl ) ) ;
+   for ( counter = 1 ; counter < NUM_BLOCKS ; counter++ )
+   {
+      ReleaseUARTRxBlock ( &ring, heldBlocks [ counter ] ) ;
+   }
+
+   clockTicks += BLOCK_TIMEOUT ;
+   CHECK ( 0 == ServiceUARTPortInterrupts ( &portSet ) ) ;
+   ReleaseUARTRxBlock ( &ring, TakeBlock ( DRAIN_BYTES ) ) ;
+}
+
+int main ( void )
+{
+   circBuffer_t rxBuf ;
+   circBuffer_t txBuf ;
+   static uint8_t rxStorage [ BUF_SIZE ] ;
+   static uint8_t txStorage [ BUF_SIZE ] ;
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   CHECK ( 1 == HostChipAttach ( &model, &device, 0 ) ) ;
+   CHECK ( 1 == HostChipInitialize ( 115200UL, &baudSettings ) ) ;
+   cb_init ( &rxBuf, rxStorage, BUF_SIZE ) ;
+   cb_init ( &txBuf, txStorage, BUF_SIZE ) ;
+
+   InitializeUARTPort ( &port, &device, UART_0, &rxBuf, &txBuf, 0 ) ;
+   InitializeUARTPortSet ( &portSet, &port, 1 ) ;
+   CHECK ( 1 == InitializeUARTRxBlockRing ( &ring, blocks, NUM_BLOCKS, BLOCK_TIMEOUT ) ) ;
+   AttachUARTPortRxBlocks ( &port, &ring ) ;
+   SetUARTPortClock ( FakeClock ) ;
+
+   TestFullBlockAcrossDrains ( ) ;
+   TestTimeoutHandOver ( ) ;
+   TestConsumerHoldsEveryBlock ( ) ;
+   CHECK ( 0 == cb_count ( &rxBuf ) ) ;
+
+   return TestVerdict ( "rxBlocksTest" ) ;
+}
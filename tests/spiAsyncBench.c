@@ -0,0 +1,105 @@
+/*
+ File: CPU time freed by the SPIAsync engine, per KB drained from a MAX3109 RxFIFO
+ Author: Henry Gilbert
+
+ The blocking burst read keeps the CPU busy for the whole bus time of every word. The async burst only costs the
+ enqueue, one completion interrupt per word and the unpack, so the CPU time freed per KB is the bus time minus that
+ engine overhead. The bus time is computed for SPI_CLOCK_HZ, the engine overhead is measured on the host model.
+ */
+
+#include "hostChip.h"
+#include "SPIAsync.h"
+#include "benchClock.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SPI_CLOCK_HZ 5000000UL
+#define BURST_BYTES 127 // Odd, so a burst is whole words
+#define NUM_BURSTS 8192
+
+static volatile bool isBurstComplete ;
+
+static void OnBurstComplete ( void * context, uint16_t * readData, const uint16_t numWords )
+{
+   ( void ) context ;
+   ( void ) readData ;
+   ( void ) numWords ;
+   isBurstComplete = true ;
+}
+
+static void FillRxFIFO ( HOST_MAX3109_MODEL * model, const uint8_t sequence )
+{
+   uint8_t bytes [ BURST_BYTES ] ;
+   uint8_t counter ;
+   for ( counter = 0 ; counter < BURST_BYTES ; counter++ )
+   {
+      bytes [ counter ] = ( uint8_t ) ( sequence + counter ) ;
+   }
+   HostMAX3109InjectRx ( model, UART_0, bytes, BURST_BYTES ) ;
+}
+
+static bool BytesMatch ( const uint8_t * bytes, const uint8_t sequence )
+{
+   uint8_t counter ;
+   for ( counter = 0 ; counter < BURST_BYTES ; counter++ )
+   {
+      if ( bytes [ counter ] != ( uint8_t ) ( sequence + counter ) )
+      {
+         return false ;
+      }
+   }
+   return true ;
+}
+
+int main ( void )
+{
+   static HOST_MAX3109_MODEL model ;
+   static MAX3109_DEVICE device ;
+   HostChipAttach ( &model, &device, 0 ) ;
+
+   uint8_t bytes [ BURST_BYTES ] ;
+   uint16_t wordBuffer [ MAX3109_BURST_WORD_COUNT ( BURST_BYTES ) ] ;
+   uint32_t numErrors = 0 ;
+   uint64_t blockingNs = 0 ;
+   uint64_t asyncNs = 0 ;
+   uint32_t burst ;
+
+   for ( burst = 0 ; burst < NUM_BURSTS ; burst++ )
+   {
+      FillRxFIFO ( &model, ( uint8_t ) burst ) ;
+      uint64_t start = BenchCPUTimeNs ( ) ;
+      MAXPopBurstFromUARTRxFIFO ( UART_0, bytes, BURST_BYTES ) ;
+      blockingNs += BenchCPUTimeNs ( ) - start ;
+      numErrors += BytesMatch ( bytes, ( uint8_t ) burst ) ? 0 : 1 ;
+   }
+
+   for ( burst = 0 ; burst < NUM_BURSTS ; burst++ )
+   {
+      FillRxFIFO ( &model, ( uint8_t ) burst ) ;
+      isBurstComplete = false ;
+      uint64_t start = BenchCPUTimeNs ( ) ;
+      if ( BURST_BYTES != MAXQueuePopBurstFromUARTRxFIFO ( UART_0, wordBuffer, BURST_BYTES, OnBurstComplete, NULL ) )
+      {
+         numErrors++ ;
+         continue ;
+      }
+      while ( HostSPIServiceInterrupt ( ) )
+      {
+      }
+      MAXUnpackBurstFromUARTRxFIFO ( wordBuffer, bytes, BURST_BYTES ) ;
+      asyncNs += BenchCPUTimeNs ( ) - start ;
+      numErrors += ( isBurstComplete && BytesMatch ( bytes, ( uint8_t ) burst ) ) ? 0 : 1 ;
+   }
+
+   double numKB = ( ( double ) NUM_BURSTS * BURST_BYTES ) / 1024.0 ;
+   double wordsPerKB = ( ( double ) NUM_BURSTS * MAX3109_BURST_WORD_COUNT ( BURST_BYTES ) ) / numKB ;
+   double busUsPerKB = ( wordsPerKB * 16.0 * 1e6 ) / SPI_CLOCK_HZ ;
+   double asyncUsPerKB = ( ( double ) asyncNs / 1e3 ) / numKB ;
+   printf ( "spiAsyncBench: %.0f KB in %u byte bursts, SPI clock %lu Hz\n", numKB, BURST_BYTES, SPI_CLOCK_HZ ) ;
+   printf ( "  blocking: CPU busy for the bus time, %.1f us/KB (host call cost %.1f us/KB)\n", busUsPerKB,
+            ( ( double ) blockingNs / 1e3 ) / numKB ) ;
+   printf ( "  async:    engine overhead %.1f us/KB, CPU time freed %.1f us/KB\n", asyncUsPerKB,
+            busUsPerKB - asyncUsPerKB ) ;
+   printf ( "  errors %u\n", numErrors ) ;
+   return ( 0 == numErrors ) ? 0 : 1 ;
+}
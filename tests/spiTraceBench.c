@@ -0,0 +1,333 @@
+/*
+ File: SPI trace benchmark runner - canned traffic recorded on the host model, replayed through MAX3109 and SPItoUART
+ Author: Henry Gilbert
+
+ Each scenario configures a chip, then services its ports once per SERVICE_PERIOD_US of simulated time while the host
+ model receives canned line traffic. Everything on the bus is recorded through spiRecorderTransport. The trace is then
+ replayed through spiReplayTransport with the same service calls, and the runner reports, for the traffic after the
+ chip setup, SPI transactions per received byte and per second, CPU time of the replayed driver calls per KB and per
+ second, and the line bytes that never reached the port buffers. The idle_line scenario only has the per second figures.
+
+ Usage: spiTraceBench [-w directory | -r directory]
+   -w saves the recorded traces, -r replays saved traces instead of recording new ones. Replaying the traces saved by
+   an older build shows whether the driver still issues the same SPI traffic (mismatches) and what it costs now.
+ Exits non-zero if a replay diverges from its trace or a scenario drops bytes.
+ */
+
+#include "SPItoUART.h"
+#include "SPITrace.h"
+#include "hostChip.h"
+#include "benchClock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SERVICE_PERIOD_US 1000UL
+#define SIMULATED_SECONDS 10UL
+#define RX_BUF_SIZE 4096 // A power of two, emptied after every service pass
+#define TRACE_CAPACITY ( 16UL * 1024 * 1024 )
+#define PATH_LENGTH 256
+
+/* Line traffic of one UART: bursts of burstBytes at full line rate every period_ms. A burst longer than the period is
+ a continuous stream, a baud rate of 0 leaves the UART unused. */
+typedef struct LINE_TRAFFIC_t {
+   uint32_t baudRate ;
+   uint32_t period_ms ;
+   uint32_t burstBytes ;
+   const char * content ; // Repeated to fill the bursts
+} LINE_TRAFFIC ;
+
+typedef struct SCENARIO_t {
+   const char * name ;
+   LINE_TRAFFIC lines [ 2 ] ; // UART_0, UART_1
+   bool isFramed ; // UART_1 bytes go through an NMEA framer instead of the rx buffer
+} SCENARIO ;
+
+typedef struct SCENARIO_RESULT_t {
+   uint64_t lineBytes ; // Bytes put on the lines while recording
+   uint64_t receivedBytes ; // Bytes the replayed driver delivered to the port buffers or the framer
+   uint32_t numFrames ;
+   uint32_t numTransactions ;
+   uint32_t numWords ;
+   uint64_t cpuTimeNs ;
+   SPI_TRACE_REPLAY_STATUS replay ;
+   size_t traceLength ;
+} SCENARIO_RESULT ;
+
+static const char gpsContent [ ] =
+   "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+   "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n"
+   "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n"
+   "$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74\r\n"
+   "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D\r\n"
+   "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"
+   "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n" ;
+static const char adcContent [ ] = "\xA5\x5A\x01\x02\x03\x04\x05\x06" ; // Sync word and three 16 bit samples
+
+static const SCENARIO scenarios [ ] = {
+   { "gps_burst", { { 0, 0, 0, NULL }, { 9600UL, 1000, sizeof ( gpsContent ) - 1, gpsContent } }, true },
+   { "adc_stream", { { 115200UL, 1000, 0xFFFFFFFFUL, adcContent }, { 0, 0, 0, NULL } }, false },
+   { "idle_line", { { 115200UL, 1000, 0, NULL }, { 9600UL, 1000, 0, NULL } }, false }
+} ;
+#define NUM_SCENARIOS ( sizeof ( scenarios ) / sizeof ( scenarios [ 0 ] ) )
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static MAX3109_UART_PORT ports [ 2 ] ;
+static MAX3109_UART_PORT_SET portSet ;
+static circBuffer_t rxBufs [ 2 ] ;
+static circBuffer_t txBuf ;
+static uint8_t rxStorage [ 2 ] [ RX_BUF_SIZE ] ;
+static uint8_t txStorage [ 1 ] ;
+static NmeaFramer framer ;
+static uint8_t framerStorage [ 256 ] ;
+static uint8_t traceStorage [ TRACE_CAPACITY ] ;
+static uint32_t simulatedTime_us ;
+static volatile uint32_t sink ;
+
+static uint32_t SimulatedClock ( void )
+{
+   return simulatedTime_us ;
+}
+
+static void OnFrame ( void * context, const NmeaFrameView * frame )
+{
+   ( void ) context ;
+   sink += ( uint32_t ) ( frame->firstLength + frame->secondLength ) ;
+}
+
+/* Bytes the line has delivered by time_us since the start of the traffic */
+static uint64_t BytesArrivedBy ( const LINE_TRAFFIC * line, const uint64_t time_us )
+{
+   uint64_t charactersPerSecond = line->baudRate / 10 ; // 8N1
+   uint64_t period_us = ( uint64_t ) line->period_ms * 1000 ;
+   uint64_t periodBytes = ( period_us * charactersPerSecond ) / 1000000UL ;
+   uint64_t burstBytes = ( line->burstBytes < periodBytes ) ? line->burstBytes : periodBytes ;
+   uint64_t lineBytes = ( ( time_us % period_us ) * charactersPerSecond ) / 1000000UL ;
+   return ( ( time_us / period_us ) * burstBytes ) + ( ( lineBytes < burstBytes ) ? lineBytes : burstBytes ) ;
+}
+
+static void DeliverLineBytes ( const LINE_TRAFFIC * line, const MAX3109_UART_SELECTION channel, uint64_t * numDelivered,
+                               const uint64_t numArrived )
+{
+   size_t contentLength = strlen ( line->content ) ;
+   while ( *numDelivered < numArrived )
+   {
+      uint8_t bytes [ 128 ] ;
+      uint8_t numBytes = ( ( numArrived - *numDelivered ) < sizeof ( bytes ) ) ? ( uint8_t ) ( numArrived - *numDelivered ) : sizeof ( bytes ) ;
+      uint8_t counter ;
+      for ( counter = 0 ; counter < numBytes ; counter++ )
+      {
+         bytes [ counter ] = ( uint8_t ) line->content [ ( *numDelivered + counter ) % contentLength ] ;
+      }
+      HostMAX3109InjectRx ( &model, channel, bytes, numBytes ) ; // Refused bytes count as rxOverruns
+      *numDelivered += numBytes ;
+   }
+}
+
+/* Chip and port setup. Runs against whatever transport the device points at, so it is recorded and replayed too. */
+static uint8_t SetUpScenario ( const SCENARIO * scenario, const SPI_TRANSPORT * transport )
+{
+   memset ( &device, 0, sizeof ( device ) ) ; // Empty shadow registers, as after power up
+   device.transport = transport ;
+   MAXSelectDevice ( &device ) ;
+
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   if ( 0 == HostChipInitialize ( 115200UL, &baudSettings ) )
+   {
+      return 0 ;
+   }
+
+   uint8_t numPorts = 0 ;
+   uint8_t lineIndex ;
+   for ( lineIndex = 0 ; lineIndex < 2 ; lineIndex++ )
+   {
+      const LINE_TRAFFIC * line = &scenario->lines [ lineIndex ] ;
+      MAX3109_UART_SELECTION channel = ( 0 == lineIndex ) ? UART_0 : UART_1 ;
+      if ( 0 == line->baudRate )
+      {
+         continue ;
+      }
+      if ( ( 0 == MAXSolveBaudDivisor ( baudSettings.referenceHz, line->baudRate, &baudSettings ) ) ||
+           ( 0 == MAXConfigureBaudRate ( channel, &baudSettings ) ) )
+      {
+         return 0 ;
+      }
+      cb_init ( &rxBufs [ numPorts ], rxStorage [ numPorts ], RX_BUF_SIZE ) ;
+      InitializeUARTPort ( &ports [ numPorts ], &device, channel, &rxBufs [ numPorts ], &txBuf, 0 ) ;
+      if ( scenario->isFramed && ( UART_1 == channel ) )
+      {
+         nf_init ( &framer, framerStorage, sizeof ( framerStorage ), 0, OnFrame, NULL ) ;
+         AttachUARTPortFramer ( &ports [ numPorts ], &framer ) ;
+      }
+      numPorts++ ;
+   }
+   InitializeUARTPortSet ( &portSet, ports, numPorts ) ;
+   return 1 ;
+}
+
+/* One service pass per period. While recording, the model receives the line bytes first. Returns the bytes delivered
+ to the port buffers and the framer. */
+static uint64_t RunTraffic ( const SCENARIO * scenario, const bool isRecording, uint64_t * lineBytes )
+{
+   uint64_t numDelivered [ 2 ] = { 0, 0 } ;
+   uint64_t numReceived = 0 ;
+   uint64_t time_us ;
+   for ( time_us = 0 ; time_us < ( SIMULATED_SECONDS * 1000000UL ) ; time_us += SERVICE_PERIOD_US )
+   {
+      simulatedTime_us = ( uint32_t ) time_us ;
+      uint8_t lineIndex ;
+      for ( lineIndex = 0 ; isRecording && ( lineIndex < 2 ) ; lineIndex++ )
+      {
+         const LINE_TRAFFIC * line = &scenario->lines [ lineIndex ] ;
+         if ( ( 0 != line->baudRate ) && ( 0 != line->burstBytes ) )
+         {
+            DeliverLineBytes ( line, ( 0 == lineIndex ) ? UART_0 : UART_1, &numDelivered [ lineIndex ], BytesArrivedBy ( line, time_us ) ) ;
+         }
+      }
+
+      numReceived += ServiceUARTPorts ( &portSet ) ;
+      uint8_t portIndex ;
+      for ( portIndex = 0 ; portIndex < portSet.numPorts ; portIndex++ )
+      {
+         cb_advance_tail ( &rxBufs [ portIndex ], cb_count ( &rxBufs [ portIndex ] ) ) ;
+      }
+   }
+   *lineBytes = numDelivered [ 0 ] + numDelivered [ 1 ] ;
+   return numReceived ;
+}
+
+static uint8_t RecordScenario ( const SCENARIO * scenario, SCENARIO_RESULT * result )
+{
+   HostMAX3109ModelReset ( &model ) ;
+   HostSPIAttachModel ( 0, &model ) ;
+   simulatedTime_us = 0 ;
+   SPIRecorderStart ( traceStorage, sizeof ( traceStorage ), &hostSPITransport, SimulatedClock ) ;
+   if ( 0 == SetUpScenario ( scenario, &spiRecorderTransport ) )
+   {
+      return 0 ;
+   }
+   RunTraffic ( scenario, true, &result->lineBytes ) ;
+
+   SPI_TRACE_RECORDER_STATUS recorderStatus ;
+   SPIRecorderGetStatus ( &recorderStatus ) ;
+   result->traceLength = recorderStatus.length ;
+   return ( recorderStatus.isTruncated ) ? 0 : 1 ;
+}
+
+static uint8_t ReplayScenario ( const SCENARIO * scenario, SCENARIO_RESULT * result )
+{
+   SPI_TRACE_REPLAY_STATUS setupStatus ;
+   uint64_t unusedLineBytes ;
+   if ( ( 0 != SPIReplayStart ( traceStorage, result->traceLength ) ) ||
+        ( 0 == SetUpScenario ( scenario, &spiReplayTransport ) ) )
+   {
+      return 0 ;
+   }
+   SPIReplayGetStatus ( &setupStatus ) ;
+
+   uint32_t framesBefore = framer.framesDelivered ;
+   uint64_t startNs = BenchCPUTimeNs ( ) ;
+   result->receivedBytes = RunTraffic ( scenario, false, &unusedLineBytes ) ;
+   result->cpuTimeNs = BenchCPUTimeNs ( ) - startNs ;
+   result->numFrames = ( scenario->isFramed ) ? ( framer.framesDelivered - framesBefore ) : 0 ;
+
+   SPIReplayGetStatus ( &result->replay ) ;
+   result->numTransactions = result->replay.numTransactions - setupStatus.numTransactions ;
+   result->numWords = result->replay.numWords - setupStatus.numWords ;
+   return 1 ;
+}
+
+static uint8_t SaveTrace ( const char * directory, const SCENARIO * scenario, const SCENARIO_RESULT * result )
+{
+   char path [ PATH_LENGTH ] ;
+   snprintf ( path, sizeof ( path ), "%s/%s.spt", directory, scenario->name ) ;
+   FILE * file = fopen ( path, "wb" ) ;
+   if ( NULL == file )
+   {
+      return 0 ;
+   }
+   size_t written = fwrite ( traceStorage, 1, result->traceLength, file ) ;
+   uint8_t isWritten = ( written == result->traceLength ) ? 1 : 0 ;
+   return ( ( 0 == fclose ( file ) ) && isWritten ) ? 1 : 0 ;
+}
+
+static uint8_t LoadTrace ( const char * directory, const SCENARIO * scenario, SCENARIO_RESULT * result )
+{
+   char path [ PATH_LENGTH ] ;
+   snprintf ( path, sizeof ( path ), "%s/%s.spt", directory, scenario->name ) ;
+   FILE * file = fopen ( path, "rb" ) ;
+   if ( NULL == file )
+   {
+      return 0 ;
+   }
+   result->traceLength = fread ( traceStorage, 1, sizeof ( traceStorage ), file ) ;
+   fclose ( file ) ;
+   return 1 ;
+}
+
+static double PerByte ( const double value, const uint64_t numBytes )
+{
+   return ( 0 == numBytes ) ? 0.0 : value / ( double ) numBytes ;
+}
+
+int main ( int argc, char * * argv )
+{
+   const char * saveDirectory = NULL ;
+   const char * loadDirectory = NULL ;
+   int option ;
+   while ( -1 != ( option = getopt ( argc, argv, "w:r:" ) ) )
+   {
+      switch ( option )
+      {
+         case 'w': saveDirectory = optarg ; break ;
+         case 'r': loadDirectory = optarg ; break ;
+         default:
+            fprintf ( stderr, "Usage: %s [-w directory | -r directory]\n", argv [ 0 ] ) ;
+            return EXIT_FAILURE ;
+      }
+   }
+   cb_init ( &txBuf, txStorage, sizeof ( txStorage ) ) ;
+
+   printf ( "%lu s per scenario, ports serviced every %lu us%s\n", SIMULATED_SECONDS, SERVICE_PERIOD_US,
+            ( NULL != loadDirectory ) ? ", traces loaded from disk" : "" ) ;
+   printf ( "%-11s %9s %9s %7s %9s %8s %9s %10s %10s %6s %9s %5s\n", "scenario", "trace B", "rx bytes", "frames",
+            "SPI/byte", "SPI/s", "words/B", "CPU us/KB", "CPU us/s", "drops", "mismatch", "past" ) ;
+
+   int status = EXIT_SUCCESS ;
+   uint8_t scenarioIndex ;
+   for ( scenarioIndex = 0 ; scenarioIndex < NUM_SCENARIOS ; scenarioIndex++ )
+   {
+      const SCENARIO * scenario = &scenarios [ scenarioIndex ] ;
+      SCENARIO_RESULT result ;
+      memset ( &result, 0, sizeof ( result ) ) ;
+
+      uint8_t isTraceReady = ( NULL != loadDirectory ) ? LoadTrace ( loadDirectory, scenario, &result ) :
+                                                          RecordScenario ( scenario, &result ) ;
+      if ( ( 0 == isTraceReady ) ||
+           ( ( NULL != saveDirectory ) && ( 0 == SaveTrace ( saveDirectory, scenario, &result ) ) ) ||
+           ( 0 == ReplayScenario ( scenario, &result ) ) )
+      {
+         printf ( "%-11s trace could not be recorded, saved or replayed\n", scenario->name ) ;
+         status = EXIT_FAILURE ;
+         continue ;
+      }
+
+      /* Line bytes are only known when the trace was recorded in this run */
+      uint64_t numDrops = ( result.lineBytes > result.receivedBytes ) ? ( result.lineBytes - result.receivedBytes ) : 0 ;
+      printf ( "%-11s %9lu %9lu %7lu %9.4f %8.0f %9.4f %10.1f %10.1f %6lu %9lu %5lu\n", scenario->name,
+               ( unsigned long ) result.traceLength, ( unsigned long ) result.receivedBytes, ( unsigned long ) result.numFrames,
+               PerByte ( result.numTransactions, result.receivedBytes ), ( double ) result.numTransactions / SIMULATED_SECONDS,
+               PerByte ( result.numWords, result.receivedBytes ), PerByte ( ( double ) result.cpuTimeNs, result.receivedBytes ),
+               ( ( double ) result.cpuTimeNs / 1000.0 ) / SIMULATED_SECONDS, ( unsigned long ) numDrops,
+               ( unsigned long ) result.replay.writeMismatches, ( unsigned long ) result.replay.numWordsPastEnd ) ;
+      if ( ( 0 != numDrops ) ||
+           ( 0 != result.replay.writeMismatches ) ||
+           ( 0 != result.replay.numWordsPastEnd ) )
+      {
+         status = EXIT_FAILURE ;
+      }
+   }
+   return status ;
+}
@@ -0,0 +1,23 @@
+/*
+ File: Check macro and verdict shared by the host tests
+ Author: Henry Gilbert
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+
+static int failures = 0 ;
+
+/* Reports a failed condition and carries on, so one run shows every failure */
+#define CHECK(condition) do { if ( !( condition ) ) { printf ( "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition ) ; failures++ ; } } while ( 0 )
+
+/* Prints the verdict line make check shows and returns the exit status for main */
+static inline int TestVerdict ( const char * testName )
+{
+   printf ( "%s: %s\n", testName, ( 0 == failures ) ? "pass" : "FAIL" ) ;
+   return ( 0 == failures ) ? 0 : 1 ;
+}
+
+#endif
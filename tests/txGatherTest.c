@@ -0,0 +1,133 @@
+/*
+ File: Host test for gathered TxFIFO writes
+ Author: Henry Gilbert
+
+ Sends fragmented messages through MAXPushGatherToUARTTxFIFO on the host model and checks what reaches the TxFIFO
+ against the fragments laid end to end. Covers fragments packed into one burst, odd and even burst lengths (an even
+ count sends its last byte as a single write), a message spanning several refills with refill limits that split
+ fragments, and a checksum trailer that must hold the bytes checksummed by earlier refills.
+ */
+
+#include "hostSPI.h"
+#include "hostChip.h"
+#include "testCheck.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_MESSAGE_BYTES 512
+#define PAYLOAD_BYTES 300
+
+static HOST_MAX3109_MODEL model ;
+static MAX3109_DEVICE device ;
+static const uint8_t header [ ] = { '$', 'G', 'W', ',' } ;
+static const uint8_t footer [ ] = { '\r', '\n' } ;
+static uint8_t payload [ PAYLOAD_BYTES ] ;
+
+/* The fragments laid end to end, each trailer replaced by the XOR of the checksummed bytes before it */
+static uint16_t ExpectedMessage ( const MAX3109_TX_FRAGMENT * fragments, const uint8_t numFragments, uint8_t * message )
+{
+   uint16_t numBytes = 0 ;
+   uint8_t checksum = 0 ;
+   uint8_t fragmentIndex ;
+   for ( fragmentIndex = 0 ; fragmentIndex < numFragments ; fragmentIndex++ )
+   {
+      const MAX3109_TX_FRAGMENT * fragment = &fragments [ fragmentIndex ] ;
+      if ( fragment->isChecksumTrailer )
+      {
+         message [ numBytes++ ] = checksum ;
+         continue ;
+      }
+      uint16_t counter ;
+      for ( counter = 0 ; counter < fragment->numBytes ; counter++ )
+      {
+         message [ numBytes++ ] = fragment->data [ counter ] ;
+         checksum ^= ( fragment->isChecksummed ) ? fragment->data [ counter ] : 0 ;
+      }
+   }
+   return numBytes ;
+}
+
+/* Pushes the whole gather refillLimit bytes at a time, emptying the TxFIFO after each refill, and checks every refill
+ costs one burst frame plus a single write frame when its byte count is even */
+static void SendGather ( const MAX3109_TX_FRAGMENT * fragments, const uint8_t numFragments, const uint8_t refillLimit )
+{
+   uint8_t expected [ MAX_MESSAGE_BYTES ] ;
+   uint8_t sent [ MAX_MESSAGE_BYTES ] ;
+   uint16_t numExpected = ExpectedMessage ( fragments, numFragments, expected ) ;
+   uint16_t numSent = 0 ;
+   MAX3109_TX_GATHER gather ;
+   CHECK ( 1 == MAXInitializeTxGather ( &gather, fragments, numFragments ) ) ;
+   CHECK ( numExpected == gather.numBytesRemaining ) ;
+
+   while ( gather.numBytesRemaining > 0 )
+   {
+      HOST_SPI_STATS stats ;
+      HostSPIResetStats ( ) ;
+      uint8_t numBytes = MAXPushGatherToUARTTxFIFO ( UART_0, &gather, refillLimit ) ;
+      HostSPIGetStats ( &stats ) ;
+      CHECK ( 0 != numBytes ) ;
+      if ( 0 == numBytes )
+      {
+         return ;
+      }
+
+      uint8_t numBurstBytes = ( numBytes & 0x01 ) ? numBytes : ( numBytes - 1 ) ;
+      uint32_t numFrames = ( numBurstBytes == numBytes ) ? 1 : 2 ;
+      CHECK ( numFrames == stats.transactions ) ;
+      CHECK ( ( MAX3109_BURST_WORD_COUNT ( numBurstBytes ) + numFrames - 1 ) == stats.words ) ;
+      CHECK ( numBytes == stats.txFIFOBytes ) ;
+      CHECK ( numBytes == HostMAX3109DrainTx ( &model, UART_0, &sent [ numSent ], numBytes ) ) ;
+      numSent += numBytes ;
+   }
+
+   CHECK ( 0 == MAXPushGatherToUARTTxFIFO ( UART_0, &gather, refillLimit ) ) ;
+   CHECK ( numExpected == numSent ) ;
+   CHECK ( 0 == memcmp ( expected, sent, numExpected ) ) ;
+}
+
+int main ( void )
+{
+   MAX3109_BAUD_SETTINGS baudSettings ;
+   CHECK ( 1 == HostChipAttach ( &model, &device, 0 ) ) ;
+   CHECK ( 1 == HostChipInitialize ( 115200UL, &baudSettings ) ) ;
+
+   uint16_t counter ;
+   for ( counter = 0 ; counter < PAYLOAD_BYTES ; counter++ )
+   {
+      payload [ counter ] = ( uint8_t ) ( ( counter * 7 ) + 1 ) ;
+   }
+
+   /* Header and payload in one burst: 4 + 9 bytes is odd, and an empty fragment in between sends nothing */
+   const MAX3109_TX_FRAGMENT oddMessage [ ] = {
+      { header, sizeof ( header ), false, false },
+      { payload, 0, true, false },
+      { payload, 9, true, false }
+   } ;
+   SendGather ( oddMessage, sizeof ( oddMessage ) / sizeof ( oddMessage [ 0 ] ), MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+
+   /* A trailer makes it even, so the checksum goes out as the single write after the burst */
+   const MAX3109_TX_FRAGMENT evenMessage [ ] = {
+      { header, sizeof ( header ), false, false },
+      { payload, 9, true, false },
+      { NULL, 0, false, true }
+   } ;
+   SendGather ( evenMessage, sizeof ( evenMessage ) / sizeof ( evenMessage [ 0 ] ), MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES ) ;
+
+   /* The payload spans several refills, and the trailer falls in a later refill than most of what it covers */
+   const MAX3109_TX_FRAGMENT longMessage [ ] = {
+      { header, sizeof ( header ), false, false },
+      { payload, 100, true, false },
+      { &payload [ 100 ], PAYLOAD_BYTES - 100, true, false },
+      { NULL, 0, false, true },
+      { footer, sizeof ( footer ), false, false }
+   } ;
+   uint8_t refillLimits [ ] = { MAXIMUM_MAX3109_FIFO_SIZE_IN_BYTES, 37, 2, 1 } ;
+   uint8_t limitIndex ;
+   for ( limitIndex = 0 ; limitIndex < sizeof ( refillLimits ) ; limitIndex++ )
+   {
+      SendGather ( longMessage, sizeof ( longMessage ) / sizeof ( longMessage [ 0 ] ), refillLimits [ limitIndex ] ) ;
+   }
+
+   CHECK ( 0 == model.channels [ 0 ].txOverruns ) ;
+   return TestVerdict ( "txGatherTest" ) ;
+}
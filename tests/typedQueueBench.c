@@ -0,0 +1,102 @@
+// Memory and push/pop throughput of DECLARE_TYPED_QUEUE per element type, against the uint32_t RingQueue every
+// element type had to go through before.
+
+#include "typedQueue.h"
+#include "ringQueue.h"
+#include "benchClock.h"
+#include <stdio.h>
+
+#define CAPACITY 256
+#define BATCH 64
+#define NUM_ROUNDS 200000UL
+
+typedef struct AdcSample_t
+{
+	uint16_t channel;
+	uint16_t value;
+	uint32_t timestamp;
+} AdcSample;
+
+DECLARE_TYPED_QUEUE(ByteQueue, uint8_t, CAPACITY)
+DECLARE_TYPED_QUEUE(WordQueue, uint16_t, CAPACITY)
+DECLARE_TYPED_QUEUE(SampleQueue, AdcSample, CAPACITY)
+
+static ByteQueue byteQueue;
+static WordQueue wordQueue;
+static SampleQueue sampleQueue;
+static RingQueue ringQueue;
+static uint32_t ringStorage[CAPACITY];
+static volatile uint32_t sink;
+
+// Keeps BATCH values in flight and times rounds of BATCH pushes then BATCH pops
+#define BENCH_TYPED_QUEUE(name, queue, type, makeValue, sumValue)										\
+	do																									\
+	{																									\
+		type value;																						\
+		size_t counter;																					\
+		unsigned long round = 0;																		\
+		for (counter = 0; counter < BATCH; counter++)													\
+		{																								\
+			value = makeValue;																			\
+			name##_push(&queue, value);																	\
+		}																								\
+		uint64_t start = BenchWallTimeNs();																\
+		for (round = 0; round < NUM_ROUNDS; round++)													\
+		{																								\
+			for (counter = 0; counter < BATCH; counter++)												\
+			{																							\
+				value = makeValue;																		\
+				name##_push(&queue, value);																\
+			}																							\
+			for (counter = 0; counter < BATCH; counter++)												\
+			{																							\
+				name##_pop(&queue, &value);																\
+				sum += sumValue;																		\
+			}																							\
+		}																								\
+		report(#type, sizeof(queue), BenchWallTimeNs() - start);										\
+	} while (0)
+
+static void report(const char* typeName, size_t numBytes, uint64_t elapsedNs)
+{
+	printf("  %-10s %6zu bytes  %6.2f bytes/element  %8.1f M values/s\n", typeName, numBytes,
+		(double)numBytes / CAPACITY, (2.0 * BATCH * NUM_ROUNDS * 1e3) / (double)elapsedNs);
+}
+
+int main(void)
+{
+	uint32_t sum = 0;
+	printf("typedQueueBench: capacity %u, %lu rounds of %u pushes then %u pops\n", CAPACITY, NUM_ROUNDS, BATCH, BATCH);
+
+	BENCH_TYPED_QUEUE(ByteQueue, byteQueue, uint8_t, (uint8_t)counter, value);
+	BENCH_TYPED_QUEUE(WordQueue, wordQueue, uint16_t, (uint16_t)counter, value);
+	BENCH_TYPED_QUEUE(SampleQueue, sampleQueue, AdcSample, ((AdcSample){ (uint16_t)counter, 0, (uint32_t)round }),
+		value.channel + value.timestamp);
+
+	// The same bytes through the generic uint32_t queue
+	rq_init(&ringQueue, ringStorage, CAPACITY);
+	uint32_t value;
+	size_t counter;
+	for (counter = 0; counter < BATCH; counter++)
+	{
+		rq_push(&ringQueue, (uint8_t)counter);
+	}
+	uint64_t start = BenchWallTimeNs();
+	unsigned long round;
+	for (round = 0; round < NUM_ROUNDS; round++)
+	{
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			rq_push(&ringQueue, (uint8_t)counter);
+		}
+		for (counter = 0; counter < BATCH; counter++)
+		{
+			rq_pop(&ringQueue, &value);
+			sum += value;
+		}
+	}
+	report("RingQueue", sizeof(ringQueue) + sizeof(ringStorage), BenchWallTimeNs() - start);
+
+	sink = sum;
+	return 0;
+}
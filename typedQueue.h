@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "ringQueue.h"
+
+// Compile time specialized wraparound queue. DECLARE_TYPED_QUEUE(name, type, capacity) generates a queue type
+// holding capacity elements of type inline, and static inline functions name_push, name_pop, name_peek,
+// name_push_n, name_pop_n, name_numMsgsInQueue and name_reset. Capacity must be a power of two and is a constant,
+// so the index mask folds into the generated code - a uint8_t queue of UART bytes costs one byte per element
+// instead of the four a uint32_t Queue needs.
+// Same single producer / single consumer rules as RingQueue.
+//
+// Example:
+//	DECLARE_TYPED_QUEUE(UartByteQueue, uint8_t, 256)
+//	static UartByteQueue gpsRx;	// zero initialized is empty
+//	UartByteQueue_push(&gpsRx, byte);
+
+#define DECLARE_TYPED_QUEUE(name, type, capacity)														\
+	typedef char name##_capacity_must_be_a_power_of_two[(((capacity) > 0) &&						\
+		(0 == ((capacity) & ((capacity) - 1)))) ? 1 : -1];												\
+																										\
+	typedef struct name##_t																				\
+	{																									\
+		RQ_ATOMIC size_t write; /* free running, only advanced by the producer */						\
+		RQ_ATOMIC size_t read; /* free running, only advanced by the consumer */						\
+		type data[capacity];																			\
+	} name;																								\
+																										\
+	static inline bool name##_push(name* q, type value)												\
+	{																									\
+		size_t write = RQ_LOAD_RELAXED(q->write);														\
+		if ((write - RQ_LOAD_ACQUIRE(q->read)) >= (capacity))											\
+		{																								\
+			return false;																				\
+		}																								\
+		q->data[write & ((capacity) - 1)] = value;														\
+		RQ_STORE_RELEASE(q->write, write + 1);															\
+		return true;																					\
+	}																									\
+																										\
+	static inline bool name##_pop(name* q, type* value)												\
+	{																									\
+		size_t read = RQ_LOAD_RELAXED(q->read);															\
+		if (read == RQ_LOAD_ACQUIRE(q->write))															\
+		{																								\
+			return false;																				\
+		}																								\
+		*value = q->data[read & ((capacity) - 1)];														\
+		RQ_STORE_RELEASE(q->read, read + 1);															\
+		return true;																					\
+	}																									\
+																										\
+	static inline bool name##_peek(name* q, size_t offset, type* value)								\
+	{																									\
+		size_t read = RQ_LOAD_RELAXED(q->read);															\
+		if (offset >= (RQ_LOAD_ACQUIRE(q->write) - read))												\
+		{																								\
+			return false;																				\
+		}																								\
+		*value = q->data[(read + offset) & ((capacity) - 1)];											\
+		return true;																					\
+	}																									\
+																										\
+	/* Pushes up to count values with at most two copies. Returns the number pushed */				\
+	static inline size_t name##_push_n(name* q, const type* values, size_t count)						\
+	{																									\
+		size_t write = RQ_LOAD_RELAXED(q->write);														\
+		size_t space = (capacity) - (write - RQ_LOAD_ACQUIRE(q->read));									\
+		size_t n = (count < space) ? count : space;														\
+		size_t index = write & ((capacity) - 1);														\
+		size_t first = (n < ((capacity) - index)) ? n : ((capacity) - index);							\
+		memcpy(&q->data[index], values, first * sizeof(type));											\
+		memcpy(q->data, &values[first], (n - first) * sizeof(type));									\
+		RQ_STORE_RELEASE(q->write, write + n);															\
+		return n;																						\
+	}																									\
+																										\
+	/* Pops up to count values with at most two copies. Returns the number popped */					\
+	static inline size_t name##_pop_n(name* q, type* values, size_t count)							\
+	{																									\
+		size_t read = RQ_LOAD_RELAXED(q->read);															\
+		size_t available = RQ_LOAD_ACQUIRE(q->write) - read;											\
+		size_t n = (count < available) ? count : available;												\
+		size_t index = read & ((capacity) - 1);															\
+		size_t first = (n < ((capacity) - index)) ? n : ((capacity) - index);							\
+		memcpy(values, &q->data[index], first * sizeof(type));											\
+		memcpy(&values[first], q->data, (n - first) * sizeof(type));									\
+		RQ_STORE_RELEASE(q->read, read + n);															\
+		return n;																						\
+	}																									\
+																										\
+	static inline size_t name##_numMsgsInQueue(name* q)												\
+	{																									\
+		size_t read = RQ_LOAD_ACQUIRE(q->read);															\
+		return RQ_LOAD_ACQUIRE(q->write) - read;														\
+	}																									\
+																										\
+	/* Only safe while neither the producer nor the consumer is running */							\
+	static inline void name##_reset(name* q)															\
+	{																									\
+		RQ_STORE_RELEASE(q->read, 0);																	\
+		RQ_STORE_RELEASE(q->write, 0);																	\
+	}